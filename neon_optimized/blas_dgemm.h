@@ -1,6 +1,8 @@
 #ifndef M_DGEMM_BLAS_H
 #define M_DGEMM_BLAS_H
 
+#include <stddef.h>
+
 
 
 #define M_BLAS_KERNEL_BLOCK_ROWS 4
@@ -49,13 +51,453 @@ void dgemm_unroll_abat(unsigned int m, unsigned int p, double *a, unsigned int l
                                                        double *b, unsigned int ldb,
                                                        double *c, unsigned int ldc);
 
+/******************************************* config *******************************************/
+// 内核使用的预取指令（配置文件 / DGEMM_PREFETCH 中用括号内的名字）
+typedef enum {
+    M_BLAS_PREFETCH_NONE = 0,   // 不预取（none）
+    M_BLAS_PREFETCH_L1KEEP,     // prfm pldl1keep（l1keep，默认）
+    M_BLAS_PREFETCH_L1STRM,     // prfm pldl1strm（l1strm）
+    M_BLAS_PREFETCH_L2KEEP,     // prfm pldl2keep（l2keep）
+    M_BLAS_PREFETCH_L2STRM,     // prfm pldl2strm（l2strm）
+    M_BLAS_PREFETCH_COUNT
+} m_blas_prefetch;
+
+// 分块与预取参数，dgemm_neon / dgemm_neon_fast 在运行时读取（见 dgemm_config.c）
+typedef struct {
+    unsigned int gemm_m;        // M 维度分块（mc），4 的倍数
+    unsigned int gemm_n;        // N 维度分块（nc），8 的倍数
+    unsigned int gemm_p;        // P(K) 维度分块（kc），4 的倍数
+    unsigned int prefetch_a;    // 4x8 内核中 A 的预取距离（字节）
+    unsigned int prefetch_b;    // 4x8 内核中 B 的预取距离（字节）
+    unsigned int prefetch_4x4;  // 4x4 内核中 A/B 的预取距离（字节）
+    unsigned int prefetch_type; // 所有内核的预取指令（m_blas_prefetch）
+    unsigned int direct_max_mnp;// m*n*p 不超过该值时 dgemm_neon_auto 不打包（0 关闭）
+    unsigned int stream_c_bytes;// C 超过该字节数时 dgemm_neon_fast 用非临时存储写回（0 关闭）
+    unsigned int threads;       // dgemm_neon_fast 的线程数（0 为 OpenMP 默认，即 OMP_NUM_THREADS / 核数）
+    unsigned int thread_min_flops;// 多线程时每个线程至少分到的浮点运算数（0 不限制）
+    unsigned int reproducible;  // 非 0 时结果与线程数、线程池大小无关（含按 K 划分、批量与小矩阵路径），逐位可复现
+} m_blas_config;
+
+// 从 sysfs 读到的缓存拓扑（字节 / CPU 个数，0 表示未知）
+typedef struct {
+    unsigned int l1d_size;
+    unsigned int l2_size;
+    unsigned int l3_size;
+    unsigned int l2_shared;     // 共享同一 L2 的 CPU 数
+    unsigned int l3_shared;     // 共享同一 L3 的 CPU 数
+} m_blas_cache_info;
+
+// dgemm_cpu_topology 记录的 CPU 个数上限
+#define M_BLAS_TOPO_MAX_CPUS (256)
+
+// 从 sysfs 读到的 CPU 拓扑：在线 CPU 按 L2 簇排列，容量（cpu_capacity）大的簇在前
+typedef struct {
+    unsigned int ncpus;
+    unsigned int nclusters;
+    unsigned int uniform;       // 各核容量相同，且只有一个 L2 簇或每簇一个核：调度时不必区分
+    unsigned short cpu[M_BLAS_TOPO_MAX_CPUS];       // 逻辑 CPU 号
+    unsigned short cluster[M_BLAS_TOPO_MAX_CPUS];   // 所在 L2 簇（按上面的顺序从 0 编号）
+    unsigned short capacity[M_BLAS_TOPO_MAX_CPUS];  // 相对性能，最快的核为 1024（读不到时为 1024）
+} m_blas_topology;
+
+// 配置上限，保证 sa/sb 按 M_BLAS_PACK_SA_SIZE / M_BLAS_PACK_SB_SIZE 分配时够用
+#define M_BLAS_CONFIG_MAX_P (256)
+
+// threads 的上限
+#define M_BLAS_CONFIG_MAX_THREADS (256)
+
+// sa/sb 打包缓冲区大小（double 个数），按此分配可用于所有合法配置下的 NEON 实现
+#define M_BLAS_PACK_SA_SIZE (2048 * M_BLAS_CONFIG_MAX_P)   // gemm_m * gemm_p 上限
+#define M_BLAS_PACK_SB_SIZE (512 * M_BLAS_CONFIG_MAX_P)    // gemm_p * gemm_n 上限
+
+// 当前配置；首次调用时加载 $DGEMM_CONFIG（默认 ./dgemm_tune.conf），不存在则用内置默认值，
+// 然后应用 $DGEMM_PREFETCH（"类型[,A 距离,B 距离[,4x4 距离]]"，如 "l2keep,512,768"）、
+// $DGEMM_THREADS（线程数）与 $DGEMM_REPRODUCIBLE（0 / 1）。返回的配置不会再被修改
+const m_blas_config *dgemm_config_get(void);
+
+// 替换当前配置（参数会被规整到合法范围）；可以与正在运行的 GEMM 并发调用，
+// 已经开始的调用继续使用原来的配置
+void dgemm_config_set(const m_blas_config *cfg);
+
+// 内置默认值（rk3399 上得到的 GEMM_M 2048 / GEMM_N 256 / GEMM_P 128）
+void dgemm_config_default(m_blas_config *cfg);
+
+// 预取类型与名字（"none" / "l1keep" / ...）互相转换，未知名字返回 -1
+const char *dgemm_prefetch_name(unsigned int type);
+int dgemm_prefetch_parse(const char *name);
+
+// 把参数规整到合法范围（对齐、缓冲区上限）
+void dgemm_config_clamp(m_blas_config *cfg);
+
+// 读/写配置文件（key=value 文本），成功返回 0
+int dgemm_config_load(const char *path, m_blas_config *cfg);
+int dgemm_config_save(const char *path, const m_blas_config *cfg);
+
+// 读取 cpu0 的缓存拓扑，成功返回 0
+int dgemm_cache_info(m_blas_cache_info *info);
+
+// 所有在线 CPU 的 L2 簇与容量；第一次调用时读取，之后返回同一份（不会返回 NULL）
+const m_blas_topology *dgemm_cpu_topology(void);
+
+// 调用线程当前所在 CPU 在 dgemm_cpu_topology() 中的下标，未知返回 -1
+int dgemm_topology_current(void);
+
+// 按缓存大小推导分块参数（自动调优的搜索起点）；direct_max_mnp 取 A、B、C 同时放进每核 L2 一半的规模，
+// stream_c_bytes 取最后一级缓存的大小
+void dgemm_config_from_cache(const m_blas_cache_info *info, m_blas_config *cfg);
+
+// 在 size^3 的问题上计时搜索分块与预取参数，并实测不打包路径的交叉点，
+// 结果写入 cfg 并保存到 path（可为 NULL）
+int dgemm_autotune(unsigned int size, const char *path, m_blas_config *cfg);
+
+/******************************************* ld *******************************************/
+// 行距字节数是该值的倍数时相邻的行在 L1 中互相冲突（4K 混叠），见 dgemm_ld.c
+#define M_BLAS_LD_ALIAS_BYTES (1024)
+
+// ld 是否为上述会冲突的行距
+int dgemm_ld_is_pathological(size_t ld);
+
+// 不小于 cols、按 64 字节对齐且不冲突的行距（例如 256 -> 264）
+size_t dgemm_ld_pad(size_t cols);
+
+// 按 dgemm_ld_pad(cols) 分配 rows 行、64 字节对齐的矩阵，行距写入 *ld；用 free 释放
+double *dgemm_alloc_matrix(unsigned int rows, unsigned int cols, unsigned int *ld);
+
+// 同上，64 位的行数、列数和行距；大小溢出时返回 NULL
+double *dgemm_alloc_matrix_64(size_t rows, size_t cols, size_t *ld);
+
+// 行距会冲突时在 stderr 提示一次（dgemm_neon_auto 会调用；DGEMM_LD_WARN=0 关闭）
+void dgemm_ld_check(size_t m, size_t n, size_t p,
+                    size_t lda, size_t ldb, size_t ldc);
+
+/******************************************* ctx *******************************************/
+// dgemm_ctx_create 的选项（按位组合，0 为透明大页 + 预先缺页）
+#define M_BLAS_CTX_HUGETLB (1u << 0)    // 先尝试 MAP_HUGETLB（需要预留 hugetlbfs 页），失败退回透明大页
+#define M_BLAS_CTX_MLOCK   (1u << 1)    // mlock 打包缓冲区（受 RLIMIT_MEMLOCK 限制，失败不影响使用）
+
+// 上下文中的一个打包缓冲区
+typedef struct {
+    double *ptr;
+    size_t size;                // 字节，2MB 的倍数
+    size_t huge_bytes;          // 创建时由大页组成的字节数
+    int hugetlb;                // 来自 MAP_HUGETLB
+    int locked;                 // mlock 成功
+} m_blas_ctx_buffer;
+
+// 调用上下文：按 M_BLAS_PACK_SA_SIZE / M_BLAS_PACK_SB_SIZE 分配的 sa / sb，可用于所有 NEON 实现
+typedef struct {
+    m_blas_ctx_buffer sa;
+    m_blas_ctx_buffer sb;
+    unsigned int flags;
+} m_blas_ctx;
+
+// dgemm_ctx_stats 的结果
+typedef struct {
+    size_t bytes;               // sa + sb 的字节数
+    size_t huge_bytes;          // 其中当前由大页组成的字节数（来自 /proc/self/smaps）
+    int hugetlb;                // sa 和 sb 都来自 MAP_HUGETLB
+    int locked;                 // sa 和 sb 都已 mlock
+} m_blas_ctx_stats;
+
+// 创建 / 销毁上下文；缓冲区在创建时完成缺页，失败返回 NULL
+m_blas_ctx *dgemm_ctx_create(unsigned int flags);
+void dgemm_ctx_destroy(m_blas_ctx *ctx);
+
+// 查询打包缓冲区实际得到的大页与锁定情况
+void dgemm_ctx_stats(const m_blas_ctx *ctx, m_blas_ctx_stats *stats);
+
+/******************************************* pool *******************************************/
+// 常驻的工作窃取线程池（见 dgemm_pool.c）
+typedef struct m_blas_pool m_blas_pool;
+
+// dgemm_pool_run 执行的任务，index 为 [0, count) 中的任务下标
+typedef void (*m_blas_task_fn)(void *arg, size_t index);
+
+// 异步提交的完成回调
+typedef void (*m_blas_done_fn)(void *arg);
+
+// dgemm_pool_create 的选项
+#define M_BLAS_POOL_PIN (1u << 0)       // 工作线程依次绑定到进程允许的 CPU 上
+
+// threads 为参与计算的线程数（含调用者，即创建 threads - 1 个工作线程），失败返回 NULL；
+// 销毁时不能有正在进行的 dgemm_pool_run 或未完成的 dgemm_pool_submit
+m_blas_pool *dgemm_pool_create(unsigned int threads, unsigned int flags);
+void dgemm_pool_destroy(m_blas_pool *pool);
+
+// 参与计算的线程数
+unsigned int dgemm_pool_size(const m_blas_pool *pool);
+
+// 并行执行 fn(arg, 0) ... fn(arg, count - 1)，调用者参与计算，全部完成后返回；
+// 可以从多个线程同时调用，也可以在任务中嵌套调用
+void dgemm_pool_run(m_blas_pool *pool, size_t count, m_blas_task_fn fn, void *arg);
+
+// 把 fn(arg, 0) ... fn(arg, count - 1) 交给工作线程后立即返回，全部完成后由执行最后一个
+// 任务的线程调用 done(done_arg)（可以为 NULL）。有工作线程时任务从不在调用者中执行，
+// 队列满了也一样（放入溢出链表）；没有工作线程时在调用者中执行完（包括 done）再返回。成功返回 0，内存不足返回 -1（什么都不执行）
+int dgemm_pool_submit(m_blas_pool *pool, size_t count, m_blas_task_fn fn, void *arg,
+                      m_blas_done_fn done, void *done_arg);
+
+// 库内部使用的线程池：线程数取 m_blas_config.threads（0 为在线 CPU 数），绑定 CPU
+m_blas_pool *dgemm_pool_default(void);
+
+// 当前线程是否正在执行线程池的任务（驱动据此不再嵌套多线程）
+int dgemm_pool_in_task(void);
+
+// 驱动的多线程 OpenMP 区域开始 / 结束（可嵌套、可在多个线程中同时调用）；
+// 期间所有线程池的空闲工作线程不再自旋，直接睡眠，把 CPU 让给 OpenMP 线程
+void dgemm_pool_omp_begin(void);
+void dgemm_pool_omp_end(void);
+
 /******************************************* neon *******************************************/
 #ifdef __ARM_NEON
+
 //C(mxn) = A(mxp)*B(pxn)
 void dgemm_neon(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda, 
                                                                 double *b, unsigned int ldb,
                                                                 double *c, unsigned int ldc, 
                                                                 double *sa, double *sb);
+
+//C(mxn) = A(mxp)*B(pxn)，m/n/p 须为 4 的倍数
+void dgemm_neon_fast(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda,
+                                                                     double *b, unsigned int ldb,
+                                                                     double *c, unsigned int ldc,
+                                                                     double *sa, double *sb);
+
+//C(mxn) = A(mxp)*BT(pxn)，b 为 n x p 存储；m/n/p 须为 4 的倍数
+void dgemm_neon_fast_abt(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda,
+                                                                         double *b, unsigned int ldb,
+                                                                         double *c, unsigned int ldc,
+                                                                         double *sa, double *sb);
+
+//C(mxn) = A(mxp)*B(pxn)，不打包直接读取 A/B（中等规模、操作数在缓存中时更快）；
+//m/n 须为 4 的倍数，p 任意，sa/sb 不使用
+void dgemm_neon_direct(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda,
+                                                                       double *b, unsigned int ldb,
+                                                                       double *c, unsigned int ldc,
+                                                                       double *sa, double *sb);
+
+//C(mxn) = A(mxp)*B(pxn) + beta*C；beta = 0 时不读 C（C 可以是未初始化的内存），
+//m/n/p 须为 4 的倍数
+void dgemm_neon_fast_beta(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda,
+                                                                          double *b, unsigned int ldb,
+                                                                          double beta,
+                                                                          double *c, unsigned int ldc,
+                                                                          double *sa, double *sb);
+
+// dgemm_neon_fast 多线程时的划分方向
+typedef enum {
+    M_BLAS_SPLIT_AUTO = 0,      // 按形状选择 M x N 线程网格
+    M_BLAS_SPLIT_M,             // 只按行划分
+    M_BLAS_SPLIT_N,             // 只按列划分
+    M_BLAS_SPLIT_K              // 按 K 划分，各线程计算部分和后归约（m、n 小而 p 大时）
+} m_blas_split;
+
+// m_blas_threading.flags
+#define M_BLAS_THREAD_DETERMINISTIC (1u << 0)   // 按 K 划分时以固定的树形顺序归约（线程数相同时结果逐位一致）
+#define M_BLAS_THREAD_REPRODUCIBLE  (1u << 1)   // 可复现模式：结果与线程数无关（同 m_blas_config.reproducible）
+
+// 单次调用的多线程参数，各字段为 0 时使用配置 / 启发式
+typedef struct {
+    unsigned int threads;       // 线程数；指定时不再按工作量缩减
+    unsigned int split;         // m_blas_split
+    unsigned int min_flops;     // 每个线程至少分到的浮点运算数，0 为 m_blas_config.thread_min_flops
+    unsigned int flags;         // M_BLAS_THREAD_*
+} m_blas_threading;
+
+// dgemm_neon_fast 对 (m, n, p) 会使用的线程数与 gm x gn 线程网格（thr 可为 NULL）；
+// threads > 1 而 gm = gn = 1 表示按 K 划分
+void dgemm_threads_plan(size_t m, size_t n, size_t p, const m_blas_threading *thr,
+                        unsigned int *threads, unsigned int *gm, unsigned int *gn);
+
+//C(mxn) = A(mxp)*B(pxn)，thr 覆盖本次调用的多线程参数；m/n/p 须为 4 的倍数
+void dgemm_neon_fast_threads(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda,
+                                                                             double *b, unsigned int ldb,
+                                                                             double *c, unsigned int ldc,
+                                                                             double *sa, double *sb,
+                                                                             const m_blas_threading *thr);
+
+//同 dgemm_neon_direct，thr 覆盖本次调用的线程数与 min_flops（split 不使用），线程来自默认线程池
+void dgemm_neon_direct_threads(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda,
+                                                                               double *b, unsigned int ldb,
+                                                                               double *c, unsigned int ldc,
+                                                                               double *sa, double *sb,
+                                                                               const m_blas_threading *thr);
+
+//C(mxn) = AT(mxp)*B(pxn)，a 为 p x m 存储；m/n/p 须为 4 的倍数
+void dgemm_neon_fast_atb(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda,
+                                                                         double *b, unsigned int ldb,
+                                                                         double *c, unsigned int ldc,
+                                                                         double *sa, double *sb);
+
+// A 的打包（寄存器内转置）：每 4 / 8 行一组，组内按 k 交错存放；m 须为 4 / 8 的倍数，p 任意
+void packA_4_fast(unsigned int m, unsigned int p, double *from, size_t lda, double *to);
+void packA_8_fast(unsigned int m, unsigned int p, double *from, size_t lda, double *to);
+
+// 转置操作数的打包：按存储方向读取 A^T（p x m）/ B^T（n x p），输出与上面相同的打包布局
+void packA_4_fast_trans(unsigned int m, unsigned int p, double *from, size_t lda, double *to);
+void packB_4_fast_trans(unsigned int p, unsigned int n, double *from, size_t ldb, double *to);
+void packB_8_fast_trans(unsigned int p, unsigned int n, double *from, size_t ldb, double *to);
+
+//C(mxn) = A(mxp)*B(pxn)，小矩阵版本；任意 m/n/p 都能算对，但只对小形状快（大形状用 dgemm_neon_auto）；
+//sa/sb 可为 NULL（不打包）
+void dgemm_neon_small(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda,
+                                                                      double *b, unsigned int ldb,
+                                                                      double *c, unsigned int ldc,
+                                                                      double *sa, double *sb);
+
+/******************************************* auto *******************************************/
+// dgemm_neon_auto 选择的实现
+typedef enum {
+    M_BLAS_ROUTE_SMALL = 0,     // dgemm_neon_small
+    M_BLAS_ROUTE_NEON,          // dgemm_neon
+    M_BLAS_ROUTE_FAST,          // dgemm_neon_fast
+    M_BLAS_ROUTE_DIRECT,        // dgemm_neon_direct
+    M_BLAS_ROUTE_EDGE           // dgemm_neon_edge
+} m_blas_route;
+
+// 返回 (m, n, p) 会被分发到的实现
+m_blas_route dgemm_neon_auto_route(unsigned int m, unsigned int n, unsigned int p);
+
+//C(mxn) = A(mxp)*B(pxn)，按形状自动选择最快的实现
+void dgemm_neon_auto(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda,
+                                                                     double *b, unsigned int ldb,
+                                                                     double *c, unsigned int ldc,
+                                                                     double *sa, double *sb);
+
+//C(mxn) = A(mxp)*B(pxn)，m/n/p 不是 4 的倍数的大形状：对齐的主体走 dgemm_neon_auto，
+//余下不超过 3 的行、列和 k 尾部走 dgemm_neon_small
+void dgemm_neon_edge(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda,
+                                                                     double *b, unsigned int ldb,
+                                                                     double *c, unsigned int ldc,
+                                                                     double *sa, double *sb);
+
+//同 dgemm_neon_auto，使用上下文中的打包缓冲区
+void dgemm_neon_auto_ctx(m_blas_ctx *ctx, unsigned int m, unsigned int n, unsigned int p,
+                         double *a, unsigned int lda,
+                         double *b, unsigned int ldb,
+                         double *c, unsigned int ldc);
+
+/******************************************* ilp64 *******************************************/
+// 与上面同名接口相同，但尺寸和行距为 size_t：矩阵元素数或 ms * ldc 这类下标超过 2^32 时使用。
+// 32 位接口都是转发到这些函数的薄封装
+void dgemm_neon_64(size_t m, size_t n, size_t p, double *a, size_t lda,
+                                                 double *b, size_t ldb,
+                                                 double *c, size_t ldc,
+                                                 double *sa, double *sb);
+
+void dgemm_neon_fast_64(size_t m, size_t n, size_t p, double *a, size_t lda,
+                                                      double *b, size_t ldb,
+                                                      double *c, size_t ldc,
+                                                      double *sa, double *sb);
+
+void dgemm_neon_fast_abt_64(size_t m, size_t n, size_t p, double *a, size_t lda,
+                                                          double *b, size_t ldb,
+                                                          double *c, size_t ldc,
+                                                          double *sa, double *sb);
+
+void dgemm_neon_fast_atb_64(size_t m, size_t n, size_t p, double *a, size_t lda,
+                                                          double *b, size_t ldb,
+                                                          double *c, size_t ldc,
+                                                          double *sa, double *sb);
+
+void dgemm_neon_fast_beta_64(size_t m, size_t n, size_t p, double *a, size_t lda,
+                                                           double *b, size_t ldb,
+                                                           double beta,
+                                                           double *c, size_t ldc,
+                                                           double *sa, double *sb);
+
+void dgemm_neon_fast_threads_64(size_t m, size_t n, size_t p, double *a, size_t lda,
+                                                              double *b, size_t ldb,
+                                                              double *c, size_t ldc,
+                                                              double *sa, double *sb,
+                                                              const m_blas_threading *thr);
+
+void dgemm_neon_direct_64(size_t m, size_t n, size_t p, double *a, size_t lda,
+                                                        double *b, size_t ldb,
+                                                        double *c, size_t ldc,
+                                                        double *sa, double *sb);
+
+void dgemm_neon_direct_threads_64(size_t m, size_t n, size_t p, double *a, size_t lda,
+                                                                double *b, size_t ldb,
+                                                                double *c, size_t ldc,
+                                                                double *sa, double *sb,
+                                                                const m_blas_threading *thr);
+
+// 只有全部参数都不超过 UINT_MAX 时才会使用 JIT 内核
+void dgemm_neon_small_64(size_t m, size_t n, size_t p, double *a, size_t lda,
+                                                       double *b, size_t ldb,
+                                                       double *c, size_t ldc,
+                                                       double *sa, double *sb);
+
+m_blas_route dgemm_neon_auto_route_64(size_t m, size_t n, size_t p);
+
+void dgemm_neon_edge_64(size_t m, size_t n, size_t p, double *a, size_t lda,
+                                                      double *b, size_t ldb,
+                                                      double *c, size_t ldc,
+                                                      double *sa, double *sb);
+
+void dgemm_neon_auto_64(size_t m, size_t n, size_t p, double *a, size_t lda,
+                                                      double *b, size_t ldb,
+                                                      double *c, size_t ldc,
+                                                      double *sa, double *sb);
+
+void dgemm_neon_auto_ctx_64(m_blas_ctx *ctx, size_t m, size_t n, size_t p,
+                            double *a, size_t lda,
+                            double *b, size_t ldb,
+                            double *c, size_t ldc);
+
+/******************************************* batch *******************************************/
+// 批量 GEMM 中的一个乘法：C(mxn) += A(mxp)*B(pxn)
+typedef struct {
+    size_t m, n, p;
+    double *a;
+    size_t lda;
+    double *b;
+    size_t ldb;
+    double *c;
+    size_t ldc;
+} m_blas_gemm;
+
+// 并行执行 batch 中 count 个互不相关的乘法（每个按 dgemm_neon_auto_64 分发），全部完成后返回；
+// 打包缓冲区由库按线程分配
+void dgemm_neon_batch(const m_blas_gemm *batch, size_t count);
+
+// 同上，使用指定的线程池
+void dgemm_neon_batch_pool(m_blas_pool *pool, const m_blas_gemm *batch, size_t count);
+
+// 同 dgemm_neon_batch（每个乘法的路径、算法不变）；每个线程交错推进几个乘法，
+// 算一个乘法时已经预取了后面几个乘法的 A、B，适合操作数不在缓存中的大量小乘法
+void dgemm_neon_batch_interleaved(const m_blas_gemm *batch, size_t count);
+
+// 同上，使用指定的线程池
+void dgemm_neon_batch_interleaved_pool(m_blas_pool *pool, const m_blas_gemm *batch, size_t count);
+
+/******************************************* async *******************************************/
+// 一次异步提交（见 dgemm_batch.c）
+typedef struct m_blas_request m_blas_request;
+
+// 把一个乘法交给内部线程池后立即返回，A、B、C 在完成之前须保持有效，C 不能被读写。
+// 全部完成后在执行它的工作线程上调用 done(arg)（可以为 NULL），回调返回后请求才算完成；
+// 没有工作线程时在调用者中算完（包括回调）再返回。内存不足返回 NULL
+m_blas_request *dgemm_submit(const m_blas_gemm *g, m_blas_done_fn done, void *arg);
+
+// 同上，一次提交 batch 中 count 个互不相关的乘法（描述会被复制），全部完成算一次完成
+m_blas_request *dgemm_submit_batch(const m_blas_gemm *batch, size_t count,
+                                   m_blas_done_fn done, void *arg);
+
+// 同上，使用指定的线程池
+m_blas_request *dgemm_submit_batch_pool(m_blas_pool *pool, const m_blas_gemm *batch, size_t count,
+                                        m_blas_done_fn done, void *arg);
+
+// 已完成返回 1，否则 0，不阻塞
+int dgemm_poll(const m_blas_request *req);
+
+// 阻塞到完成（不能在该请求自己的回调中调用）
+void dgemm_wait(m_blas_request *req);
+
+// 调用者不再使用 req：已完成时立即释放，否则完成后自动释放。每个请求调用一次，
+// 之后不能再 poll / wait；只用回调的调用者可以在提交后马上调用
+void dgemm_release(m_blas_request *req);
 #endif
 
 #endif // M_DGEMM_BLAS_H
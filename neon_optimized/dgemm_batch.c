@@ -0,0 +1,378 @@
+#ifdef __ARM_NEON
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "blas_dgemm.h"
+
+/**
+ * ============================================================================
+ * 批量 GEMM：一次提交多个互不相关的乘法
+ * ============================================================================
+ *
+ * 每个乘法是线程池（dgemm_pool.c）中的一个任务，由 dgemm_neon_auto_64 按形状分发；
+ * 任务内不再嵌套多线程，并行度来自批内的多个乘法。
+ * 打包缓冲区每个线程一份，第一次用到时分配，线程退出时释放；分配失败时该线程上的乘法
+ * 改走不打包的路径（batch_gemm_unbuffered），照样算完。
+ * ============================================================================
+ */
+
+typedef struct {
+    double *sa;
+    double *sb;
+} batch_buffers;
+
+static pthread_key_t g_buf_key;
+static pthread_once_t g_buf_once = PTHREAD_ONCE_INIT;
+
+static void batch_buffers_free(void *p) {
+    batch_buffers *buf = (batch_buffers*)p;
+
+    free(buf->sa);
+    free(buf->sb);
+    free(buf);
+}
+
+static void batch_key_init(void) {
+    pthread_key_create(&g_buf_key, batch_buffers_free);
+}
+
+// 当前线程的 sa / sb，分配失败返回 NULL
+static batch_buffers *batch_thread_buffers(void) {
+    batch_buffers *buf;
+
+    pthread_once(&g_buf_once, batch_key_init);
+    buf = (batch_buffers*)pthread_getspecific(g_buf_key);
+    if (buf) {
+        return buf;
+    }
+    buf = (batch_buffers*)malloc(sizeof(batch_buffers));
+    if (!buf) {
+        return NULL;
+    }
+    buf->sa = (double*)aligned_alloc(64, M_BLAS_PACK_SA_SIZE * sizeof(double));
+    buf->sb = (double*)aligned_alloc(64, M_BLAS_PACK_SB_SIZE * sizeof(double));
+    if (!buf->sa || !buf->sb || pthread_setspecific(g_buf_key, buf) != 0) {
+        batch_buffers_free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+/**
+ * 打包缓冲区分配失败时的退路：4 对齐的主体走不打包的 dgemm_neon_direct，
+ * 其余行列走 dgemm_neon_small（sa/sb 为 NULL 时不打包）。
+ * 两者都从 C 装载累加器、按 k 顺序连续 FMA，结果与有缓冲区时逐位相同，只是慢一些
+ */
+static void batch_gemm_unbuffered(size_t m, size_t n, size_t p,
+                                  double *a, size_t lda,
+                                  double *b, size_t ldb,
+                                  double *c, size_t ldc) {
+    size_t m4 = m & ~(size_t)3, n4 = n & ~(size_t)3;
+
+    if (m4 && n4) {
+        dgemm_neon_direct_64(m4, n4, p, a, lda, b, ldb, c, ldc, NULL, NULL);
+    }
+    if (m4 && n4 < n) {
+        dgemm_neon_small_64(m4, n - n4, p, a, lda, b + n4, ldb, c + n4, ldc, NULL, NULL);
+    }
+    if (m4 < m) {
+        dgemm_neon_small_64(m - m4, n, p, a + m4 * lda, lda, b, ldb, c + m4 * ldc, ldc,
+                            NULL, NULL);
+    }
+}
+
+static void batch_task(void *arg, size_t index) {
+    const m_blas_gemm *g = (const m_blas_gemm*)arg + index;
+    batch_buffers *buf = batch_thread_buffers();
+
+    if (!buf) {
+        batch_gemm_unbuffered(g->m, g->n, g->p, g->a, g->lda, g->b, g->ldb, g->c, g->ldc);
+        return;
+    }
+    dgemm_neon_auto_64(g->m, g->n, g->p, g->a, g->lda, g->b, g->ldb, g->c, g->ldc,
+                       buf->sa, buf->sb);
+}
+
+void dgemm_neon_batch_pool(m_blas_pool *pool, const m_blas_gemm *batch, size_t count) {
+    dgemm_pool_run(pool, count, batch_task, (void*)batch);
+}
+
+void dgemm_neon_batch(const m_blas_gemm *batch, size_t count) {
+    dgemm_neon_batch_pool(dgemm_pool_default(), batch, count);
+}
+
+/**
+ * ============================================================================
+ * 交错执行的批量小乘法
+ * ============================================================================
+ *
+ * 操作数不在缓存中时，每个小乘法一开始都在等 A、B 从内存装入，计算单元空闲。
+ * 这里每个任务负责 BATCH_GROUP 个连续的乘法，同时推进其中 BATCH_WINDOW 个；
+ * 每个乘法是一个手写的协程（batch_coro 记下算到了哪个 k 块）：
+ *
+ * 1. 进入窗口时预取它的 C 和第一个 k 块的 A、B
+ * 2. 轮到它时算一个 k 块，预取下一个 k 块的 A、B，然后切换到窗口中的下一个乘法
+ * 3. 算完的乘法让出位置，由组中的下一个乘法补上
+ *
+ * 预取发出后要等窗口中其他乘法各算一个 k 块才用到，一个乘法的访存延迟与其他乘法的
+ * 计算重叠。预取到 L2（pldl2keep），窗口中几个乘法的操作数不必同时挤在 L1 中。
+ *
+ * 只有走 dgemm_neon_direct 的乘法在 k 块边界切换：直接路径的内核从 C 装载累加器、
+ * 按 k 顺序连续 FMA，按 k 块分段调用结果逐位不变。其他路径（小矩阵、打包）
+ * 一次算完，只得到提前预取的好处。每个乘法走的路径、算法都与 dgemm_neon_batch 相同。
+ * ============================================================================
+ */
+
+// 每个任务负责的乘法数
+#define BATCH_GROUP (8)
+
+// 每个线程同时推进的乘法数
+#define BATCH_WINDOW (4)
+
+// 直接路径每个 k 块的 A、B 大约多少字节
+#define BATCH_STEP_BYTES (8 * 1024)
+
+// 预取的步长（缓存行大小）
+#define BATCH_LINE (64)
+
+typedef struct {
+    const m_blas_gemm *batch;
+    size_t count;
+} batch_group;
+
+typedef struct {
+    const m_blas_gemm *g;
+    m_blas_route route;
+    size_t k;                   // 下一个 k 块的起点，等于 p 时已完成
+    size_t kb;                  // 每个 k 块的 k 数
+} batch_coro;
+
+// 预取从 x 开始的 rows 行、每行 cols 个 double（行距 ld），write 为 1 时按写预取
+static void batch_prefetch(const double *x, size_t rows, size_t cols, size_t ld, int write) {
+    size_t i, off, bytes = cols * sizeof(double);
+
+    if (bytes == 0) {
+        return;
+    }
+    for (i = 0; i < rows; i++) {
+        const char *row = (const char*)(x + i * ld);
+
+        // 行首不一定对齐到缓存行，最后一个字节单独预取
+        for (off = 0; off < bytes; off += BATCH_LINE) {
+            if (write) {
+                __builtin_prefetch(row + off, 1, 2);
+            } else {
+                __builtin_prefetch(row + off, 0, 2);
+            }
+        }
+        if (write) {
+            __builtin_prefetch(row + bytes - 1, 1, 2);
+        } else {
+            __builtin_prefetch(row + bytes - 1, 0, 2);
+        }
+    }
+}
+
+// 预取下一个 k 块的 A（m 行 x kb 列）与 B（kb 行 x n 列）
+static void coro_prefetch(const batch_coro *co) {
+    const m_blas_gemm *g = co->g;
+    size_t kb = co->kb < g->p - co->k ? co->kb : g->p - co->k;
+
+    batch_prefetch(g->a + co->k, g->m, kb, g->lda, 0);
+    batch_prefetch(g->b + co->k * g->ldb, kb, g->n, g->ldb, 0);
+}
+
+static void coro_start(batch_coro *co, const m_blas_gemm *g) {
+    co->g = g;
+    co->route = dgemm_neon_auto_route_64(g->m, g->n, g->p);
+    co->k = g->m && g->n ? 0 : g->p;
+    co->kb = g->p;
+    if (co->k == g->p) {
+        return;
+    }
+    if (co->route == M_BLAS_ROUTE_DIRECT) {
+        // 取 4 的倍数：直接路径的内核每次处理 2 个 k，分段处不会多出单独的奇数步
+        co->kb = (BATCH_STEP_BYTES / ((g->m + g->n) * sizeof(double))) & ~(size_t)3;
+        if (co->kb < 4) {
+            co->kb = 4;
+        }
+    }
+    if (co->route != M_BLAS_ROUTE_SMALL) {
+        dgemm_ld_check(g->m, g->n, g->p, g->lda, g->ldb, g->ldc);
+    }
+    batch_prefetch(g->c, g->m, g->n, g->ldc, 1);
+    coro_prefetch(co);
+}
+
+// 计算下一个 k 块，还有剩余时预取再下一个 k 块后返回（挂起）；sa 为 NULL 时不打包
+static void coro_step(batch_coro *co, double *sa, double *sb) {
+    const m_blas_gemm *g = co->g;
+    size_t kb = co->kb < g->p - co->k ? co->kb : g->p - co->k;
+    double *a = g->a + co->k, *b = g->b + co->k * g->ldb;
+
+    if (!sa) {
+        batch_gemm_unbuffered(g->m, g->n, kb, a, g->lda, b, g->ldb, g->c, g->ldc);
+    } else switch (co->route) {
+    case M_BLAS_ROUTE_NEON:
+        dgemm_neon_64(g->m, g->n, kb, a, g->lda, b, g->ldb, g->c, g->ldc, sa, sb);
+        break;
+    case M_BLAS_ROUTE_FAST:
+        dgemm_neon_fast_64(g->m, g->n, kb, a, g->lda, b, g->ldb, g->c, g->ldc, sa, sb);
+        break;
+    case M_BLAS_ROUTE_DIRECT:
+        dgemm_neon_direct_64(g->m, g->n, kb, a, g->lda, b, g->ldb, g->c, g->ldc, sa, sb);
+        break;
+    case M_BLAS_ROUTE_EDGE:
+        dgemm_neon_edge_64(g->m, g->n, kb, a, g->lda, b, g->ldb, g->c, g->ldc, sa, sb);
+        break;
+    default:
+        dgemm_neon_small_64(g->m, g->n, kb, a, g->lda, b, g->ldb, g->c, g->ldc, sa, sb);
+        break;
+    }
+    co->k += kb;
+    if (co->k < g->p) {
+        coro_prefetch(co);
+    }
+}
+
+static void batch_group_task(void *arg, size_t index) {
+    const batch_group *grp = (const batch_group*)arg;
+    size_t next = index * BATCH_GROUP;
+    size_t last = next + BATCH_GROUP < grp->count ? next + BATCH_GROUP : grp->count;
+    batch_coro window[BATCH_WINDOW];
+    unsigned int active = 0, i = 0;
+    batch_buffers *buf = batch_thread_buffers();
+    double *sa = buf ? buf->sa : NULL, *sb = buf ? buf->sb : NULL;
+
+    while (active < BATCH_WINDOW && next < last) {
+        coro_start(&window[active++], grp->batch + next++);
+    }
+    while (active > 0) {
+        batch_coro *co = &window[i];
+
+        if (co->k < co->g->p) {
+            coro_step(co, sa, sb);
+        }
+        if (co->k >= co->g->p) {
+            // 算完：组中的下一个乘法补上，没有了就把窗口中最后一个移过来
+            if (next < last) {
+                coro_start(co, grp->batch + next++);
+            } else {
+                *co = window[--active];
+            }
+        }
+        if (++i >= active) {
+            i = 0;
+        }
+    }
+}
+
+void dgemm_neon_batch_interleaved_pool(m_blas_pool *pool, const m_blas_gemm *batch, size_t count) {
+    batch_group grp = { batch, count };
+
+    dgemm_pool_run(pool, (count + BATCH_GROUP - 1) / BATCH_GROUP, batch_group_task, &grp);
+}
+
+void dgemm_neon_batch_interleaved(const m_blas_gemm *batch, size_t count) {
+    dgemm_neon_batch_interleaved_pool(dgemm_pool_default(), batch, count);
+}
+
+/**
+ * ============================================================================
+ * 异步提交：提交后立即返回，完成时回调，或用 dgemm_poll / dgemm_wait 查询
+ * ============================================================================
+ *
+ * 请求复制乘法的描述，用 dgemm_pool_submit 交给线程池，每个乘法一个任务（与批量 GEMM 相同，
+ * 任务内单线程计算）。算完最后一个乘法的工作线程先调用用户的回调，再置完成标志、唤醒 dgemm_wait。
+ * 请求有两个引用：调用者（dgemm_release 时放弃）和线程池（完成时放弃），后放弃的一方释放。
+ *
+ * 单个大乘法只在一个工作线程上计算；要用上多个核，可以把 C 按行拆成几个乘法，
+ * 用 dgemm_submit_batch 一起提交。
+ * ============================================================================
+ */
+
+struct m_blas_request {
+    m_blas_done_fn done;
+    void *arg;
+    atomic_int finished;
+    atomic_int refs;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    m_blas_gemm batch[];
+};
+
+static void request_unref(m_blas_request *req) {
+    if (atomic_fetch_sub(&req->refs, 1) == 1) {
+        pthread_mutex_destroy(&req->lock);
+        pthread_cond_destroy(&req->cond);
+        free(req);
+    }
+}
+
+// 线程池在最后一个乘法完成后调用
+static void request_done(void *arg) {
+    m_blas_request *req = (m_blas_request*)arg;
+
+    if (req->done) {
+        req->done(req->arg);
+    }
+    pthread_mutex_lock(&req->lock);
+    atomic_store(&req->finished, 1);
+    pthread_cond_broadcast(&req->cond);
+    pthread_mutex_unlock(&req->lock);
+    request_unref(req);
+}
+
+m_blas_request *dgemm_submit_batch_pool(m_blas_pool *pool, const m_blas_gemm *batch, size_t count,
+                                        m_blas_done_fn done, void *arg) {
+    m_blas_request *req = (m_blas_request*)malloc(sizeof(m_blas_request) + count * sizeof(m_blas_gemm));
+
+    if (!req) {
+        return NULL;
+    }
+    req->done = done;
+    req->arg = arg;
+    atomic_init(&req->finished, 0);
+    atomic_init(&req->refs, 2);
+    pthread_mutex_init(&req->lock, NULL);
+    pthread_cond_init(&req->cond, NULL);
+    memcpy(req->batch, batch, count * sizeof(m_blas_gemm));
+    if (dgemm_pool_submit(pool, count, batch_task, req->batch, request_done, req) != 0) {
+        pthread_mutex_destroy(&req->lock);
+        pthread_cond_destroy(&req->cond);
+        free(req);
+        return NULL;
+    }
+    return req;
+}
+
+m_blas_request *dgemm_submit_batch(const m_blas_gemm *batch, size_t count,
+                                   m_blas_done_fn done, void *arg) {
+    return dgemm_submit_batch_pool(dgemm_pool_default(), batch, count, done, arg);
+}
+
+m_blas_request *dgemm_submit(const m_blas_gemm *g, m_blas_done_fn done, void *arg) {
+    return dgemm_submit_batch(g, 1, done, arg);
+}
+
+int dgemm_poll(const m_blas_request *req) {
+    return atomic_load(&req->finished);
+}
+
+void dgemm_wait(m_blas_request *req) {
+    pthread_mutex_lock(&req->lock);
+    while (!atomic_load(&req->finished)) {
+        pthread_cond_wait(&req->cond, &req->lock);
+    }
+    pthread_mutex_unlock(&req->lock);
+}
+
+void dgemm_release(m_blas_request *req) {
+    if (req) {
+        request_unref(req);
+    }
+}
+
+#endif
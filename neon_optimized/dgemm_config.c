@@ -0,0 +1,822 @@
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "blas_dgemm.h"
+
+/**
+ * ============================================================================
+ * 运行时分块 / 预取配置与自动调优
+ * ============================================================================
+ *
+ * GEMM_M / GEMM_N / GEMM_P 原本是按 rk3399 缓存大小定下的宏，
+ * FT2000Q（每 2 核共享 2MB L2）、A72、x86 主机的缓存各不相同。这里：
+ *
+ * 1. 从 /sys/devices/system/cpu/cpu0/cache/index* 读取各级缓存大小与共享 CPU 数
+ * 2. 按 GotoBLAS 的思路推导搜索起点：
+ *      kc - 一个 4 行 A 微面板 + 一个 8 列 B 微面板占 L1d 的一半
+ *      nc - 打包后的 B 块（kc x nc）占每核 L2 份额的一半
+ *      mc - 打包后的 A 块（mc x kc）占每核 L3 份额的一半；没有 L3 时 A 块本来
+ *           就从内存流式读入，保持默认值
+ * 3. dgemm_autotune 在起点附近逐个参数计时搜索（坐标下降），再实测不打包路径
+ *    （dgemm_neon_direct）与打包路径的交叉点、单线程与多线程的交叉点，结果写入配置文件
+ * 4. 首次调用 dgemm_config_get 时加载配置文件，驱动每次调用读取当前配置
+ *
+ * 发布出去的配置不再修改：dgemm_config_set 复制一份新的，原子地替换指针。驱动每次调用
+ * 只取一次指针并向下传递，运行中的调用始终看到一份完整的配置（gemm_m 与 gemm_p 不会
+ * 一个新一个旧）。被替换的配置不释放，正在运行的调用可能还在用；每份几十字节，
+ * dgemm_config_set 只在初始化、调优时调用。
+ *
+ * 配置文件为 key=value 文本，'#' 开头为注释，未出现的键保持默认值。
+ * 预取策略还可以用环境变量 DGEMM_PREFETCH 临时覆盖（优先于配置文件），
+ * 例如 DGEMM_PREFETCH=l2strm 或 DGEMM_PREFETCH=l1keep,512,768,512。
+ * 线程数同样可以用 DGEMM_THREADS 覆盖。
+ * 缓存与 CPU 拓扑读取的 sysfs 目录可以用 DGEMM_SYSFS_CPU 指向一份假的目录树
+ * （测试用，见 ft2000q_neon_small/check.c）。
+ * ============================================================================
+ */
+
+#define CONFIG_DEFAULT_PATH "dgemm_tune.conf"
+
+static const char *const prefetch_names[M_BLAS_PREFETCH_COUNT] = {
+    "none", "l1keep", "l1strm", "l2keep", "l2strm"
+};
+
+static m_blas_config g_config_initial;
+static _Atomic(const m_blas_config *) g_config;
+static pthread_once_t g_config_once = PTHREAD_ONCE_INIT;
+
+void dgemm_config_default(m_blas_config *cfg) {
+    cfg->gemm_m = 2048;
+    cfg->gemm_n = 256;
+    cfg->gemm_p = 128;
+    cfg->prefetch_a = 768;
+    cfg->prefetch_b = 1024;
+    cfg->prefetch_4x4 = 640;
+    cfg->prefetch_type = M_BLAS_PREFETCH_L1KEEP;
+    cfg->direct_max_mnp = 0;    // 未测量；config_init 按缓存推导
+    cfg->stream_c_bytes = 0;    // 同上
+    cfg->threads = 0;           // OpenMP 默认线程数
+    // 每个线程至少 48^3 规模的工作（A72 单核约 60us，OpenMP 区域开销的十倍以上）；
+    // dgemm_autotune 实测单线程与多线程的交叉点后改写
+    cfg->thread_min_flops = 2 * 48 * 48 * 48;
+    cfg->reproducible = 0;
+}
+
+const char *dgemm_prefetch_name(unsigned int type) {
+    return type < M_BLAS_PREFETCH_COUNT ? prefetch_names[type] : "unknown";
+}
+
+int dgemm_prefetch_parse(const char *name) {
+    int i;
+
+    for (i = 0; i < M_BLAS_PREFETCH_COUNT; i++) {
+        if (strcmp(name, prefetch_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static unsigned int round_down(unsigned int x, unsigned int align) {
+    return x / align * align;
+}
+
+void dgemm_config_clamp(m_blas_config *cfg) {
+    // kc：4 的倍数，不超过缓冲区按 M_BLAS_CONFIG_MAX_P 设计的上限
+    cfg->gemm_p = round_down(cfg->gemm_p, 4);
+    if (cfg->gemm_p < 16) {
+        cfg->gemm_p = 16;
+    }
+    if (cfg->gemm_p > M_BLAS_CONFIG_MAX_P) {
+        cfg->gemm_p = M_BLAS_CONFIG_MAX_P;
+    }
+
+    // nc：8 的倍数（走 4x8 内核），kc * nc 不超过 sb
+    if (cfg->gemm_n > M_BLAS_PACK_SB_SIZE / cfg->gemm_p) {
+        cfg->gemm_n = M_BLAS_PACK_SB_SIZE / cfg->gemm_p;
+    }
+    cfg->gemm_n = round_down(cfg->gemm_n, 8);
+    if (cfg->gemm_n < 16) {
+        cfg->gemm_n = 16;
+    }
+
+    // mc：4 的倍数，mc * kc 不超过 sa
+    if (cfg->gemm_m > M_BLAS_PACK_SA_SIZE / cfg->gemm_p) {
+        cfg->gemm_m = M_BLAS_PACK_SA_SIZE / cfg->gemm_p;
+    }
+    cfg->gemm_m = round_down(cfg->gemm_m, 4);
+    if (cfg->gemm_m < 16) {
+        cfg->gemm_m = 16;
+    }
+
+    // 预取距离：8 字节对齐，最多 4KB
+    cfg->prefetch_a = round_down(cfg->prefetch_a > 4096 ? 4096 : cfg->prefetch_a, 8);
+    cfg->prefetch_b = round_down(cfg->prefetch_b > 4096 ? 4096 : cfg->prefetch_b, 8);
+    cfg->prefetch_4x4 = round_down(cfg->prefetch_4x4 > 4096 ? 4096 : cfg->prefetch_4x4, 8);
+    if (cfg->prefetch_type >= M_BLAS_PREFETCH_COUNT) {
+        cfg->prefetch_type = M_BLAS_PREFETCH_L1KEEP;
+    }
+
+    if (cfg->threads > M_BLAS_CONFIG_MAX_THREADS) {
+        cfg->threads = M_BLAS_CONFIG_MAX_THREADS;
+    }
+    cfg->reproducible = cfg->reproducible != 0;
+}
+
+/* ========== 配置文件 ========== */
+
+int dgemm_config_load(const char *path, m_blas_config *cfg) {
+    FILE *fp = fopen(path, "r");
+    char line[256];
+
+    if (!fp) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char key[64], text[64];
+        unsigned int value;
+
+        if (line[0] == '#' || sscanf(line, " %63[a-z0-9_] = %63s", key, text) != 2) {
+            continue;
+        }
+        value = (unsigned int)strtoul(text, NULL, 10);
+        if (strcmp(key, "gemm_m") == 0) {
+            cfg->gemm_m = value;
+        } else if (strcmp(key, "gemm_n") == 0) {
+            cfg->gemm_n = value;
+        } else if (strcmp(key, "gemm_p") == 0) {
+            cfg->gemm_p = value;
+        } else if (strcmp(key, "prefetch_a") == 0) {
+            cfg->prefetch_a = value;
+        } else if (strcmp(key, "prefetch_b") == 0) {
+            cfg->prefetch_b = value;
+        } else if (strcmp(key, "prefetch_4x4") == 0) {
+            cfg->prefetch_4x4 = value;
+        } else if (strcmp(key, "direct_max_mnp") == 0) {
+            cfg->direct_max_mnp = value;
+        } else if (strcmp(key, "stream_c_bytes") == 0) {
+            cfg->stream_c_bytes = value;
+        } else if (strcmp(key, "threads") == 0) {
+            cfg->threads = value;
+        } else if (strcmp(key, "thread_min_flops") == 0) {
+            cfg->thread_min_flops = value;
+        } else if (strcmp(key, "reproducible") == 0) {
+            cfg->reproducible = value;
+        } else if (strcmp(key, "prefetch_type") == 0 && dgemm_prefetch_parse(text) >= 0) {
+            cfg->prefetch_type = (unsigned int)dgemm_prefetch_parse(text);
+        }
+    }
+    fclose(fp);
+    dgemm_config_clamp(cfg);
+    return 0;
+}
+
+int dgemm_config_save(const char *path, const m_blas_config *cfg) {
+    FILE *fp = fopen(path, "w");
+
+    if (!fp) {
+        return -1;
+    }
+    fprintf(fp, "# dgemm 分块与预取配置（dgemm_autotune 生成）\n");
+    fprintf(fp, "gemm_m = %u\n", cfg->gemm_m);
+    fprintf(fp, "gemm_n = %u\n", cfg->gemm_n);
+    fprintf(fp, "gemm_p = %u\n", cfg->gemm_p);
+    fprintf(fp, "prefetch_a = %u\n", cfg->prefetch_a);
+    fprintf(fp, "prefetch_b = %u\n", cfg->prefetch_b);
+    fprintf(fp, "prefetch_4x4 = %u\n", cfg->prefetch_4x4);
+    fprintf(fp, "prefetch_type = %s\n", dgemm_prefetch_name(cfg->prefetch_type));
+    fprintf(fp, "direct_max_mnp = %u\n", cfg->direct_max_mnp);
+    fprintf(fp, "stream_c_bytes = %u\n", cfg->stream_c_bytes);
+    fprintf(fp, "threads = %u\n", cfg->threads);
+    fprintf(fp, "thread_min_flops = %u\n", cfg->thread_min_flops);
+    fprintf(fp, "reproducible = %u\n", cfg->reproducible);
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+// DGEMM_PREFETCH="类型[,A 距离,B 距离[,4x4 距离]]"，省略的距离保持不变
+static void config_apply_prefetch_env(m_blas_config *cfg) {
+    const char *env = getenv("DGEMM_PREFETCH");
+    char name[16];
+    unsigned int dist[3];
+    int type, n;
+
+    if (!env || sscanf(env, " %15[a-z0-9]", name) != 1) {
+        return;
+    }
+    type = dgemm_prefetch_parse(name);
+    if (type < 0) {
+        fprintf(stderr, "dgemm: 忽略未知的 DGEMM_PREFETCH 类型 \"%s\"\n", name);
+        return;
+    }
+    cfg->prefetch_type = (unsigned int)type;
+
+    n = sscanf(env, " %*[a-z0-9] , %u , %u , %u", &dist[0], &dist[1], &dist[2]);
+    if (n >= 2) {
+        cfg->prefetch_a = dist[0];
+        cfg->prefetch_b = dist[1];
+    }
+    if (n >= 3) {
+        cfg->prefetch_4x4 = dist[2];
+    }
+    dgemm_config_clamp(cfg);
+}
+
+// DGEMM_THREADS=线程数，0 为 OpenMP 默认
+static void config_apply_threads_env(m_blas_config *cfg) {
+    const char *env = getenv("DGEMM_THREADS");
+    char *end;
+    unsigned long value;
+
+    if (!env || !*env) {
+        return;
+    }
+    value = strtoul(env, &end, 10);
+    if (*end != '\0') {
+        fprintf(stderr, "dgemm: 忽略无效的 DGEMM_THREADS \"%s\"\n", env);
+        return;
+    }
+    cfg->threads = (unsigned int)(value > M_BLAS_CONFIG_MAX_THREADS ? M_BLAS_CONFIG_MAX_THREADS : value);
+}
+
+// DGEMM_REPRODUCIBLE=1 打开可复现模式，0 关闭
+static void config_apply_reproducible_env(m_blas_config *cfg) {
+    const char *env = getenv("DGEMM_REPRODUCIBLE");
+
+    if (!env || !*env) {
+        return;
+    }
+    if (strcmp(env, "0") != 0 && strcmp(env, "1") != 0) {
+        fprintf(stderr, "dgemm: 忽略无效的 DGEMM_REPRODUCIBLE \"%s\"\n", env);
+        return;
+    }
+    cfg->reproducible = env[0] == '1';
+}
+
+static unsigned int direct_from_cache(const m_blas_cache_info *info);
+static unsigned int stream_from_cache(const m_blas_cache_info *info);
+
+static void config_init(void) {
+    const char *path = getenv("DGEMM_CONFIG");
+    m_blas_cache_info info;
+
+    m_blas_config *cfg = &g_config_initial;
+
+    dgemm_config_default(cfg);
+    if (dgemm_cache_info(&info) == 0) {
+        cfg->direct_max_mnp = direct_from_cache(&info);
+        cfg->stream_c_bytes = stream_from_cache(&info);
+    }
+    dgemm_config_load(path ? path : CONFIG_DEFAULT_PATH, cfg);
+    config_apply_prefetch_env(cfg);
+    config_apply_threads_env(cfg);
+    config_apply_reproducible_env(cfg);
+    atomic_store_explicit(&g_config, cfg, memory_order_release);
+}
+
+const m_blas_config *dgemm_config_get(void) {
+    pthread_once(&g_config_once, config_init);
+    return atomic_load_explicit(&g_config, memory_order_acquire);
+}
+
+void dgemm_config_set(const m_blas_config *cfg) {
+    m_blas_config *next = (m_blas_config*)malloc(sizeof(m_blas_config));
+
+    pthread_once(&g_config_once, config_init);
+    // 内存不足时保持原配置
+    if (!next) {
+        return;
+    }
+    *next = *cfg;
+    dgemm_config_clamp(next);
+    atomic_store_explicit(&g_config, next, memory_order_release);
+}
+
+/* ========== 缓存拓扑 ========== */
+
+#define SYSFS_CPU_DIR "/sys/devices/system/cpu"
+
+// 读取 sysfs 中 cpu 目录下 fmt 指定的文件的第一行，成功返回 0
+static int read_sysfs(char *buf, size_t len, const char *fmt, ...) {
+    const char *dir = getenv("DGEMM_SYSFS_CPU");
+    char path[512];
+    size_t head;
+    va_list ap;
+    FILE *fp;
+
+    head = (size_t)snprintf(path, sizeof(path), "%s/", dir && dir[0] ? dir : SYSFS_CPU_DIR);
+    if (head >= sizeof(path)) {
+        return -1;
+    }
+    va_start(ap, fmt);
+    vsnprintf(path + head, sizeof(path) - head, fmt, ap);
+    va_end(ap);
+
+    fp = fopen(path, "r");
+
+    if (!fp) {
+        return -1;
+    }
+    if (!fgets(buf, (int)len, fp)) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+// "32K" / "2048K" / "2M" -> 字节
+static unsigned int parse_size(const char *s) {
+    char *end;
+    unsigned long v = strtoul(s, &end, 10);
+
+    if (*end == 'K' || *end == 'k') {
+        v <<= 10;
+    } else if (*end == 'M' || *end == 'm') {
+        v <<= 20;
+    }
+    return (unsigned int)v;
+}
+
+// "0-1" / "0,2,4-5" -> CPU 个数；out 不为 NULL 时依次写入前 max 个 CPU 号
+static unsigned int parse_cpu_list(const char *s, unsigned int *out, unsigned int max) {
+    unsigned int count = 0;
+
+    while (*s) {
+        char *end;
+        unsigned long lo = strtoul(s, &end, 10), hi = lo, cpu;
+
+        if (end == s) {
+            break;
+        }
+        if (*end == '-') {
+            s = end + 1;
+            hi = strtoul(s, &end, 10);
+        }
+        for (cpu = lo; out && cpu <= hi && count + (cpu - lo) < max; cpu++) {
+            out[count + (cpu - lo)] = (unsigned int)cpu;
+        }
+        count += (unsigned int)(hi - lo + 1);
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+static unsigned int count_cpu_list(const char *s) {
+    return parse_cpu_list(s, NULL, 0);
+}
+
+int dgemm_cache_info(m_blas_cache_info *info) {
+    char buf[128];
+    int index, found = 0;
+
+    memset(info, 0, sizeof(*info));
+    for (index = 0; index < 8; index++) {
+        unsigned int level, size, shared = 1;
+
+        if (read_sysfs(buf, sizeof(buf), "cpu0/cache/index%d/level", index) != 0) {
+            break;
+        }
+        level = (unsigned int)atoi(buf);
+
+        if (read_sysfs(buf, sizeof(buf), "cpu0/cache/index%d/type", index) != 0 ||
+            strcmp(buf, "Instruction") == 0) {
+            continue;
+        }
+
+        if (read_sysfs(buf, sizeof(buf), "cpu0/cache/index%d/size", index) != 0) {
+            continue;
+        }
+        size = parse_size(buf);
+
+        if (read_sysfs(buf, sizeof(buf), "cpu0/cache/index%d/shared_cpu_list", index) == 0 &&
+            count_cpu_list(buf) > 0) {
+            shared = count_cpu_list(buf);
+        }
+
+        if (level == 1) {
+            info->l1d_size = size;
+        } else if (level == 2) {
+            info->l2_size = size;
+            info->l2_shared = shared;
+        } else if (level == 3) {
+            info->l3_size = size;
+            info->l3_shared = shared;
+        }
+        found = 1;
+    }
+    return found ? 0 : -1;
+}
+
+/* ========== CPU 拓扑 ========== */
+
+/**
+ * FT2000Q 每 2 个核共享一个 L2，rk3399 是 2 个 A72 + 4 个 A53（cpu_capacity 1024 / 约 450）。
+ * 调度需要知道每个 CPU 属于哪个 L2 簇、有多快：
+ *
+ * 1. L2 簇：cpuN/cache/index* 中 level 为 2 的 shared_cpu_list，以其中第一个 CPU 标识
+ * 2. 容量：cpuN/cpu_capacity（只有异构系统的内核提供，读不到按 1024）
+ *
+ * 在线 CPU 按 (容量降序, 簇, CPU 号) 排序，同一簇的 CPU 相邻。
+ */
+
+typedef struct {
+    unsigned int cpu;
+    unsigned int leader;        // 所在 L2 簇的第一个 CPU
+    unsigned int capacity;
+} topo_cpu;
+
+static m_blas_topology g_topology;
+static pthread_once_t g_topology_once = PTHREAD_ONCE_INIT;
+
+// cpu 所在 L2 簇的第一个 CPU，读不到返回 0（都当作同一簇）
+static unsigned int topo_l2_leader(unsigned int cpu) {
+    char buf[256];
+    unsigned int first;
+    int index;
+
+    for (index = 0; index < 8; index++) {
+        if (read_sysfs(buf, sizeof(buf), "cpu%u/cache/index%d/level", cpu, index) != 0) {
+            break;
+        }
+        if (atoi(buf) != 2) {
+            continue;
+        }
+        if (read_sysfs(buf, sizeof(buf), "cpu%u/cache/index%d/type", cpu, index) != 0 ||
+            strcmp(buf, "Instruction") == 0) {
+            continue;
+        }
+        if (read_sysfs(buf, sizeof(buf), "cpu%u/cache/index%d/shared_cpu_list", cpu, index) == 0 &&
+            parse_cpu_list(buf, &first, 1) > 0) {
+            return first;
+        }
+    }
+    return 0;
+}
+
+static int topo_compare(const void *pa, const void *pb) {
+    const topo_cpu *a = (const topo_cpu*)pa, *b = (const topo_cpu*)pb;
+
+    if (a->capacity != b->capacity) {
+        return a->capacity > b->capacity ? -1 : 1;
+    }
+    if (a->leader != b->leader) {
+        return a->leader < b->leader ? -1 : 1;
+    }
+    return a->cpu < b->cpu ? -1 : a->cpu > b->cpu;
+}
+
+static void topology_init(void) {
+    m_blas_topology *topo = &g_topology;
+    static topo_cpu cpus[M_BLAS_TOPO_MAX_CPUS];
+    unsigned int ids[M_BLAS_TOPO_MAX_CPUS];
+    char buf[1024];
+    unsigned int i, n, singles = 1;
+
+    n = 0;
+    if (read_sysfs(buf, sizeof(buf), "online") == 0) {
+        n = parse_cpu_list(buf, ids, M_BLAS_TOPO_MAX_CPUS);
+    }
+    if (n == 0) {
+        ids[0] = 0;
+        n = 1;
+    }
+    n = n > M_BLAS_TOPO_MAX_CPUS ? M_BLAS_TOPO_MAX_CPUS : n;
+
+    for (i = 0; i < n; i++) {
+        cpus[i].cpu = ids[i];
+        cpus[i].leader = topo_l2_leader(ids[i]);
+        cpus[i].capacity = read_sysfs(buf, sizeof(buf), "cpu%u/cpu_capacity", ids[i]) == 0 &&
+                           atoi(buf) > 0 ?
+                           (unsigned int)atoi(buf) : 1024;
+    }
+    qsort(cpus, n, sizeof(cpus[0]), topo_compare);
+
+    topo->ncpus = n;
+    topo->nclusters = 0;
+    topo->uniform = 1;
+    for (i = 0; i < n; i++) {
+        if (i == 0 || cpus[i].leader != cpus[i - 1].leader || cpus[i].capacity != cpus[i - 1].capacity) {
+            topo->nclusters++;
+        } else {
+            singles = 0;
+        }
+        if (cpus[i].capacity != cpus[0].capacity) {
+            topo->uniform = 0;
+        }
+        topo->cpu[i] = (unsigned short)cpus[i].cpu;
+        topo->cluster[i] = (unsigned short)(topo->nclusters - 1);
+        topo->capacity[i] = (unsigned short)cpus[i].capacity;
+    }
+    if (topo->nclusters > 1 && !singles) {
+        topo->uniform = 0;
+    }
+}
+
+const m_blas_topology *dgemm_cpu_topology(void) {
+    pthread_once(&g_topology_once, topology_init);
+    return &g_topology;
+}
+
+int dgemm_topology_current(void) {
+    const m_blas_topology *topo = dgemm_cpu_topology();
+    int cpu = sched_getcpu();
+    unsigned int i;
+
+    for (i = 0; cpu >= 0 && i < topo->ncpus; i++) {
+        if (topo->cpu[i] == (unsigned int)cpu) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// 不打包的上限：A、B、C（按 s x s x s 估计）一起放进每核 L2 的一半，s 取 8 的倍数
+static unsigned int direct_from_cache(const m_blas_cache_info *info) {
+    unsigned int l2 = info->l2_size ? info->l2_size / (info->l2_shared ? info->l2_shared : 1)
+                                    : 512 * 1024;
+    unsigned int s = 8;
+
+    while (3 * (s + 8) * (s + 8) * sizeof(double) <= l2 / 2 && s < 256) {
+        s += 8;
+    }
+    return s * s * s;
+}
+
+// 非临时存储的下限：比最后一级缓存还大的 C 写回后也留不住，不必占用缓存
+static unsigned int stream_from_cache(const m_blas_cache_info *info) {
+    return info->l3_size ? info->l3_size : info->l2_size;
+}
+
+void dgemm_config_from_cache(const m_blas_cache_info *info, m_blas_config *cfg) {
+    unsigned int l1 = info->l1d_size ? info->l1d_size : 32 * 1024;
+    unsigned int l2 = info->l2_size ? info->l2_size / (info->l2_shared ? info->l2_shared : 1)
+                                    : 512 * 1024;
+    unsigned int l3 = info->l3_size ? info->l3_size / (info->l3_shared ? info->l3_shared : 1)
+                                    : 0;
+    unsigned int kc;
+
+    dgemm_config_default(cfg);
+
+    // kc：(4 + 8) * kc 个 double 占 L1d 的一半，取不超过它的 2 的幂
+    kc = (l1 / 2) / ((4 + 8) * sizeof(double));
+    cfg->gemm_p = 16;
+    while (cfg->gemm_p * 2 <= kc) {
+        cfg->gemm_p *= 2;
+    }
+
+    // nc：kc x nc 的 B 块占每核 L2 的一半
+    cfg->gemm_n = (l2 / 2) / (cfg->gemm_p * sizeof(double));
+
+    // mc：mc x kc 的 A 块占每核 L3 的一半
+    if (l3 > l2) {
+        cfg->gemm_m = (l3 / 2) / (cfg->gemm_p * sizeof(double));
+    }
+
+    cfg->direct_max_mnp = direct_from_cache(info);
+    cfg->stream_c_bytes = stream_from_cache(info);
+
+    dgemm_config_clamp(cfg);
+}
+
+/* ========== 自动调优 ========== */
+
+#ifdef __ARM_NEON
+
+#define TUNE_REPEAT (3)
+
+// 按成员偏移访问 m_blas_config 中的一个参数
+#define CONFIG_FIELD(cfg, off) (*(unsigned int*)((char*)(cfg) + (off)))
+
+static double tune_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef void (*tune_gemm_fn)(unsigned int m, unsigned int n, unsigned int p,
+                             double *a, unsigned int lda, double *b, unsigned int ldb,
+                             double *c, unsigned int ldc, double *sa, double *sb);
+
+// size^3 上单次调用 fn 的时间（秒）：每批重复到至少 1ms，取 TUNE_REPEAT 批中最短的
+static double tune_time(tune_gemm_fn fn, unsigned int size,
+                        double *a, double *b, double *c, double *sa, double *sb) {
+    unsigned int reps = 1, i;
+    double best = 1e30;
+    int r;
+
+    fn(size, size, size, a, size, b, size, c, size, sa, sb);  // 预热
+    for (;;) {
+        double t = tune_now();
+        for (i = 0; i < reps; i++) {
+            fn(size, size, size, a, size, b, size, c, size, sa, sb);
+        }
+        if (tune_now() - t >= 1e-3 || reps >= (1u << 16)) {
+            break;
+        }
+        reps *= 2;
+    }
+
+    for (r = 0; r < TUNE_REPEAT; r++) {
+        double t = tune_now();
+        for (i = 0; i < reps; i++) {
+            fn(size, size, size, a, size, b, size, c, size, sa, sb);
+        }
+        t = (tune_now() - t) / reps;
+        if (t < best) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+// 用 cfg 运行 dgemm_neon_fast，返回单次调用的最短时间（秒）
+static double tune_measure(const m_blas_config *cfg, unsigned int size,
+                           double *a, double *b, double *c, double *sa, double *sb) {
+    dgemm_config_set(cfg);
+    return tune_time(dgemm_neon_fast, size, a, b, c, sa, sb);
+}
+
+// 不打包路径的交叉点：从小到大比较 dgemm_neon_direct 与 dgemm_neon_fast，
+// 连续两个规模打包更快即停止，返回最后一个不打包更快的规模的 m*n*p
+static unsigned int tune_direct_crossover(unsigned int max_size, double *a, double *b, double *c,
+                                          double *sa, double *sb) {
+    unsigned int s, last = 0;
+    int losses = 0;
+
+    for (s = 16; s <= max_size && s <= 256; s += 8) {
+        double t_direct = tune_time(dgemm_neon_direct, s, a, b, c, sa, sb);
+        double t_packed = tune_time(dgemm_neon_fast, s, a, b, c, sa, sb);
+
+        if (t_direct < t_packed) {
+            last = s;
+            losses = 0;
+        } else if (++losses >= 2) {
+            break;
+        }
+    }
+    return last * last * last;
+}
+
+// 多线程的交叉点：从小到大比较单线程与全部线程（不限制工作量）的 dgemm_neon_fast，
+// 连续两个规模多线程更快即停止，返回从该规模起才分给多个线程的阈值（每个线程的浮点运算数）；
+// 只有一个线程可用时保持 cfg 中的值
+static unsigned int tune_thread_crossover(m_blas_config *cfg, unsigned int max_size,
+                                          double *a, double *b, double *c,
+                                          double *sa, double *sb) {
+    m_blas_config single = *cfg, multi = *cfg;
+    unsigned int s, threads, gm, gn, wins = 0;
+
+    single.threads = 1;
+    multi.thread_min_flops = 0;
+    dgemm_config_set(&multi);
+    dgemm_threads_plan(max_size, max_size, max_size, NULL, &threads, &gm, &gn);
+    if (threads <= 1) {
+        return cfg->thread_min_flops;
+    }
+
+    for (s = 16; s <= max_size && s <= 256; s += 16) {
+        double t_single = tune_measure(&single, s, a, b, c, sa, sb);
+        double t_multi = tune_measure(&multi, s, a, b, c, sa, sb);
+
+        if (t_multi >= t_single) {
+            wins = 0;
+        } else if (++wins >= 2) {
+            // 上一个规模起多线程更快
+            s -= 16;
+            dgemm_threads_plan(s, s, s, NULL, &threads, &gm, &gn);
+            return (unsigned int)(2.0 * s * s * s / threads);
+        }
+    }
+    // 测到的规模内多线程都不更快：这些规模都用单线程
+    s = max_size < 256 ? max_size : 256;
+    return 2u * s * s * s;
+}
+
+// 在 {当前值 / 2, 当前值 * 2} 以及给定候选中搜索 off 处的参数，保留最快的取值
+static double tune_field(m_blas_config *best, size_t off,
+                         const unsigned int *extra, int n_extra, double best_time,
+                         unsigned int size, double *a, double *b, double *c,
+                         double *sa, double *sb) {
+    unsigned int center = CONFIG_FIELD(best, off);
+    unsigned int cand[8];
+    int n = 0, i;
+
+    cand[n++] = center / 2;
+    cand[n++] = center * 2;
+    for (i = 0; i < n_extra && n < 8; i++) {
+        cand[n++] = extra[i];
+    }
+
+    for (i = 0; i < n; i++) {
+        m_blas_config trial = *best;
+        double t;
+
+        CONFIG_FIELD(&trial, off) = cand[i];
+        dgemm_config_clamp(&trial);
+        if (memcmp(&trial, best, sizeof(trial)) == 0) {
+            continue;
+        }
+        t = tune_measure(&trial, size, a, b, c, sa, sb);
+        if (t < best_time) {
+            best_time = t;
+            *best = trial;
+        }
+    }
+    return best_time;
+}
+
+int dgemm_autotune(unsigned int size, const char *path, m_blas_config *cfg) {
+    static const unsigned int pf_cand[] = { 0, 256, 512, 768, 1024, 1536 };
+    static const unsigned int pf_type_cand[] = {
+        M_BLAS_PREFETCH_NONE, M_BLAS_PREFETCH_L1KEEP, M_BLAS_PREFETCH_L1STRM,
+        M_BLAS_PREFETCH_L2KEEP, M_BLAS_PREFETCH_L2STRM
+    };
+    m_blas_cache_info info;
+    m_blas_config best;
+    double *a, *b, *c, *sa, *sb;
+    double best_time;
+    unsigned int i;
+    int pass;
+
+    size = size < 64 ? 64 : (size + 7) & ~7u;
+    a = (double*)malloc((size_t)size * size * sizeof(double));
+    b = (double*)malloc((size_t)size * size * sizeof(double));
+    c = (double*)malloc((size_t)size * size * sizeof(double));
+    sa = (double*)malloc(M_BLAS_PACK_SA_SIZE * sizeof(double));
+    sb = (double*)malloc(M_BLAS_PACK_SB_SIZE * sizeof(double));
+    if (!a || !b || !c || !sa || !sb) {
+        free(a); free(b); free(c); free(sa); free(sb);
+        return -1;
+    }
+    for (i = 0; i < size * size; i++) {
+        a[i] = (double)(i % 17) * 0.25;
+        b[i] = (double)(i % 13) * 0.5;
+        c[i] = 0.0;
+    }
+
+    // 起点：缓存推导值与内置默认值中较快的一个
+    dgemm_config_default(&best);
+    best_time = tune_measure(&best, size, a, b, c, sa, sb);
+    if (dgemm_cache_info(&info) == 0) {
+        m_blas_config model;
+        double t;
+
+        dgemm_config_from_cache(&info, &model);
+        t = tune_measure(&model, size, a, b, c, sa, sb);
+        if (t < best_time) {
+            best_time = t;
+            best = model;
+        }
+        best.stream_c_bytes = model.stream_c_bytes;
+    }
+
+    // 坐标下降：kc 影响 nc/mc 的上限，所以先调 kc，两轮足够收敛
+    // size 是 8 的倍数，只走 4x8 内核，prefetch_4x4 保持配置值
+    for (pass = 0; pass < 2; pass++) {
+        best_time = tune_field(&best, offsetof(m_blas_config, gemm_p), NULL, 0, best_time,
+                               size, a, b, c, sa, sb);
+        best_time = tune_field(&best, offsetof(m_blas_config, gemm_n), NULL, 0, best_time,
+                               size, a, b, c, sa, sb);
+        best_time = tune_field(&best, offsetof(m_blas_config, gemm_m), NULL, 0, best_time,
+                               size, a, b, c, sa, sb);
+        best_time = tune_field(&best, offsetof(m_blas_config, prefetch_type), pf_type_cand, 5,
+                               best_time, size, a, b, c, sa, sb);
+        best_time = tune_field(&best, offsetof(m_blas_config, prefetch_a), pf_cand, 6, best_time,
+                               size, a, b, c, sa, sb);
+        best_time = tune_field(&best, offsetof(m_blas_config, prefetch_b), pf_cand, 6, best_time,
+                               size, a, b, c, sa, sb);
+    }
+
+    // 在最终的分块配置下实测打包与否的交叉点、单线程与多线程的交叉点
+    dgemm_config_set(&best);
+    best.direct_max_mnp = tune_direct_crossover(size, a, b, c, sa, sb);
+    best.thread_min_flops = tune_thread_crossover(&best, size, a, b, c, sa, sb);
+
+    free(a); free(b); free(c); free(sa); free(sb);
+
+    dgemm_config_set(&best);
+    if (cfg) {
+        *cfg = best;
+    }
+    if (path && dgemm_config_save(path, &best) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+#else
+
+int dgemm_autotune(unsigned int size, const char *path, m_blas_config *cfg) {
+    (void)size; (void)path; (void)cfg;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,169 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "blas_dgemm.h"
+
+/**
+ * ============================================================================
+ * 调用上下文：大页、预先缺页的打包缓冲区
+ * ============================================================================
+ *
+ * sa 最大为 GEMM_M * GEMM_P 个 double（M_BLAS_PACK_SA_SIZE，4MB），用 malloc
+ * 分配时由 4KB 页组成：打包与内核按 4 行 / 8 列跨步访问，TLB 命中率低；
+ * 每次新分配还要在第一次写入时逐页缺页。这里：
+ *
+ * 1. 缓冲区大小向上取整到 2MB
+ * 2. M_BLAS_CTX_HUGETLB 时先尝试 mmap(MAP_HUGETLB)（需要系统预留 hugetlbfs 页），
+ *    否则 / 失败时 mmap 多出 2MB 的匿名内存，按 2MB 对齐裁剪后 madvise(MADV_HUGEPAGE)
+ *    请求透明大页
+ * 3. 逐 4KB 写一次，在创建时完成缺页（之后的 GEMM 不再缺页）
+ * 4. M_BLAS_CTX_MLOCK 时 mlock，避免被换出（受 RLIMIT_MEMLOCK 限制，失败不影响使用）
+ *
+ * 透明大页只是请求，内核可能给不了（THP 关闭、内存碎片），
+ * 实际得到多少从 /proc/self/smaps 的 AnonHugePages 读出，由 dgemm_ctx_stats 报告。
+ * ============================================================================
+ */
+
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+static size_t round_up(size_t x, size_t align) {
+    return (x + align - 1) & ~(align - 1);
+}
+
+// /proc/self/smaps 中与 [addr, addr + len) 重叠的映射的 AnonHugePages（字节）。
+// 相邻的缓冲区可能被合并成一个映射，每个映射的计数按重叠长度截断；读不到返回 0
+static size_t smaps_huge_bytes(const void *addr, size_t len) {
+    FILE *fp = fopen("/proc/self/smaps", "r");
+    char line[256];
+    unsigned long start, end, kb;
+    unsigned long lo = (unsigned long)addr, hi = lo + len;
+    size_t overlap = 0, bytes = 0;
+
+    if (!fp) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            overlap = (start < hi && end > lo) ? (end < hi ? end : hi) - (start > lo ? start : lo) : 0;
+        } else if (overlap && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+            bytes += kb * 1024 < overlap ? kb * 1024 : overlap;
+        }
+    }
+    fclose(fp);
+    return bytes;
+}
+
+// 分配一个打包缓冲区，结果（地址、大页、锁定情况）写入 buf
+static int ctx_buffer_alloc(m_blas_ctx_buffer *buf, size_t size, unsigned int flags) {
+    size_t len = round_up(size, HUGE_PAGE_SIZE);
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    char *p = MAP_FAILED;
+    size_t off;
+
+    memset(buf, 0, sizeof(*buf));
+    buf->size = len;
+
+#ifdef MAP_HUGETLB
+    if (flags & M_BLAS_CTX_HUGETLB) {
+        p = (char*)mmap(NULL, len, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            buf->hugetlb = 1;
+        }
+    }
+#endif
+    if (p == MAP_FAILED) {
+        // 多映射 2MB，裁掉首尾使缓冲区按 2MB 对齐，才能整块换成大页
+        char *raw = (char*)mmap(NULL, len + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+            return -1;
+        }
+        p = (char*)round_up((size_t)raw, HUGE_PAGE_SIZE);
+        off = (size_t)(p - raw);
+        if (off) {
+            munmap(raw, off);
+        }
+        munmap(p + len, HUGE_PAGE_SIZE - off);
+#ifdef MADV_HUGEPAGE
+        madvise(p, len, MADV_HUGEPAGE);
+#endif
+    }
+    buf->ptr = (double*)p;
+
+    // 预先缺页
+    for (off = 0; off < len; off += page) {
+        p[off] = 0;
+    }
+
+    if ((flags & M_BLAS_CTX_MLOCK) && mlock(p, len) == 0) {
+        buf->locked = 1;
+    }
+    buf->huge_bytes = buf->hugetlb ? len : smaps_huge_bytes(p, len);
+    return 0;
+}
+
+static void ctx_buffer_free(m_blas_ctx_buffer *buf) {
+    if (buf->ptr) {
+        if (buf->locked) {
+            munlock(buf->ptr, buf->size);
+        }
+        munmap(buf->ptr, buf->size);
+        buf->ptr = NULL;
+    }
+}
+
+m_blas_ctx *dgemm_ctx_create(unsigned int flags) {
+    m_blas_ctx *ctx = (m_blas_ctx*)calloc(1, sizeof(m_blas_ctx));
+
+    if (!ctx) {
+        return NULL;
+    }
+    ctx->flags = flags;
+    if (ctx_buffer_alloc(&ctx->sa, M_BLAS_PACK_SA_SIZE * sizeof(double), flags) != 0 ||
+        ctx_buffer_alloc(&ctx->sb, M_BLAS_PACK_SB_SIZE * sizeof(double), flags) != 0) {
+        dgemm_ctx_destroy(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+void dgemm_ctx_destroy(m_blas_ctx *ctx) {
+    if (ctx) {
+        ctx_buffer_free(&ctx->sa);
+        ctx_buffer_free(&ctx->sb);
+        free(ctx);
+    }
+}
+
+void dgemm_ctx_stats(const m_blas_ctx *ctx, m_blas_ctx_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->bytes = ctx->sa.size + ctx->sb.size;
+    // 透明大页可能被 khugepaged 事后合并或拆分，每次重新读取
+    stats->huge_bytes = (ctx->sa.hugetlb ? ctx->sa.size : smaps_huge_bytes(ctx->sa.ptr, ctx->sa.size)) +
+                        (ctx->sb.hugetlb ? ctx->sb.size : smaps_huge_bytes(ctx->sb.ptr, ctx->sb.size));
+    stats->hugetlb = ctx->sa.hugetlb && ctx->sb.hugetlb;
+    stats->locked = ctx->sa.locked && ctx->sb.locked;
+}
+
+#ifdef __ARM_NEON
+
+//C(mxn) = A(mxp)*B(pxn)，使用上下文中的打包缓冲区
+void dgemm_neon_auto_ctx_64(m_blas_ctx *ctx, size_t m, size_t n, size_t p,
+                            double *a, size_t lda,
+                            double *b, size_t ldb,
+                            double *c, size_t ldc) {
+    dgemm_neon_auto_64(m, n, p, a, lda, b, ldb, c, ldc, ctx->sa.ptr, ctx->sb.ptr);
+}
+
+void dgemm_neon_auto_ctx(m_blas_ctx *ctx, unsigned int m, unsigned int n, unsigned int p,
+                         double *a, unsigned int lda,
+                         double *b, unsigned int ldb,
+                         double *c, unsigned int ldc) {
+    dgemm_neon_auto_ctx_64(ctx, m, n, p, a, lda, b, ldb, c, ldc);
+}
+
+#endif
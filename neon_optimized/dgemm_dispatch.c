@@ -0,0 +1,154 @@
+#ifdef __ARM_NEON
+
+#include "blas_dgemm.h"
+
+/**
+ * ============================================================================
+ * 按形状分发的统一入口 dgemm_neon_auto
+ * ============================================================================
+ *
+ * 四个 NEON 实现各有适用范围：
+ *
+ * 1. dgemm_neon_small  - 小矩阵不打包（或简单打包），带 JIT，任意 m/n/p，
+ *                        但 2x4 标量广播内核只适合小形状
+ * 2. dgemm_neon        - 原始 4x4 打包实现
+ * 3. dgemm_neon_fast   - 向量化打包 + 4x8 软件流水内核，大矩阵最快
+ * 4. dgemm_neon_direct - 不打包，直接读取 A/B，操作数都在缓存中时省掉打包开销
+ *
+ * dgemm_neon / dgemm_neon_fast / dgemm_neon_direct 的内核按 GEMM_UNROLL 对齐，
+ * 不处理余数。m/n/p 有一个不是 4 的倍数时：
+ *   - 都不超过 DGEMM_AUTO_SMALL_MAX 的走 dgemm_neon_small
+ *   - 更大的走 dgemm_neon_edge：对齐的主体按上面的规则分发，
+ *     余下的行、列和 k 尾部交给 dgemm_neon_small
+ *
+ * DGEMM_AUTO_SMALL_MAX 与 DGEMM_AUTO_NEON_MAX_MNP 是未经实测的默认值：32 取自
+ * dgemm_neon_small 原有的简单打包上限，dgemm_neon 默认不用。应在目标机器上用
+ * ft2000q_neon_small/benchmark.c（同时测试各个实现）对比后在编译时覆盖：
+ *   make AUTO_FLAGS="-DDGEMM_AUTO_SMALL_MAX=48 -DDGEMM_AUTO_NEON_MAX_MNP=0"
+ *
+ * 打包与否的分界点与缓存大小有关，放在运行时配置 direct_max_mnp 中：
+ * 默认按 L2 容量推导，dgemm_autotune 实测 dgemm_neon_direct 与 dgemm_neon_fast
+ * 的交叉点后写入配置文件。
+ *
+ * 打包路径上行距是 1KB 倍数时会 4K 混叠，分发前用 dgemm_ld_check 提示一次。
+ * ============================================================================
+ */
+
+#define GEMM_UNROLL (4)
+
+// m/n/p 都不超过该值时走 dgemm_neon_small（默认值未经实测，见上）
+#ifndef DGEMM_AUTO_SMALL_MAX
+#define DGEMM_AUTO_SMALL_MAX (32)
+#endif
+
+// m*n*p 不超过该值时走 dgemm_neon；默认关闭（未经实测，假定 dgemm_neon_fast 不慢于它）
+#ifndef DGEMM_AUTO_NEON_MAX_MNP
+#define DGEMM_AUTO_NEON_MAX_MNP (0)
+#endif
+
+m_blas_route dgemm_neon_auto_route_64(size_t m, size_t n, size_t p) {
+    if (m <= DGEMM_AUTO_SMALL_MAX && n <= DGEMM_AUTO_SMALL_MAX && p <= DGEMM_AUTO_SMALL_MAX) {
+        return M_BLAS_ROUTE_SMALL;
+    }
+    if ((m | n | p) & (GEMM_UNROLL - 1)) {
+        return M_BLAS_ROUTE_EDGE;
+    }
+    if (m * n * p <= dgemm_config_get()->direct_max_mnp) {
+        return M_BLAS_ROUTE_DIRECT;
+    }
+    if (m * n * p <= DGEMM_AUTO_NEON_MAX_MNP) {
+        return M_BLAS_ROUTE_NEON;
+    }
+    return M_BLAS_ROUTE_FAST;
+}
+
+/**
+ * 不对齐的大形状：C 按 m4 = m & ~3、n4 = n & ~3、p4 = p & ~3 拆成
+ *
+ *   C[0:m4, 0:n4] += A[0:m4, 0:p4] * B[0:p4, 0:n4]    对齐的主体，dgemm_neon_auto_64
+ *   C[0:m4, 0:n4] += A[0:m4, p4:p] * B[p4:p, 0:n4]    k 尾部（不超过 3 步）
+ *   C[0:m4, n4:n] += A[0:m4, 0:p]  * B[0:p, n4:n]     右侧不超过 3 列
+ *   C[m4:m, 0:n]  += A[m4:m, 0:p]  * B[0:p, 0:n]      底部不超过 3 行
+ *
+ * 后三块都很窄，交给 dgemm_neon_small_64（不打包的 2x4 内核，任意形状）。
+ * 拆分只取决于形状，结果与线程数无关
+ */
+void dgemm_neon_edge_64(size_t m, size_t n, size_t p,
+                        double *a, size_t lda,
+                        double *b, size_t ldb,
+                        double *c, size_t ldc,
+                        double *sa, double *sb) {
+    size_t m4 = m & ~(size_t)(GEMM_UNROLL - 1);
+    size_t n4 = n & ~(size_t)(GEMM_UNROLL - 1);
+    size_t p4 = p & ~(size_t)(GEMM_UNROLL - 1);
+
+    if (m4 && n4) {
+        if (p4) {
+            dgemm_neon_auto_64(m4, n4, p4, a, lda, b, ldb, c, ldc, sa, sb);
+        }
+        if (p4 < p) {
+            dgemm_neon_small_64(m4, n4, p - p4, a + p4, lda, b + p4 * ldb, ldb,
+                                c, ldc, sa, sb);
+        }
+    }
+    if (m4 && n4 < n) {
+        dgemm_neon_small_64(m4, n - n4, p, a, lda, b + n4, ldb, c + n4, ldc, sa, sb);
+    }
+    if (m4 < m) {
+        dgemm_neon_small_64(m - m4, n, p, a + m4 * lda, lda, b, ldb, c + m4 * ldc, ldc,
+                            sa, sb);
+    }
+}
+
+//C(mxn) = A(mxp)*B(pxn)
+void dgemm_neon_auto_64(size_t m, size_t n, size_t p,
+                        double *a, size_t lda,
+                        double *b, size_t ldb,
+                        double *c, size_t ldc,
+                        double *sa, double *sb) {
+    m_blas_route route = dgemm_neon_auto_route_64(m, n, p);
+
+    if (route != M_BLAS_ROUTE_SMALL) {
+        dgemm_ld_check(m, n, p, lda, ldb, ldc);
+    }
+    switch (route) {
+    case M_BLAS_ROUTE_NEON:
+        dgemm_neon_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+        break;
+    case M_BLAS_ROUTE_FAST:
+        dgemm_neon_fast_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+        break;
+    case M_BLAS_ROUTE_DIRECT:
+        dgemm_neon_direct_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+        break;
+    case M_BLAS_ROUTE_EDGE:
+        dgemm_neon_edge_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+        break;
+    default:
+        dgemm_neon_small_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+        break;
+    }
+}
+
+// 32 位接口，转发到上面的 64 位版本
+m_blas_route dgemm_neon_auto_route(unsigned int m, unsigned int n, unsigned int p) {
+    return dgemm_neon_auto_route_64(m, n, p);
+}
+
+void dgemm_neon_auto(unsigned int m, unsigned int n, unsigned int p,
+                     double *a, unsigned int lda,
+                     double *b, unsigned int ldb,
+                     double *c, unsigned int ldc,
+                     double *sa, double *sb) {
+    dgemm_neon_auto_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+}
+
+void dgemm_neon_edge(unsigned int m, unsigned int n, unsigned int p,
+                     double *a, unsigned int lda,
+                     double *b, unsigned int ldb,
+                     double *c, unsigned int ldc,
+                     double *sa, double *sb) {
+    dgemm_neon_edge_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+}
+
+#endif
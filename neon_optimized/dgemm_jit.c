@@ -0,0 +1,756 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dgemm_jit.h"
+
+/**
+ * ============================================================================
+ * 小矩阵 DGEMM 运行时 JIT（LIBXSMM 风格）
+ * ============================================================================
+ *
+ * 热点小形状（16x16x16、24x24x24、24x32x16、48x48x48）只在运行时才知道，
+ * dgemm_neon_small 仍要走通用循环和余数处理。这里按
+ * (m, n, p, lda, ldb, ldc) 直接生成机器码：
+ *
+ * 1. 不打包 - 直接在行优先的 A/B 上计算，步长固化为立即数
+ * 2. m/n 方向完全展开 - 每个 4x8 块（余数块 mr<4、nr<8）都是直线代码
+ * 3. k 方向 - m*n*p 不超过 JIT_UNROLL_LIMIT 时完全展开，
+ *             否则每次迭代 JIT_LOOP_K 步的紧凑循环（控制代码体积）
+ * 4. 代码写入 mmap 的缓冲区，写完后改为只读可执行（W^X）
+ * 5. 按形状缓存，同一形状只生成一次；命中时无锁查找，只有生成内核时才加锁，
+ *    缓存满时淘汰最久未用的形状（LRU），被淘汰的代码等所有正在执行它的线程
+ *    退出后才 munmap（两阶段 epoch）
+ *
+ * 平台：
+ *   aarch64 - NEON，n 必须为偶数
+ *   x86-64  - AVX2 + FMA（运行时检测），n 必须为 4 的倍数
+ * 其余情况 dgemm_jit_run 返回 -1（dgemm_jit_get 返回 NULL），调用方回退到普通实现
+ * ============================================================================
+ */
+
+#if defined(__linux__) && (defined(__aarch64__) || defined(__x86_64__))
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define JIT_CACHE_SIZE   (64)               // 最多缓存的形状数
+#define JIT_MAX_DIM      (64)               // m/n/p 上限
+#define JIT_UNROLL_LIMIT (24 * 32 * 24)     // m*n*p 不超过该值时 k 完全展开
+#define JIT_LOOP_K       (4)                // 否则每次循环迭代处理的 k 步数
+#define JIT_READER_SHARDS (64)              // reader 计数分片数（减少缓存行争用）
+
+typedef struct {
+    unsigned int m, n, p, lda, ldb, ldc;
+} jit_key;
+
+// 发布后除 last_use 外只读；fn 为 NULL 表示该形状生成失败（缓存下来避免反复生成）
+typedef struct {
+    jit_key key;
+    void *code;
+    size_t size;
+    dgemm_jit_kernel fn;
+    int pinned;                 // dgemm_jit_get 交出过裸指针，不参与淘汰（持锁读写）
+    atomic_uint last_use;       // LRU 时间戳，取自 jit_clock
+} jit_entry;
+
+// 正在使用缓存的线程数，按 epoch 奇偶分两组；每个分片独占一条缓存行
+typedef struct {
+    atomic_uint count[2];
+    char pad[64 - 2 * sizeof(atomic_uint)];
+} __attribute__((aligned(64))) jit_reader_shard;
+
+static _Atomic(jit_entry*) jit_cache[JIT_CACHE_SIZE];
+static atomic_uint jit_clock;   // 每生成一个内核加 1
+static pthread_mutex_t jit_lock = PTHREAD_MUTEX_INITIALIZER;   // 只在生成/淘汰时持有
+
+static jit_reader_shard jit_readers[JIT_READER_SHARDS];
+static atomic_uint jit_epoch;
+static atomic_uint jit_next_shard;
+static __thread int t_jit_shard = -1;
+
+/* ========== 代码缓冲区 ========== */
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t cap;
+    int fail;
+} jit_buf;
+
+static void emit_bytes(jit_buf *jb, const void *p, size_t n) {
+    if (jb->fail) {
+        return;
+    }
+    if (jb->len + n > jb->cap) {
+        size_t cap = jb->cap ? jb->cap * 2 : 4096;
+        while (cap < jb->len + n) {
+            cap *= 2;
+        }
+        uint8_t *nb = (uint8_t*)realloc(jb->buf, cap);
+        if (!nb) {
+            jb->fail = 1;
+            return;
+        }
+        jb->buf = nb;
+        jb->cap = cap;
+    }
+    memcpy(jb->buf + jb->len, p, n);
+    jb->len += n;
+}
+
+static void emit_u8(jit_buf *jb, uint8_t v) {
+    emit_bytes(jb, &v, 1);
+}
+
+static void emit_u32(jit_buf *jb, uint32_t v) {
+    emit_bytes(jb, &v, 4);
+}
+
+#if defined(__aarch64__)
+/**
+ * ============================================================================
+ * aarch64 代码生成
+ * ============================================================================
+ *
+ * 寄存器分配：
+ *   x0/x1/x2  - A/B/C 基址（参数）
+ *   x3        - ldb * 8（B 行步长，用于寄存器后变址）
+ *   x4        - 当前块的 B 指针
+ *   x5-x8     - 当前块 4 行 A 的指针
+ *   x9        - 大立即数临时寄存器
+ *   x10-x13   - 当前块 4 行 C 的指针
+ *   x14       - k 循环计数
+ *   v0-v15    - C 累加器，第 r 行第 j 个向量为 v(4r+j)
+ *   v16-v19   - A，每行一次装 2 个 k
+ *   v20-v23   - B 第 k 行；v24-v27 - B 第 k+1 行
+ * v8-v15 的低 64 位是被调用者保存的，序言/尾声负责保存恢复
+ * ============================================================================
+ */
+
+static void a64_mov_imm(jit_buf *jb, int rd, uint64_t imm) {
+    int hw, first = 1;
+
+    for (hw = 0; hw < 4; hw++) {
+        uint32_t part = (uint32_t)(imm >> (16 * hw)) & 0xffff;
+        if (part == 0 && !(first && hw == 3)) {
+            continue;
+        }
+        // MOVZ / MOVK Xd, #part, LSL #(16*hw)
+        emit_u32(jb, (first ? 0xD2800000u : 0xF2800000u) |
+                     ((uint32_t)hw << 21) | (part << 5) | (uint32_t)rd);
+        first = 0;
+    }
+}
+
+// Xd = Xn + imm
+static void a64_add_imm(jit_buf *jb, int rd, int rn, uint64_t imm) {
+    if (imm < 4096) {
+        emit_u32(jb, 0x91000000u | ((uint32_t)imm << 10) | ((uint32_t)rn << 5) | (uint32_t)rd);
+    } else if (imm < (1u << 24)) {
+        emit_u32(jb, 0x91400000u | ((uint32_t)(imm >> 12) << 10) | ((uint32_t)rn << 5) | (uint32_t)rd);
+        if (imm & 0xfff) {
+            emit_u32(jb, 0x91000000u | ((uint32_t)(imm & 0xfff) << 10) |
+                         ((uint32_t)rd << 5) | (uint32_t)rd);
+        }
+    } else {
+        a64_mov_imm(jb, 9, imm);
+        // ADD Xd, Xn, X9
+        emit_u32(jb, 0x8B000000u | (9u << 16) | ((uint32_t)rn << 5) | (uint32_t)rd);
+    }
+}
+
+// LD1/ST1 多寄存器的 opcode 字段（1~4 个连续寄存器）
+static const uint32_t a64_ld1_opcode[5] = { 0, 0x7, 0xA, 0x6, 0x2 };
+
+// LD1 {Vt.2D - V(t+n-1).2D}, [Xn]
+static void a64_ld1(jit_buf *jb, int vt, int nregs, int rn) {
+    emit_u32(jb, 0x4C400000u | (a64_ld1_opcode[nregs] << 12) | (3u << 10) |
+                 ((uint32_t)rn << 5) | (uint32_t)vt);
+}
+
+// ST1 {Vt.2D - V(t+n-1).2D}, [Xn]
+static void a64_st1(jit_buf *jb, int vt, int nregs, int rn) {
+    emit_u32(jb, 0x4C000000u | (a64_ld1_opcode[nregs] << 12) | (3u << 10) |
+                 ((uint32_t)rn << 5) | (uint32_t)vt);
+}
+
+// LD1 {Vt.2D - V(t+n-1).2D}, [Xn], Xm
+static void a64_ld1_post_reg(jit_buf *jb, int vt, int nregs, int rn, int rm) {
+    emit_u32(jb, 0x4CC00000u | ((uint32_t)rm << 16) | (a64_ld1_opcode[nregs] << 12) |
+                 (3u << 10) | ((uint32_t)rn << 5) | (uint32_t)vt);
+}
+
+// LD1 {Vt.2D}, [Xn], #16
+static void a64_ld1_2d_post16(jit_buf *jb, int vt, int rn) {
+    emit_u32(jb, 0x4CDF7C00u | ((uint32_t)rn << 5) | (uint32_t)vt);
+}
+
+// LD1 {Vt.1D}, [Xn], #8
+static void a64_ld1_1d_post8(jit_buf *jb, int vt, int rn) {
+    emit_u32(jb, 0x0CDF7C00u | ((uint32_t)rn << 5) | (uint32_t)vt);
+}
+
+// FMLA Vd.2D, Vn.2D, Vm.D[idx]
+static void a64_fmla_elem(jit_buf *jb, int vd, int vn, int vm, int idx) {
+    emit_u32(jb, 0x4FC01000u | ((uint32_t)vm << 16) | ((uint32_t)idx << 11) |
+                 ((uint32_t)vn << 5) | (uint32_t)vd);
+}
+
+// STP/LDP Dt, Dt2, [SP, #off]；mode: 0 有符号偏移，1 前变址，2 后变址
+static void a64_stp_ldp_d(jit_buf *jb, int load, int mode, int rt, int rt2, int off) {
+    static const uint32_t idx_bits[3] = { 0x2, 0x3, 0x1 };
+    uint32_t imm7 = (uint32_t)(off / 8) & 0x7f;
+
+    emit_u32(jb, 0x2C000000u | (1u << 30) | (idx_bits[mode] << 23) | ((uint32_t)load << 22) |
+                 (imm7 << 15) | ((uint32_t)rt2 << 10) | (31u << 5) | (uint32_t)rt);
+}
+
+/*
+ * 一个 mr x nr 块的一个 k 对（k, k+1）：
+ *   A 每行一次装 2 个 k，B 两行分别进 v20.. 和 v24..
+ *   装完 B 第 k+1 行后先做第 k 步的 FMLA，掩盖其装载延迟
+ */
+static void a64_emit_kpair(jit_buf *jb, int mr, int nb) {
+    int r, j;
+
+    for (r = 0; r < mr; r++) {
+        a64_ld1_2d_post16(jb, 16 + r, 5 + r);
+    }
+    a64_ld1_post_reg(jb, 20, nb, 4, 3);
+    a64_ld1_post_reg(jb, 24, nb, 4, 3);
+    for (j = 0; j < nb; j++) {
+        for (r = 0; r < mr; r++) {
+            a64_fmla_elem(jb, 4 * r + j, 20 + j, 16 + r, 0);
+        }
+    }
+    for (j = 0; j < nb; j++) {
+        for (r = 0; r < mr; r++) {
+            a64_fmla_elem(jb, 4 * r + j, 24 + j, 16 + r, 1);
+        }
+    }
+}
+
+// p 为奇数时的最后一个 k
+static void a64_emit_kone(jit_buf *jb, int mr, int nb) {
+    int r, j;
+
+    for (r = 0; r < mr; r++) {
+        a64_ld1_1d_post8(jb, 16 + r, 5 + r);
+    }
+    a64_ld1_post_reg(jb, 20, nb, 4, 3);
+    for (j = 0; j < nb; j++) {
+        for (r = 0; r < mr; r++) {
+            a64_fmla_elem(jb, 4 * r + j, 20 + j, 16 + r, 0);
+        }
+    }
+}
+
+static int jit_build(jit_buf *jb, const jit_key *key) {
+    unsigned int i, j;
+    unsigned int m = key->m, n = key->n, p = key->p;
+    int full_unroll = (unsigned long)m * n * p <= JIT_UNROLL_LIMIT;
+
+    if (n & 1) {
+        return -1;
+    }
+
+    // 序言：保存 d8-d15，x3 = ldb * 8
+    a64_stp_ldp_d(jb, 0, 1, 8, 9, -64);
+    a64_stp_ldp_d(jb, 0, 0, 10, 11, 16);
+    a64_stp_ldp_d(jb, 0, 0, 12, 13, 32);
+    a64_stp_ldp_d(jb, 0, 0, 14, 15, 48);
+    a64_mov_imm(jb, 3, (uint64_t)key->ldb * 8);
+
+    for (i = 0; i < m; i += 4) {
+        int mr = m - i < 4 ? (int)(m - i) : 4;
+
+        for (j = 0; j < n; j += 8) {
+            int nb = (n - j < 8 ? (int)(n - j) : 8) / 2;
+            unsigned int pairs = p / 2;
+            int r;
+
+            // 本块的 A/B/C 指针
+            a64_add_imm(jb, 4, 1, (uint64_t)j * 8);
+            for (r = 0; r < mr; r++) {
+                a64_add_imm(jb, 5 + r, 0, ((uint64_t)(i + r) * key->lda) * 8);
+                a64_add_imm(jb, 10 + r, 2, ((uint64_t)(i + r) * key->ldc + j) * 8);
+                a64_ld1(jb, 4 * r, nb, 10 + r);
+            }
+
+            if (!full_unroll && pairs >= JIT_LOOP_K) {
+                unsigned int iters = p / JIT_LOOP_K;
+                size_t loop_start;
+                int32_t off;
+                int u;
+
+                a64_mov_imm(jb, 14, iters);
+                loop_start = jb->len;
+                for (u = 0; u < JIT_LOOP_K / 2; u++) {
+                    a64_emit_kpair(jb, mr, nb);
+                }
+                // SUBS X14, X14, #1；B.NE loop_start
+                emit_u32(jb, 0xF1000000u | (1u << 10) | (14u << 5) | 14u);
+                off = (int32_t)((int64_t)loop_start - (int64_t)jb->len) / 4;
+                emit_u32(jb, 0x54000001u | (((uint32_t)off & 0x7ffff) << 5));
+                pairs -= iters * (JIT_LOOP_K / 2);
+            }
+            for (; pairs > 0; pairs--) {
+                a64_emit_kpair(jb, mr, nb);
+            }
+            if (p & 1) {
+                a64_emit_kone(jb, mr, nb);
+            }
+
+            for (r = 0; r < mr; r++) {
+                a64_st1(jb, 4 * r, nb, 10 + r);
+            }
+        }
+    }
+
+    // 尾声：恢复 d8-d15 并返回
+    a64_stp_ldp_d(jb, 1, 0, 10, 11, 16);
+    a64_stp_ldp_d(jb, 1, 0, 12, 13, 32);
+    a64_stp_ldp_d(jb, 1, 0, 14, 15, 48);
+    a64_stp_ldp_d(jb, 1, 2, 8, 9, 64);
+    emit_u32(jb, 0xD65F03C0u);  // RET
+    return 0;
+}
+
+#else /* __x86_64__ */
+/**
+ * ============================================================================
+ * x86-64 代码生成（AVX2 + FMA）
+ * ============================================================================
+ *
+ * 寄存器分配（System V 调用约定，全部为调用者保存）：
+ *   rdi/rsi/rdx - A/B/C 基址（参数）
+ *   r8/r9/r10   - 当前块的 A/B/C 指针
+ *   rcx         - k 循环计数
+ *   ymm0-7      - C 累加器，第 r 行第 j 个向量为 ymm(2r+j)
+ *   ymm8-9      - B 第 k 行
+ *   ymm10-13    - A[r][k] 广播
+ * 块内偏移全部用 disp32 立即数寻址
+ * ============================================================================
+ */
+
+#define X64_RDX 2
+#define X64_RSI 6
+#define X64_RDI 7
+#define X64_R8  8
+#define X64_R9  9
+#define X64_R10 10
+
+// VEX 三字节前缀 + opcode + [base + disp32]
+static void x64_vex_mem(jit_buf *jb, int map, int w, int reg, int vvvv,
+                        int base, int32_t disp, uint8_t op) {
+    emit_u8(jb, 0xC4);
+    emit_u8(jb, (uint8_t)((((~reg >> 3) & 1) << 7) | (1 << 6) |
+                          (((~base >> 3) & 1) << 5) | map));
+    emit_u8(jb, (uint8_t)((w << 7) | ((~vvvv & 0xF) << 3) | (1 << 2) | 1));  // L=256, pp=66
+    emit_u8(jb, op);
+    emit_u8(jb, (uint8_t)(0x80 | ((reg & 7) << 3) | (base & 7)));
+    if ((base & 7) == 4) {
+        emit_u8(jb, 0x24);
+    }
+    emit_u32(jb, (uint32_t)disp);
+}
+
+// vmovupd ymm, [base + disp]
+static void x64_load(jit_buf *jb, int ymm, int base, int32_t disp) {
+    x64_vex_mem(jb, 1, 0, ymm, 0, base, disp, 0x10);
+}
+
+// vmovupd [base + disp], ymm
+static void x64_store(jit_buf *jb, int ymm, int base, int32_t disp) {
+    x64_vex_mem(jb, 1, 0, ymm, 0, base, disp, 0x11);
+}
+
+// vbroadcastsd ymm, [base + disp]
+static void x64_bcast(jit_buf *jb, int ymm, int base, int32_t disp) {
+    x64_vex_mem(jb, 2, 0, ymm, 0, base, disp, 0x19);
+}
+
+// vfmadd231pd d, a, b：d += a * b
+static void x64_fma(jit_buf *jb, int d, int a, int b) {
+    emit_u8(jb, 0xC4);
+    emit_u8(jb, (uint8_t)((((~d >> 3) & 1) << 7) | (1 << 6) | (((~b >> 3) & 1) << 5) | 2));
+    emit_u8(jb, (uint8_t)((1 << 7) | ((~a & 0xF) << 3) | (1 << 2) | 1));
+    emit_u8(jb, 0xB8);
+    emit_u8(jb, (uint8_t)(0xC0 | ((d & 7) << 3) | (b & 7)));
+}
+
+// lea reg, [base + disp]
+static void x64_lea(jit_buf *jb, int reg, int base, int32_t disp) {
+    emit_u8(jb, (uint8_t)(0x48 | ((reg >> 3) << 2) | (base >> 3)));
+    emit_u8(jb, 0x8D);
+    emit_u8(jb, (uint8_t)(0x80 | ((reg & 7) << 3) | (base & 7)));
+    if ((base & 7) == 4) {
+        emit_u8(jb, 0x24);
+    }
+    emit_u32(jb, (uint32_t)disp);
+}
+
+// add reg, imm32
+static void x64_add_imm(jit_buf *jb, int reg, int32_t imm) {
+    emit_u8(jb, (uint8_t)(0x48 | (reg >> 3)));
+    emit_u8(jb, 0x81);
+    emit_u8(jb, (uint8_t)(0xC0 | (reg & 7)));
+    emit_u32(jb, (uint32_t)imm);
+}
+
+// 一个 k 步；偏移相对于 r8/r9 当前位置
+static void x64_emit_k(jit_buf *jb, const jit_key *key, int mr, int nb, unsigned int k) {
+    int r, j;
+
+    for (j = 0; j < nb; j++) {
+        x64_load(jb, 8 + j, X64_R9, (int32_t)(((uint64_t)k * key->ldb) * 8 + j * 32));
+    }
+    for (r = 0; r < mr; r++) {
+        x64_bcast(jb, 10 + r, X64_R8, (int32_t)(((uint64_t)r * key->lda + k) * 8));
+    }
+    for (r = 0; r < mr; r++) {
+        for (j = 0; j < nb; j++) {
+            x64_fma(jb, 2 * r + j, 8 + j, 10 + r);
+        }
+    }
+}
+
+static int jit_build(jit_buf *jb, const jit_key *key) {
+    unsigned int i, j, k;
+    unsigned int m = key->m, n = key->n, p = key->p;
+    int full_unroll = (unsigned long)m * n * p <= JIT_UNROLL_LIMIT;
+    uint64_t max_off;
+
+    if ((n & 3) || !__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma")) {
+        return -1;
+    }
+    // 所有偏移必须放得进 disp32
+    max_off = ((uint64_t)m * key->lda + (uint64_t)m * key->ldc +
+               (uint64_t)p * key->ldb + n + p) * 8;
+    if (max_off > 0x7fffffff) {
+        return -1;
+    }
+
+    for (i = 0; i < m; i += 4) {
+        int mr = m - i < 4 ? (int)(m - i) : 4;
+
+        for (j = 0; j < n; j += 8) {
+            int nb = (n - j < 8 ? (int)(n - j) : 8) / 4;
+            unsigned int kk = 0;
+            int r, c;
+
+            x64_lea(jb, X64_R8, X64_RDI, (int32_t)((uint64_t)i * key->lda * 8));
+            x64_lea(jb, X64_R9, X64_RSI, (int32_t)(j * 8));
+            x64_lea(jb, X64_R10, X64_RDX, (int32_t)(((uint64_t)i * key->ldc + j) * 8));
+            for (r = 0; r < mr; r++) {
+                for (c = 0; c < nb; c++) {
+                    x64_load(jb, 2 * r + c, X64_R10, (int32_t)(((uint64_t)r * key->ldc) * 8 + c * 32));
+                }
+            }
+
+            if (!full_unroll && p >= 2 * JIT_LOOP_K) {
+                unsigned int iters = p / JIT_LOOP_K;
+                size_t loop_start;
+
+                // mov ecx, iters
+                emit_u8(jb, 0xB9);
+                emit_u32(jb, iters);
+                loop_start = jb->len;
+                for (k = 0; k < JIT_LOOP_K; k++) {
+                    x64_emit_k(jb, key, mr, nb, k);
+                }
+                x64_add_imm(jb, X64_R8, JIT_LOOP_K * 8);
+                x64_add_imm(jb, X64_R9, (int32_t)((uint64_t)JIT_LOOP_K * key->ldb * 8));
+                // dec ecx；jnz loop_start
+                emit_u8(jb, 0xFF);
+                emit_u8(jb, 0xC9);
+                emit_u8(jb, 0x0F);
+                emit_u8(jb, 0x85);
+                emit_u32(jb, (uint32_t)((int64_t)loop_start - (int64_t)(jb->len + 4)));
+                kk = iters * JIT_LOOP_K;
+            }
+            for (k = 0; k < p - kk; k++) {
+                x64_emit_k(jb, key, mr, nb, k);
+            }
+
+            for (r = 0; r < mr; r++) {
+                for (c = 0; c < nb; c++) {
+                    x64_store(jb, 2 * r + c, X64_R10, (int32_t)(((uint64_t)r * key->ldc) * 8 + c * 32));
+                }
+            }
+        }
+    }
+
+    // vzeroupper；ret
+    emit_u8(jb, 0xC5);
+    emit_u8(jb, 0xF8);
+    emit_u8(jb, 0x77);
+    emit_u8(jb, 0xC3);
+    return 0;
+}
+#endif
+
+/* ========== 可执行内存与缓存 ========== */
+
+static int jit_key_equal(const jit_key *x, const jit_key *y) {
+    return x->m == y->m && x->n == y->n && x->p == y->p &&
+           x->lda == y->lda && x->ldb == y->ldb && x->ldc == y->ldc;
+}
+
+static void *jit_install(const jit_buf *jb, size_t *size) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t len = (jb->len + (size_t)page - 1) & ~((size_t)page - 1);
+    void *mem = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mem == MAP_FAILED) {
+        return NULL;
+    }
+    memcpy(mem, jb->buf, jb->len);
+    if (mprotect(mem, len, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, len);
+        return NULL;
+    }
+    __builtin___clear_cache((char*)mem, (char*)mem + jb->len);
+    *size = len;
+    return mem;
+}
+
+/* ========== 无锁读与安全回收 ==========
+ * reader 在所属分片上按当前 epoch 的奇偶计数，然后才读缓存槽；
+ * 淘汰者先把槽换成新条目，再翻转 epoch 并等旧奇偶的计数归零，连做两次：
+ * 第一次等到换槽前进入的 reader 全部退出，第二次保证下一次回收开始时
+ * 所有 reader 都计在同一组里。两步都是 seq_cst，reader 的计数和淘汰者的
+ * 换槽之间不会互相看不见
+ */
+
+static unsigned int jit_read_lock(void) {
+    unsigned int shard, e;
+
+    if (t_jit_shard < 0) {
+        t_jit_shard = (int)(atomic_fetch_add(&jit_next_shard, 1) % JIT_READER_SHARDS);
+    }
+    shard = (unsigned int)t_jit_shard;
+    e = atomic_load(&jit_epoch) & 1;
+    atomic_fetch_add(&jit_readers[shard].count[e], 1);
+    return shard * 2 + e;
+}
+
+static void jit_read_unlock(unsigned int token) {
+    atomic_fetch_sub_explicit(&jit_readers[token / 2].count[token & 1], 1, memory_order_release);
+}
+
+static void jit_wait_readers(unsigned int e) {
+    int s;
+
+    for (s = 0; s < JIT_READER_SHARDS; s++) {
+        while (atomic_load(&jit_readers[s].count[e]) != 0) {
+            sched_yield();
+        }
+    }
+}
+
+// 持有 jit_lock 调用，且调用线程自己不能处在 jit_read_lock 区间内
+static void jit_synchronize(void) {
+    unsigned int e = atomic_load(&jit_epoch);
+
+    atomic_store(&jit_epoch, e + 1);
+    jit_wait_readers(e & 1);
+    atomic_store(&jit_epoch, e + 2);
+    jit_wait_readers((e + 1) & 1);
+}
+
+static void jit_free_entry(jit_entry *ent) {
+    if (ent->code) {
+        munmap(ent->code, ent->size);
+    }
+    free(ent);
+}
+
+/* ========== 缓存查找与生成 ========== */
+
+static unsigned int jit_hash(const jit_key *key) {
+    unsigned int h = key->m;
+
+    h = h * 31u + key->n;
+    h = h * 31u + key->p;
+    h = h * 31u + key->lda;
+    h = h * 31u + key->ldb;
+    h = h * 31u + key->ldc;
+    return (h ^ (h >> 7)) % JIT_CACHE_SIZE;
+}
+
+// 从 jit_hash 起线性探测；条目可以出现在任意槽中（淘汰会复用别的槽），所以要扫满一圈
+static jit_entry *jit_lookup(const jit_key *key) {
+    unsigned int h = jit_hash(key);
+    int i;
+
+    for (i = 0; i < JIT_CACHE_SIZE; i++) {
+        jit_entry *ent = atomic_load(&jit_cache[(h + i) % JIT_CACHE_SIZE]);
+        if (ent && jit_key_equal(&ent->key, key)) {
+            return ent;
+        }
+    }
+    return NULL;
+}
+
+// 命中时刷新 LRU 时间戳；时钟没走时不写，避免热点形状反复弄脏缓存行
+static void jit_touch(jit_entry *ent) {
+    unsigned int now = atomic_load_explicit(&jit_clock, memory_order_relaxed);
+
+    if (atomic_load_explicit(&ent->last_use, memory_order_relaxed) != now) {
+        atomic_store_explicit(&ent->last_use, now, memory_order_relaxed);
+    }
+}
+
+/**
+ * 生成并发布 key 对应的条目（持锁；在 jit_read_lock 区间外调用）
+ * 有空槽就用空槽，否则淘汰最久未用且未固定的条目；全部固定时返回 NULL
+ */
+static jit_entry *jit_insert_locked(const jit_key *key) {
+    jit_buf jb = { NULL, 0, 0, 0 };
+    jit_entry *ent, *victim = NULL;
+    unsigned int h = jit_hash(key);
+    int i, slot = -1;
+
+    ent = jit_lookup(key);
+    if (ent) {
+        return ent;
+    }
+
+    for (i = 0; i < JIT_CACHE_SIZE; i++) {
+        int s = (int)((h + i) % JIT_CACHE_SIZE);
+        jit_entry *cur = atomic_load_explicit(&jit_cache[s], memory_order_relaxed);
+        if (!cur) {
+            slot = s;
+            victim = NULL;
+            break;
+        }
+        if (!cur->pinned && (!victim ||
+            atomic_load_explicit(&cur->last_use, memory_order_relaxed) <
+            atomic_load_explicit(&victim->last_use, memory_order_relaxed))) {
+            slot = s;
+            victim = cur;
+        }
+    }
+    if (slot < 0) {
+        return NULL;
+    }
+
+    ent = (jit_entry*)calloc(1, sizeof(jit_entry));
+    if (!ent) {
+        return NULL;
+    }
+    ent->key = *key;
+    if (jit_build(&jb, key) == 0 && !jb.fail) {
+        ent->code = jit_install(&jb, &ent->size);
+        ent->fn = (dgemm_jit_kernel)ent->code;
+    }
+    free(jb.buf);
+    atomic_init(&ent->last_use, atomic_fetch_add(&jit_clock, 1) + 1);
+
+    atomic_store(&jit_cache[slot], ent);
+    if (victim) {
+        jit_synchronize();
+        jit_free_entry(victim);
+    }
+    return ent;
+}
+
+static int jit_key_valid(const jit_key *key) {
+    return key->m != 0 && key->n != 0 && key->p != 0 &&
+           key->m <= JIT_MAX_DIM && key->n <= JIT_MAX_DIM && key->p <= JIT_MAX_DIM;
+}
+
+int dgemm_jit_run(unsigned int m, unsigned int n, unsigned int p,
+                  unsigned int lda, unsigned int ldb, unsigned int ldc,
+                  const double *a, const double *b, double *c) {
+    jit_key key = { m, n, p, lda, ldb, ldc };
+    jit_entry *ent;
+    unsigned int token;
+
+    if (!jit_key_valid(&key)) {
+        return -1;
+    }
+
+    token = jit_read_lock();
+    ent = jit_lookup(&key);
+    if (!ent) {
+        // 生成可能要淘汰并等待 reader，必须先退出读区间；
+        // 放锁前重新进入读区间，刚生成的条目在用完之前不会被别的线程回收
+        jit_read_unlock(token);
+        pthread_mutex_lock(&jit_lock);
+        ent = jit_insert_locked(&key);
+        token = jit_read_lock();
+        pthread_mutex_unlock(&jit_lock);
+    }
+    if (!ent || !ent->fn) {
+        jit_read_unlock(token);
+        return -1;
+    }
+    jit_touch(ent);
+    ent->fn(a, b, c);
+    jit_read_unlock(token);
+    return 0;
+}
+
+dgemm_jit_kernel dgemm_jit_get(unsigned int m, unsigned int n, unsigned int p,
+                               unsigned int lda, unsigned int ldb, unsigned int ldc) {
+    jit_key key = { m, n, p, lda, ldb, ldc };
+    jit_entry *ent;
+    dgemm_jit_kernel fn = NULL;
+
+    if (!jit_key_valid(&key)) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&jit_lock);
+    ent = jit_insert_locked(&key);
+    if (ent && ent->fn) {
+        ent->pinned = 1;
+        fn = ent->fn;
+    }
+    pthread_mutex_unlock(&jit_lock);
+    return fn;
+}
+
+// 先摘下全部条目，等正在 dgemm_jit_run 中执行它们的线程退出后再释放，
+// 与并发的 GEMM 调用安全共存（它们之后会重新生成内核）
+void dgemm_jit_clear(void) {
+    jit_entry *old[JIT_CACHE_SIZE];
+    int i;
+
+    pthread_mutex_lock(&jit_lock);
+    for (i = 0; i < JIT_CACHE_SIZE; i++) {
+        old[i] = atomic_exchange(&jit_cache[i], NULL);
+    }
+    jit_synchronize();
+    for (i = 0; i < JIT_CACHE_SIZE; i++) {
+        if (old[i]) {
+            jit_free_entry(old[i]);
+        }
+    }
+    pthread_mutex_unlock(&jit_lock);
+}
+
+#else
+
+int dgemm_jit_run(unsigned int m, unsigned int n, unsigned int p,
+                  unsigned int lda, unsigned int ldb, unsigned int ldc,
+                  const double *a, const double *b, double *c) {
+    (void)m; (void)n; (void)p; (void)lda; (void)ldb; (void)ldc;
+    (void)a; (void)b; (void)c;
+    return -1;
+}
+
+dgemm_jit_kernel dgemm_jit_get(unsigned int m, unsigned int n, unsigned int p,
+                               unsigned int lda, unsigned int ldb, unsigned int ldc) {
+    (void)m; (void)n; (void)p; (void)lda; (void)ldb; (void)ldc;
+    return NULL;
+}
+
+void dgemm_jit_clear(void) {
+}
+
+#endif
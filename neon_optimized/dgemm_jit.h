@@ -0,0 +1,28 @@
+/*
+ * 小矩阵 DGEMM 运行时 JIT
+ * 按 (m, n, p, lda, ldb, ldc) 生成完全展开的机器码并缓存
+ */
+
+#ifndef DGEMM_JIT_H
+#define DGEMM_JIT_H
+
+// JIT 生成的内核：C(mxn) += A(mxp) * B(pxn)，形状和步长已固化在代码中
+typedef void (*dgemm_jit_kernel)(const double *a, const double *b, double *c);
+
+// 用指定形状的内核（必要时生成）计算 C += A*B，返回 0；
+// 不支持的形状/平台或生成失败时什么都不做，返回 -1。命中缓存时不加锁，可多线程并发调用
+int dgemm_jit_run(unsigned int m, unsigned int n, unsigned int p,
+                  unsigned int lda, unsigned int ldb, unsigned int ldc,
+                  const double *a, const double *b, double *c);
+
+// 取得（必要时生成）指定形状的内核；不支持的形状/平台返回 NULL
+// 交出的内核被固定在缓存中不会被淘汰，直到 dgemm_jit_clear
+dgemm_jit_kernel dgemm_jit_get(unsigned int m, unsigned int n, unsigned int p,
+                               unsigned int lda, unsigned int ldb, unsigned int ldc);
+
+// 释放全部已生成的内核。可与 dgemm_jit_run（即并发的 GEMM 调用）同时进行，
+// 正在执行的内核会等其返回后才释放；但 dgemm_jit_get 交出的函数指针在调用后失效，
+// 调用方须保证此时没有线程还在使用它们
+void dgemm_jit_clear(void);
+
+#endif // DGEMM_JIT_H
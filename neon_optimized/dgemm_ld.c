@@ -0,0 +1,106 @@
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "blas_dgemm.h"
+
+/**
+ * ============================================================================
+ * 行距（leading dimension）的填充与检查
+ * ============================================================================
+ *
+ * 行距字节数是 1KB 的倍数时（行优先的 128 / 256 / 512 ... 列），
+ * 相邻几行的同一列落在 4KB 页内的同一偏移、L1 的同一组：
+ *   - 256 列（2KB）：packA 一次读的 4 行里第 0/2、1/3 行互相 4K 混叠
+ *   - 128 列（1KB）：8 行打包与相邻两个 4 行 C 块的对应行互相混叠
+ * 装载被误判为依赖写回，组相联 L1 里同一组的行也互相挤出，
+ * 基准测试中 128 / 256 的方阵因此比相邻的非 2 的幂规模慢。
+ *
+ * dgemm_ld_pad 给出按缓存行对齐、且不是 1KB 倍数的行距（多出一个缓存行），
+ * dgemm_alloc_matrix 按它分配矩阵；dgemm_ld_check 在调用方传入这种行距时
+ * 在 stderr 提示一次（DGEMM_LD_WARN=0 关闭）。
+ * ============================================================================
+ */
+
+// 行距对齐到一个缓存行（8 个 double）
+#define LD_ALIGN (8)
+
+int dgemm_ld_is_pathological(size_t ld) {
+    return ld != 0 && (ld * sizeof(double)) % M_BLAS_LD_ALIAS_BYTES == 0;
+}
+
+size_t dgemm_ld_pad(size_t cols) {
+    size_t ld = (cols + LD_ALIGN - 1) & ~(size_t)(LD_ALIGN - 1);
+
+    if (dgemm_ld_is_pathological(ld)) {
+        ld += LD_ALIGN;
+    }
+    return ld;
+}
+
+double *dgemm_alloc_matrix_64(size_t rows, size_t cols, size_t *ld) {
+    size_t pad = dgemm_ld_pad(cols);
+    double *mat;
+
+    rows = rows ? rows : 1;
+    // 填充后溢出或总字节数溢出
+    if (pad < cols || pad > SIZE_MAX / sizeof(double) / rows) {
+        return NULL;
+    }
+    mat = (double*)aligned_alloc(64, rows * pad * sizeof(double));
+    if (mat && ld) {
+        *ld = pad;
+    }
+    return mat;
+}
+
+// 32 位接口，转发到上面的 64 位版本；行距超出 unsigned int 时返回 NULL
+double *dgemm_alloc_matrix(unsigned int rows, unsigned int cols, unsigned int *ld) {
+    size_t pad = 0;
+    double *mat;
+
+    if (dgemm_ld_pad(cols) > UINT_MAX) {
+        return NULL;
+    }
+    mat = dgemm_alloc_matrix_64(rows, cols, &pad);
+    if (mat && ld) {
+        *ld = (unsigned int)pad;
+    }
+    return mat;
+}
+
+static atomic_int g_ld_warn = 1;
+static pthread_once_t g_ld_once = PTHREAD_ONCE_INIT;
+
+static void ld_warn_init(void) {
+    const char *env = getenv("DGEMM_LD_WARN");
+
+    atomic_store(&g_ld_warn, !(env && env[0] == '0'));
+}
+
+void dgemm_ld_check(size_t m, size_t n, size_t p,
+                    size_t lda, size_t ldb, size_t ldc) {
+    const char *name;
+    size_t ld;
+
+    // 不到 4 行时没有行之间的冲突
+    if (dgemm_ld_is_pathological(lda) && m >= 4) {
+        name = "lda", ld = lda;
+    } else if (dgemm_ld_is_pathological(ldb) && p >= 4) {
+        name = "ldb", ld = ldb;
+    } else if (dgemm_ld_is_pathological(ldc) && m >= 4) {
+        name = "ldc", ld = ldc;
+    } else {
+        return;
+    }
+
+    pthread_once(&g_ld_once, ld_warn_init);
+    // 每个进程只提示一次；多个线程同时遇到时只有一个取到 1
+    if (atomic_exchange(&g_ld_warn, 0)) {
+        fprintf(stderr, "dgemm: %s = %zu 是 %u 字节的倍数，各行在 L1 中互相冲突（%zux%zux%zu）；"
+                "建议用 dgemm_ld_pad / dgemm_alloc_matrix 把行距填充到 %zu\n",
+                name, ld, M_BLAS_LD_ALIAS_BYTES, m, n, p, dgemm_ld_pad(ld));
+    }
+}
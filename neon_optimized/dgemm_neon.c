@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include "blas_dgemm.h"
+#include "dgemm_prefetch.h"
 
 
 /* Create macros so that the matrices are stored in row-major order */
@@ -37,10 +38,11 @@ min_nn * kc <= PAGESIZE/2,  4 <= min_nn <= 12, so that 170 <= kc <= 512, we use
 256. After reading 6.4, rk3399 L2 cache is large, mc = 1MB / 256 = 4096
 
 Note: For double precision, cache usage doubles, so we adjust block sizes accordingly.
+
+Note: GEMM_M / GEMM_N / GEMM_P are runtime values from dgemm_config_get(). The
+defaults (2048 / 256 / 128) are the numbers derived above; dgemm_autotune() can
+replace them with values measured on the host.
 */
-#define GEMM_N (256)  // GEMM_R - reduced for double precision
-#define GEMM_M (2048) // GEMM_P - reduced for double precision  
-#define GEMM_P (128)  // GEMM_Q - reduced for double precision
 #define GEMM_UNROLL (4)
 
 /**
@@ -73,104 +75,36 @@ C7 C8 C9
 Note: For double precision, we use 2x2 blocks instead of 4x4 due to register constraints
 and double-width data.
  */
-void kernel_4x4(unsigned int m, unsigned int n, unsigned int p, double *sa, double *sb, double *sc, unsigned int ldc) {
-    double *a = sa, *b = sb, *c = sc;
-    int i, j;
-    unsigned int ldc_offset = ldc * sizeof(double);
-
-    for (i = 0; i < m; i += 4) {
-        for (j = 0; j < n; j += 4) {
-            asm volatile(
-                    "asr x8,%4,2                        \n"
-                    // Load initial C values (4x4 block using 2x2 sub-blocks)
-                    "ldr  q0,   [%2]                    \n"  // C[0][0:1]
-                    "ldr  q1,   [%2,  #16]              \n"  // C[0][2:3]
-                    "add  x13,  %2,      %3             \n"  // C[1]
-                    "ldr  q2,   [x13]                   \n"  // C[1][0:1]
-                    "ldr  q3,   [x13, #16]              \n"  // C[1][2:3]
-                    "add  x14,  x13,     %3             \n"  // C[2]
-                    "ldr  q4,   [x14]                   \n"  // C[2][0:1]
-                    "ldr  q5,   [x14, #16]              \n"  // C[2][2:3]
-                    "add  x15,  x14,     %3             \n"  // C[3]
-                    "ldr  q6,   [x15]                   \n"  // C[3][0:1]
-                    "ldr  q7,   [x15, #16]              \n"  // C[3][2:3]
-
-                    "run:                               \n"
-                    "   prfm pldl1keep, [%0, #512]      \n"
-                    "   prfm pldl1keep, [%1, #512]      \n"
-
-                    // Load A (4x4 block, 2 doubles per vector)
-                    "   ld1 {v8.2d,  v9.2d,  v10.2d, v11.2d},   [%0], #64 \n"  // A[0:1][0:3]
-                    "   ld1 {v12.2d, v13.2d, v14.2d, v15.2d},   [%0], #64 \n"  // A[2:3][0:3]
-
-                    // Load B (4x4 block, 2 doubles per vector)
-                    "   ld1 {v16.2d, v17.2d, v18.2d, v19.2d},   [%1], #64 \n"  // B[0:1][0:3]
-                    "   ld1 {v20.2d, v21.2d, v22.2d, v23.2d},   [%1], #64 \n"  // B[2:3][0:3]
-
-                    // Multiply-accumulate operations for C[0:3][0:3]
-                    "   fmla   v0.2d,   v16.2d,  v8.d[0]  \n"  // C[0][0:1] += B[0][0:1] * A[0][0]
-                    "   fmla   v1.2d,   v17.2d,  v8.d[0]  \n"  // C[0][2:3] += B[0][2:3] * A[0][0]
-                    "   fmla   v2.2d,   v16.2d,  v8.d[1]  \n"  // C[1][0:1] += B[0][0:1] * A[0][1]
-                    "   fmla   v3.2d,   v17.2d,  v8.d[1]  \n"  // C[1][2:3] += B[0][2:3] * A[0][1]
-                    "   fmla   v4.2d,   v16.2d,  v9.d[0]  \n"  // C[2][0:1] += B[0][0:1] * A[0][2]
-                    "   fmla   v5.2d,   v17.2d,  v9.d[0]  \n"  // C[2][2:3] += B[0][2:3] * A[0][2]
-                    "   fmla   v6.2d,   v16.2d,  v9.d[1]  \n"  // C[3][0:1] += B[0][0:1] * A[0][3]
-                    "   fmla   v7.2d,   v17.2d,  v9.d[1]  \n"  // C[3][2:3] += B[0][2:3] * A[0][3]
-
-                    "   fmla   v0.2d,   v18.2d,  v10.d[0] \n"  // C[0][0:1] += B[1][0:1] * A[1][0]
-                    "   fmla   v1.2d,   v19.2d,  v10.d[0] \n"  // C[0][2:3] += B[1][2:3] * A[1][0]
-                    "   fmla   v2.2d,   v18.2d,  v10.d[1] \n"  // C[1][0:1] += B[1][0:1] * A[1][1]
-                    "   fmla   v3.2d,   v19.2d,  v10.d[1] \n"  // C[1][2:3] += B[1][2:3] * A[1][1]
-                    "   fmla   v4.2d,   v18.2d,  v11.d[0] \n"  // C[2][0:1] += B[1][0:1] * A[1][2]
-                    "   fmla   v5.2d,   v19.2d,  v11.d[0] \n"  // C[2][2:3] += B[1][2:3] * A[1][2]
-                    "   fmla   v6.2d,   v18.2d,  v11.d[1] \n"  // C[3][0:1] += B[1][0:1] * A[1][3]
-                    "   fmla   v7.2d,   v19.2d,  v11.d[1] \n"  // C[3][2:3] += B[1][2:3] * A[1][3]
-
-                    "   fmla   v0.2d,   v20.2d,  v12.d[0] \n"  // C[0][0:1] += B[2][0:1] * A[2][0]
-                    "   fmla   v1.2d,   v21.2d,  v12.d[0] \n"  // C[0][2:3] += B[2][2:3] * A[2][0]
-                    "   fmla   v2.2d,   v20.2d,  v12.d[1] \n"  // C[1][0:1] += B[2][0:1] * A[2][1]
-                    "   fmla   v3.2d,   v21.2d,  v12.d[1] \n"  // C[1][2:3] += B[2][2:3] * A[2][1]
-                    "   fmla   v4.2d,   v20.2d,  v13.d[0] \n"  // C[2][0:1] += B[2][0:1] * A[2][2]
-                    "   fmla   v5.2d,   v21.2d,  v13.d[0] \n"  // C[2][2:3] += B[2][2:3] * A[2][2]
-                    "   fmla   v6.2d,   v20.2d,  v13.d[1] \n"  // C[3][0:1] += B[2][0:1] * A[2][3]
-                    "   fmla   v7.2d,   v21.2d,  v13.d[1] \n"  // C[3][2:3] += B[2][2:3] * A[2][3]
-
-                    "   fmla   v0.2d,   v22.2d,  v14.d[0] \n"  // C[0][0:1] += B[3][0:1] * A[3][0]
-                    "   fmla   v1.2d,   v23.2d,  v14.d[0] \n"  // C[0][2:3] += B[3][2:3] * A[3][0]
-                    "   fmla   v2.2d,   v22.2d,  v14.d[1] \n"  // C[1][0:1] += B[3][0:1] * A[3][1]
-                    "   fmla   v3.2d,   v23.2d,  v14.d[1] \n"  // C[1][2:3] += B[3][2:3] * A[3][1]
-                    "   fmla   v4.2d,   v22.2d,  v15.d[0] \n"  // C[2][0:1] += B[3][0:1] * A[3][2]
-                    "   fmla   v5.2d,   v23.2d,  v15.d[0] \n"  // C[2][2:3] += B[3][2:3] * A[3][2]
-                    "   fmla   v6.2d,   v22.2d,  v15.d[1] \n"  // C[3][0:1] += B[3][0:1] * A[3][3]
-                    "   fmla   v7.2d,   v23.2d,  v15.d[1] \n"  // C[3][2:3] += B[3][2:3] * A[3][3]
-
-                    "   subs x8, x8, #1                 \n"
-                    "   bne run                         \n"
-
-                    // Store results back to C
-                    "   str q0, [%2]                    \n"  // Store C[0][0:1]
-                    "   str q1, [%2,  #16]              \n"  // Store C[0][2:3]
-                    "   str q2, [x13]                   \n"  // Store C[1][0:1]
-                    "   str q3, [x13, #16]              \n"  // Store C[1][2:3]
-                    "   str q4, [x14]                   \n"  // Store C[2][0:1]
-                    "   str q5, [x14, #16]              \n"  // Store C[2][2:3]
-                    "   str q6, [x15]                   \n"  // Store C[3][0:1]
-                    "   str q7, [x15, #16]              \n"  // Store C[3][2:3]
-                    "                                   \n"
-                    : "=r"(a), "=r"(b), "=r"(c), "=r"(ldc_offset), "=r"(p)
-                    : "0"(a), "1"(b), "2"(c), "3"(ldc_offset), "4"(p)
-                    : "memory", "cc", "x8", "x13", "x14","x15",
-            "v0", "v1", "v2", "v3", "v4", "v5", "v6", "v7",
-            "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15",
-            "v16", "v17", "v18", "v19", "v20", "v21", "v22", "v23");
-            c += 4;
-            a -= 4 * p;
-        } // endj
-        sc += ldc * 4;
-        c = sc;
-        a += 4 * p;
-        b = sb;
-    } // endi
+/*
+The kernel body lives in dgemm_neon_kernel.inc. The prefetch type is an
+immediate in the prfm encoding, so there is one copy per m_blas_prefetch
+value; kernel_4x4() picks the copy and the prefetch distance (prefetch_4x4,
+default 640 bytes) from the current config.
+*/
+#define PF_SUFFIX none
+#include "dgemm_neon_kernel.inc"
+
+#define PF_SUFFIX l1keep
+#define PF_OP     "pldl1keep"
+#include "dgemm_neon_kernel.inc"
+
+#define PF_SUFFIX l1strm
+#define PF_OP     "pldl1strm"
+#include "dgemm_neon_kernel.inc"
+
+#define PF_SUFFIX l2keep
+#define PF_OP     "pldl2keep"
+#include "dgemm_neon_kernel.inc"
+
+#define PF_SUFFIX l2strm
+#define PF_OP     "pldl2strm"
+#include "dgemm_neon_kernel.inc"
+
+void kernel_4x4(unsigned int m, unsigned int n, unsigned int p, double *sa, double *sb, double *sc, size_t ldc) {
+    static const m_blas_kernel_pf kernels[M_BLAS_PREFETCH_COUNT] = PF_TABLE(kernel_4x4);
+    const m_blas_config *cfg = dgemm_config_get();
+
+    kernels[cfg->prefetch_type](m, n, p, sa, sb, sc, ldc, cfg->prefetch_4x4, cfg->prefetch_4x4);
 }
 
 /**
@@ -197,7 +131,7 @@ c c c c d d d d e e e e f f f f
 
 Draw it with a line
 */
-void packA_4(unsigned int m, unsigned int p, double *from, unsigned int lda, double *to) {
+void packA_4(unsigned int m, unsigned int p, double *from, size_t lda, double *to) {
     int i, j;
     double *a_offset, *a_offset1, *a_offset2, *a_offset3, *a_offset4;
     double *b_offset;
@@ -294,7 +228,7 @@ Output:
 4 5 6 7 4 5 6 7 4 5 6 7 4 5 6 7
 c d e f c d e f c d e f c d e f
 */
-void packB_4(unsigned int p, unsigned int n, double *from, unsigned int ldb, double *to) {
+void packB_4(unsigned int p, unsigned int n, double *from, size_t ldb, double *to) {
     int i, j;
     double *a_offset, *a_offset1, *a_offset2, *a_offset3, *a_offset4;
     double *b_offset, *b_offset1;
@@ -373,33 +307,34 @@ void packB_4(unsigned int p, unsigned int n, double *from, unsigned int ldb, dou
 }
 
 //C(mxn) = A(mxp)*B(pxn)
-void dgemm_neon(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda, 
-                                                                double *b, unsigned int ldb,
-                                                                double *c, unsigned int ldc, 
-                                                                double *sa, double *sb) {
+void dgemm_neon_64(size_t m, size_t n, size_t p, double *a, size_t lda,
+                                                 double *b, size_t ldb,
+                                                 double *c, size_t ldc,
+                                                 double *sa, double *sb) {
 
-    unsigned int ms, mms, ns, ps;
-    unsigned int min_m, min_mm, min_n, min_p;
+    size_t ms, mms, ns, ps;
+    size_t min_m, min_mm, min_n, min_p;
     int l1stride = 1;
-    for (ms = 0; ms < m; ms += GEMM_M) {
+    const m_blas_config *cfg = dgemm_config_get();
+    for (ms = 0; ms < m; ms += cfg->gemm_m) {
         min_m = m - ms;
-        if (min_m > GEMM_M) {
-            min_m = GEMM_M;
+        if (min_m > cfg->gemm_m) {
+            min_m = cfg->gemm_m;
         }
 
         for (ps = 0; ps < p; ps += min_p) {
             min_p = p - ps;
-            if (min_p >= (GEMM_P << 1)) {
-                min_p = GEMM_P;
-            } else if (min_p > GEMM_P) {
+            if (min_p >= (cfg->gemm_p << 1)) {
+                min_p = cfg->gemm_p;
+            } else if (min_p > cfg->gemm_p) {
                 min_p = (min_p / 2 + GEMM_UNROLL - 1) & ~(GEMM_UNROLL - 1);
             }
 
             // first packB
             min_n = n;
-            if (n >= GEMM_N * 2) {
-                min_n = GEMM_N;
-            } else if (n > GEMM_N) {
+            if (n >= cfg->gemm_n * 2) {
+                min_n = cfg->gemm_n;
+            } else if (n > cfg->gemm_n) {
                 min_n = (min_n / 2 + GEMM_UNROLL - 1) & ~(GEMM_UNROLL - 1);
             } else {
                 l1stride = 0;
@@ -428,9 +363,9 @@ void dgemm_neon(unsigned int m, unsigned int n, unsigned int p, double *a, unsig
             // the first B Block has been packed, proc the others
             for (ns = min_n; ns < n; ns += min_n) {
                 min_n = n - ns;
-                if (min_n >= GEMM_N * 2) {
-                    min_n = GEMM_N;
-                } else if (min_n > GEMM_N) {
+                if (min_n >= cfg->gemm_n * 2) {
+                    min_n = cfg->gemm_n;
+                } else if (min_n > cfg->gemm_n) {
                     min_n = (min_n / 2 + GEMM_UNROLL - 1) & ~(GEMM_UNROLL - 1);
                 }
 
@@ -441,4 +376,12 @@ void dgemm_neon(unsigned int m, unsigned int n, unsigned int p, double *a, unsig
     }
 }
 
+// 32-bit interface, forwards to dgemm_neon_64
+void dgemm_neon(unsigned int m, unsigned int n, unsigned int p, double *a, unsigned int lda, 
+                                                                double *b, unsigned int ldb,
+                                                                double *c, unsigned int ldc, 
+                                                                double *sa, double *sb) {
+    dgemm_neon_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+}
+
 #endif
\ No newline at end of file
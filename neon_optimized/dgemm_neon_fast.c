@@ -0,0 +1,1706 @@
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+
+#include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "blas_dgemm.h"
+#include "dgemm_prefetch.h"
+
+/* 矩阵按行优先顺序存储的宏定义 */
+#define A(i, j) a[(i) * lda + (j)]
+#define B(i, j) b[(i) * ldb + (j)]
+#define C(i, j) c[(i) * ldc + (j)]
+
+#define min(i, j) ((i) < (j) ? (i) : (j))
+
+/**
+ * ============================================================================
+ * ARM NEON 高度优化的 DGEMM 实现 (双精度矩阵乘法)
+ * ============================================================================
+ * 
+ * 主要优化技术：
+ * 
+ * 1. 向量化的数据打包函数
+ *    - 使用 NEON intrinsics 替代标量操作
+ *    - 预期性能提升：2-3倍
+ * 
+ * 2. 优化的 4x4 计算核心
+ *    - 改进的指令调度，减少流水线停顿
+ *    - 交错的加载和计算，隐藏内存延迟
+ *    - 预取距离优化（640字节）
+ * 
+ * 3. 高性能 4x8 计算核心
+ *    - 更大的计算块，提高计算密度
+ *    - 充分利用32个NEON寄存器
+ *    - 更好地摊销循环开销
+ * 
+ * 4. 智能内核选择
+ *    - 根据矩阵维度自动选择最优内核
+ *    - 4x8 内核用于 n 是 8 的倍数的情况
+ *    - 4x4 内核用于其他情况
+ * 
+ * 5. 改进的预取策略
+ *    - 更激进的预取距离
+ *    - 预取距离与类型（L1/L2、keep/strm、不预取）运行时可选
+ * 
+ * 6. 软件流水的 4x8 计算核心
+ *    - 双缓冲 A/B 寄存器，提前一个 k 步装载
+ *    - 隐藏 A53 等顺序核上的 L1 装载延迟
+ * 
+ * 7. 融合的 B 打包
+ *    - 第一个 4 行微面板边计算边打包 B，省去一次 B 的完整读取
+ * 
+ * 8. C 的写回方式
+ *    - beta = 0 的第一个 k 块不读 C，累加器直接清零
+ *    - C 大于最后一级缓存时，最后一个 k 块用 stnp 非临时存储写回
+ *    - 计算当前 C 块前写预取同一行的下一个 C 块
+ * 
+ * 9. 多线程（OpenMP）
+ *    - 线程按形状排成 M x N 的网格，每个线程计算一个 (行组, 列组) 子块
+ *    - B 块由所有线程合作打包并共享，线程数见 m_blas_config.threads
+ *    - 计算当前 B 块时穿插打包下一个 B 块，sb 两半轮流使用
+ *    - 不打包的直接路径把 C 块交给常驻线程池（dgemm_pool.c），开销比 OpenMP 区域小
+ * 
+ * 预期总体性能提升：15-30%
+ * ============================================================================
+ */
+
+// 分块大小 GEMM_M / GEMM_N / GEMM_P 与内核的预取距离、类型在运行时
+// 由 dgemm_config_get() 提供（默认 2048 / 256 / 128，见 dgemm_config.c）
+#define GEMM_UNROLL (4)
+
+// 4x8 路径是否使用软件流水内核（kernel_4x8_pipe），0 则退回 kernel_4x8_fast
+#define USE_PIPELINED_4x8 (1)
+
+// 4x8 路径是否把 B 的打包融合进第一个 4 行微面板的计算（kernel_4x8_packB），0 则先整体打包
+#define USE_FUSED_PACK_B (1)
+
+// 是否在计算当前 B 块的同时打包下一个 B 块（sb 分成两半轮流使用），0 则算完再打包
+#define USE_PIPELINED_PACK_B (1)
+
+/**
+ * ============================================================================
+ * 计算内核的预取策略实例
+ * ============================================================================
+ *
+ * kernel_4x4_fast / kernel_4x8_fast / kernel_4x8_pipe 的实现在
+ * dgemm_neon_fast_kernels.inc 中，按 m_blas_prefetch 的每种预取类型各实例化一份。
+ * 下面的同名函数按当前配置（prefetch_type 以及预取距离）选择实例，
+ * 切换预取策略无需重新编译（配置文件、DGEMM_PREFETCH 环境变量或 dgemm_autotune）。
+ * 带 _mode 后缀的版本多一个 c_mode（M_BLAS_C_* 标志，见 dgemm_prefetch.h），
+ * 供驱动按 beta 与 C 的大小选择 C 的写回方式；公开的内核总是先读 C 再累加。
+ * ============================================================================
+ */
+#define PF_SUFFIX none
+#include "dgemm_neon_fast_kernels.inc"
+
+#define PF_SUFFIX l1keep
+#define PF_OP     "pldl1keep"
+#include "dgemm_neon_fast_kernels.inc"
+
+#define PF_SUFFIX l1strm
+#define PF_OP     "pldl1strm"
+#include "dgemm_neon_fast_kernels.inc"
+
+#define PF_SUFFIX l2keep
+#define PF_OP     "pldl2keep"
+#include "dgemm_neon_fast_kernels.inc"
+
+#define PF_SUFFIX l2strm
+#define PF_OP     "pldl2strm"
+#include "dgemm_neon_fast_kernels.inc"
+
+static void kernel_4x4_fast_mode(unsigned int m, unsigned int n, unsigned int p,
+                                 double *sa, double *sb, double *sc, size_t ldc,
+                                 unsigned long c_mode) {
+    static const m_blas_kernel_pfc kernels[M_BLAS_PREFETCH_COUNT] = PF_TABLE(kernel_4x4_fast);
+    const m_blas_config *cfg = dgemm_config_get();
+
+    kernels[cfg->prefetch_type](m, n, p, sa, sb, sc, ldc,
+                                cfg->prefetch_4x4, cfg->prefetch_4x4, c_mode);
+}
+
+void kernel_4x4_fast(unsigned int m, unsigned int n, unsigned int p,
+                     double *sa, double *sb, double *sc, size_t ldc) {
+    kernel_4x4_fast_mode(m, n, p, sa, sb, sc, ldc, 0);
+}
+
+static void kernel_4x8_fast_mode(unsigned int m, unsigned int n, unsigned int p,
+                                 double *sa, double *sb, double *sc, size_t ldc,
+                                 unsigned long c_mode) {
+    static const m_blas_kernel_pfc kernels[M_BLAS_PREFETCH_COUNT] = PF_TABLE(kernel_4x8_fast);
+    const m_blas_config *cfg = dgemm_config_get();
+
+    kernels[cfg->prefetch_type](m, n, p, sa, sb, sc, ldc,
+                                cfg->prefetch_a, cfg->prefetch_b, c_mode);
+}
+
+void kernel_4x8_fast(unsigned int m, unsigned int n, unsigned int p,
+                     double *sa, double *sb, double *sc, size_t ldc) {
+    kernel_4x8_fast_mode(m, n, p, sa, sb, sc, ldc, 0);
+}
+
+static void kernel_4x8_pipe_mode(unsigned int m, unsigned int n, unsigned int p,
+                                 double *sa, double *sb, double *sc, size_t ldc,
+                                 unsigned long c_mode) {
+    static const m_blas_kernel_pfc kernels[M_BLAS_PREFETCH_COUNT] = PF_TABLE(kernel_4x8_pipe);
+    const m_blas_config *cfg = dgemm_config_get();
+
+    kernels[cfg->prefetch_type](m, n, p, sa, sb, sc, ldc,
+                                cfg->prefetch_a, cfg->prefetch_b, c_mode);
+}
+
+void kernel_4x8_pipe(unsigned int m, unsigned int n, unsigned int p,
+                     double *sa, double *sb, double *sc, size_t ldc) {
+    kernel_4x8_pipe_mode(m, n, p, sa, sb, sc, ldc, 0);
+}
+
+/**
+ * ============================================================================
+ * 向量化的 A 矩阵打包函数
+ * ============================================================================
+ * 
+ * 使用 NEON intrinsics 替代标量操作
+ * 
+ * 性能提升：相比标量版本快 2-3 倍
+ * 
+ * 打包模式：将 4x4 块转置并按列存储
+ * 输入: 行优先的 4x4 块
+ * 输出: 转置后的列优先格式
+ * 
+ * 转置在寄存器内完成：两行的同一对列向量经 vzip1q/vzip2q 得到
+ * {a0[k], a1[k]} 与 {a0[k+1], a1[k+1]}，每个 4x4 块 8 次 128 位存储，
+ * 而不是 16 次 64 位存储（打包原本受存储带宽限制）。
+ * 
+ * p 不是 4 的倍数时剩余列逐个复制，供生成的内核复用
+ * ============================================================================
+ */
+void packA_4_fast(unsigned int m, unsigned int p, double *from, size_t lda, double *to) {
+    unsigned int j, i;
+    double *a_offset = from;
+    double *b_offset = to;
+    
+    j = (m >> 2);  // 每次处理4行
+    while (j > 0) {
+        double *a0 = a_offset;
+        double *a1 = a0 + lda;
+        double *a2 = a1 + lda;
+        double *a3 = a2 + lda;
+        a_offset += 4 * lda;
+        
+        i = (p >> 2);  // 每次处理4列
+        while (i > 0) {
+            // 使用 NEON 加载 4x4 块
+            float64x2_t v0_01 = vld1q_f64(a0);      // a0[0:1]
+            float64x2_t v0_23 = vld1q_f64(a0 + 2);  // a0[2:3]
+            float64x2_t v1_01 = vld1q_f64(a1);      // a1[0:1]
+            float64x2_t v1_23 = vld1q_f64(a1 + 2);  // a1[2:3]
+            float64x2_t v2_01 = vld1q_f64(a2);      // a2[0:1]
+            float64x2_t v2_23 = vld1q_f64(a2 + 2);  // a2[2:3]
+            float64x2_t v3_01 = vld1q_f64(a3);      // a3[0:1]
+            float64x2_t v3_23 = vld1q_f64(a3 + 2);  // a3[2:3]
+
+            // 寄存器内转置：vzip1q 取两行的低半，vzip2q 取高半
+            // 列 0
+            vst1q_f64(b_offset,      vzip1q_f64(v0_01, v1_01));  // a0[0] a1[0]
+            vst1q_f64(b_offset + 2,  vzip1q_f64(v2_01, v3_01));  // a2[0] a3[0]
+            // 列 1
+            vst1q_f64(b_offset + 4,  vzip2q_f64(v0_01, v1_01));  // a0[1] a1[1]
+            vst1q_f64(b_offset + 6,  vzip2q_f64(v2_01, v3_01));  // a2[1] a3[1]
+            // 列 2
+            vst1q_f64(b_offset + 8,  vzip1q_f64(v0_23, v1_23));  // a0[2] a1[2]
+            vst1q_f64(b_offset + 10, vzip1q_f64(v2_23, v3_23));  // a2[2] a3[2]
+            // 列 3
+            vst1q_f64(b_offset + 12, vzip2q_f64(v0_23, v1_23));  // a0[3] a1[3]
+            vst1q_f64(b_offset + 14, vzip2q_f64(v2_23, v3_23));  // a2[3] a3[3]
+
+            a0 += 4;
+            a1 += 4;
+            a2 += 4;
+            a3 += 4;
+            b_offset += 16;
+            i--;
+        }
+
+        // 剩余列
+        for (i = 0; i < (p & 3); i++) {
+            b_offset[0] = a0[i];
+            b_offset[1] = a1[i];
+            b_offset[2] = a2[i];
+            b_offset[3] = a3[i];
+            b_offset += 4;
+        }
+        j--;
+    }
+}
+
+/**
+ * ============================================================================
+ * 8 行的 A 矩阵打包函数（用于 8xN 内核）
+ * ============================================================================
+ * 
+ * 每 8 行一组，组内按 k 交错存放 8 个元素：a0[k] a1[k] ... a7[k]
+ * 与 packA_4_fast 相同，用 vzip1q/vzip2q 在寄存器内转置，
+ * 每次处理 2 列：8 次 128 位装载、8 次 128 位存储
+ * 
+ * 要求 m 是 8 的倍数，p 任意
+ * ============================================================================
+ */
+void packA_8_fast(unsigned int m, unsigned int p, double *from, size_t lda, double *to) {
+    unsigned int j, i, r;
+    double *a_offset = from;
+    double *b_offset = to;
+    
+    j = (m >> 3);  // 每次处理8行
+    while (j > 0) {
+        double *a0 = a_offset;
+        double *a1 = a0 + lda;
+        double *a2 = a1 + lda;
+        double *a3 = a2 + lda;
+        double *a4 = a3 + lda;
+        double *a5 = a4 + lda;
+        double *a6 = a5 + lda;
+        double *a7 = a6 + lda;
+        a_offset += 8 * lda;
+        
+        i = (p >> 1);  // 每次处理2列
+        while (i > 0) {
+            float64x2_t v0 = vld1q_f64(a0);  // a0[0:1]
+            float64x2_t v1 = vld1q_f64(a1);
+            float64x2_t v2 = vld1q_f64(a2);
+            float64x2_t v3 = vld1q_f64(a3);
+            float64x2_t v4 = vld1q_f64(a4);
+            float64x2_t v5 = vld1q_f64(a5);
+            float64x2_t v6 = vld1q_f64(a6);
+            float64x2_t v7 = vld1q_f64(a7);
+
+            // 列 0
+            vst1q_f64(b_offset,      vzip1q_f64(v0, v1));  // a0[0] a1[0]
+            vst1q_f64(b_offset + 2,  vzip1q_f64(v2, v3));  // a2[0] a3[0]
+            vst1q_f64(b_offset + 4,  vzip1q_f64(v4, v5));  // a4[0] a5[0]
+            vst1q_f64(b_offset + 6,  vzip1q_f64(v6, v7));  // a6[0] a7[0]
+            // 列 1
+            vst1q_f64(b_offset + 8,  vzip2q_f64(v0, v1));  // a0[1] a1[1]
+            vst1q_f64(b_offset + 10, vzip2q_f64(v2, v3));  // a2[1] a3[1]
+            vst1q_f64(b_offset + 12, vzip2q_f64(v4, v5));  // a4[1] a5[1]
+            vst1q_f64(b_offset + 14, vzip2q_f64(v6, v7));  // a6[1] a7[1]
+
+            a0 += 2;
+            a1 += 2;
+            a2 += 2;
+            a3 += 2;
+            a4 += 2;
+            a5 += 2;
+            a6 += 2;
+            a7 += 2;
+            b_offset += 16;
+            i--;
+        }
+
+        // 剩余一列
+        if (p & 1) {
+            double *rows[8] = { a0, a1, a2, a3, a4, a5, a6, a7 };
+            for (r = 0; r < 8; r++) {
+                b_offset[r] = rows[r][0];
+            }
+            b_offset += 8;
+        }
+        j--;
+    }
+}
+
+/**
+ * ============================================================================
+ * 向量化的 B 矩阵打包函数（用于 4x4 内核）
+ * ============================================================================
+ * 
+ * 使用 NEON intrinsics 替代标量操作
+ * 性能提升：相比标量版本快 2-3 倍
+ * 
+ * 打包模式：按行优先存储 4x4 块
+ * ============================================================================
+ */
+void packB_4_fast(unsigned int p, unsigned int n, double *from, size_t ldb, double *to) {
+    unsigned int j, i;
+    double *a_offset = from;
+    double *b_offset = to;
+    
+    j = (p >> 2);
+    while (j > 0) {
+        double *a0 = a_offset;
+        double *a1 = a0 + ldb;
+        double *a2 = a1 + ldb;
+        double *a3 = a2 + ldb;
+        a_offset += 4 * ldb;
+        
+        double *b_out = b_offset;
+        b_offset += 16;
+        
+        i = (n >> 2);
+        while (i > 0) {
+            // 使用 NEON 加载 4x4 块
+            float64x2_t v0_01 = vld1q_f64(a0);
+            float64x2_t v0_23 = vld1q_f64(a0 + 2);
+            float64x2_t v1_01 = vld1q_f64(a1);
+            float64x2_t v1_23 = vld1q_f64(a1 + 2);
+            float64x2_t v2_01 = vld1q_f64(a2);
+            float64x2_t v2_23 = vld1q_f64(a2 + 2);
+            float64x2_t v3_01 = vld1q_f64(a3);
+            float64x2_t v3_23 = vld1q_f64(a3 + 2);
+
+            // 按行优先顺序存储
+            vst1q_f64(b_out,      v0_01);
+            vst1q_f64(b_out + 2,  v0_23);
+            vst1q_f64(b_out + 4,  v1_01);
+            vst1q_f64(b_out + 6,  v1_23);
+            vst1q_f64(b_out + 8,  v2_01);
+            vst1q_f64(b_out + 10, v2_23);
+            vst1q_f64(b_out + 12, v3_01);
+            vst1q_f64(b_out + 14, v3_23);
+
+            a0 += 4;
+            a1 += 4;
+            a2 += 4;
+            a3 += 4;
+            b_out += p * 4;
+            i--;
+        }
+        j--;
+    }
+}
+
+/**
+ * ============================================================================
+ * 增强的 B 矩阵打包函数（用于 4x8 内核）
+ * ============================================================================
+ * 
+ * 每次打包 4x8 块以配合 4x8 计算内核
+ * 充分利用向量化，提高打包速度
+ * ============================================================================
+ */
+void packB_8_fast(unsigned int p, unsigned int n, double *from, size_t ldb, double *to) {
+    unsigned int j, i;
+    double *a_offset = from;
+    double *b_offset = to;
+    
+    j = (p >> 2);
+    while (j > 0) {
+        double *a0 = a_offset;
+        double *a1 = a0 + ldb;
+        double *a2 = a1 + ldb;
+        double *a3 = a2 + ldb;
+        a_offset += 4 * ldb;
+        
+        double *b_out = b_offset;
+        b_offset += 32;  // 4行 * 8列
+        
+        i = (n >> 3);  // 每次处理8列
+        while (i > 0) {
+            // 加载 4x8 块
+            float64x2_t v0_01 = vld1q_f64(a0);
+            float64x2_t v0_23 = vld1q_f64(a0 + 2);
+            float64x2_t v0_45 = vld1q_f64(a0 + 4);
+            float64x2_t v0_67 = vld1q_f64(a0 + 6);
+            
+            float64x2_t v1_01 = vld1q_f64(a1);
+            float64x2_t v1_23 = vld1q_f64(a1 + 2);
+            float64x2_t v1_45 = vld1q_f64(a1 + 4);
+            float64x2_t v1_67 = vld1q_f64(a1 + 6);
+            
+            float64x2_t v2_01 = vld1q_f64(a2);
+            float64x2_t v2_23 = vld1q_f64(a2 + 2);
+            float64x2_t v2_45 = vld1q_f64(a2 + 4);
+            float64x2_t v2_67 = vld1q_f64(a2 + 6);
+            
+            float64x2_t v3_01 = vld1q_f64(a3);
+            float64x2_t v3_23 = vld1q_f64(a3 + 2);
+            float64x2_t v3_45 = vld1q_f64(a3 + 4);
+            float64x2_t v3_67 = vld1q_f64(a3 + 6);
+
+            // 按行存储
+            vst1q_f64(b_out,      v0_01);
+            vst1q_f64(b_out + 2,  v0_23);
+            vst1q_f64(b_out + 4,  v0_45);
+            vst1q_f64(b_out + 6,  v0_67);
+            vst1q_f64(b_out + 8,  v1_01);
+            vst1q_f64(b_out + 10, v1_23);
+            vst1q_f64(b_out + 12, v1_45);
+            vst1q_f64(b_out + 14, v1_67);
+            vst1q_f64(b_out + 16, v2_01);
+            vst1q_f64(b_out + 18, v2_23);
+            vst1q_f64(b_out + 20, v2_45);
+            vst1q_f64(b_out + 22, v2_67);
+            vst1q_f64(b_out + 24, v3_01);
+            vst1q_f64(b_out + 26, v3_23);
+            vst1q_f64(b_out + 28, v3_45);
+            vst1q_f64(b_out + 30, v3_67);
+
+            a0 += 8;
+            a1 += 8;
+            a2 += 8;
+            a3 += 8;
+            b_out += p * 8;
+            i--;
+        }
+        j--;
+    }
+}
+
+/**
+ * ============================================================================
+ * 不打包的直接计算路径
+ * ============================================================================
+ * 
+ * 中等规模（48~128）时 A、B 整个放得进 L2，packA_4_fast / packB_8_fast
+ * 的复制纯属额外开销。这里的内核直接读取行优先的 A、B：
+ * 
+ *   A - 每行按 lda 步长各取 2 个 k（一次 128 位装载），用 vfmaq_laneq_f64
+ *       按通道广播，相当于 2 个 k 步各一次标量广播
+ *   B - 第 k 行连续的 8（或 4）列，按 ldb 步长逐行前进
+ * 
+ * 外层按 B 的 8 列条带循环，p x 8 的条带在 L1 中被所有行块复用。
+ * 是否走这条路径由 dgemm_neon_auto 按 direct_max_mnp 决定
+ * （默认按 L2 容量推导，dgemm_autotune 实测交叉点后写入配置）。
+ * 
+ * 要求 m、n 是 4 的倍数，p 任意
+ * ============================================================================
+ */
+
+// C 第 r 行的 4 个向量 += B 第 k 行 * A[r][k]（va 的第 lane 个通道）
+#define DIRECT_FMA_4x8(r, va, lane)                             \
+    c##r##0 = vfmaq_laneq_f64(c##r##0, b0, va, lane);           \
+    c##r##1 = vfmaq_laneq_f64(c##r##1, b1, va, lane);           \
+    c##r##2 = vfmaq_laneq_f64(c##r##2, b2, va, lane);           \
+    c##r##3 = vfmaq_laneq_f64(c##r##3, b3, va, lane)
+
+#define DIRECT_FMA_4x4(r, va, lane)                             \
+    c##r##0 = vfmaq_laneq_f64(c##r##0, b0, va, lane);           \
+    c##r##1 = vfmaq_laneq_f64(c##r##1, b1, va, lane)
+
+static void kernel_4x8_direct(size_t p, const double *a, size_t lda,
+                              const double *b, size_t ldb,
+                              double *c, size_t ldc) {
+    const double *a0 = a, *a1 = a0 + lda, *a2 = a1 + lda, *a3 = a2 + lda;
+    double *c0 = c, *c1 = c0 + ldc, *c2 = c1 + ldc, *c3 = c2 + ldc;
+    float64x2_t va0, va1, va2, va3, b0, b1, b2, b3;
+    size_t k;
+
+    // 加载 C（4x8 块 = 16个向量寄存器）
+    float64x2_t c00 = vld1q_f64(c0), c01 = vld1q_f64(c0 + 2), c02 = vld1q_f64(c0 + 4), c03 = vld1q_f64(c0 + 6);
+    float64x2_t c10 = vld1q_f64(c1), c11 = vld1q_f64(c1 + 2), c12 = vld1q_f64(c1 + 4), c13 = vld1q_f64(c1 + 6);
+    float64x2_t c20 = vld1q_f64(c2), c21 = vld1q_f64(c2 + 2), c22 = vld1q_f64(c2 + 4), c23 = vld1q_f64(c2 + 6);
+    float64x2_t c30 = vld1q_f64(c3), c31 = vld1q_f64(c3 + 2), c32 = vld1q_f64(c3 + 4), c33 = vld1q_f64(c3 + 6);
+
+    for (k = 0; k + 1 < p; k += 2) {
+        va0 = vld1q_f64(a0 + k);  // A[0][k:k+1]
+        va1 = vld1q_f64(a1 + k);
+        va2 = vld1q_f64(a2 + k);
+        va3 = vld1q_f64(a3 + k);
+
+        // 第 k 步
+        b0 = vld1q_f64(b);
+        b1 = vld1q_f64(b + 2);
+        b2 = vld1q_f64(b + 4);
+        b3 = vld1q_f64(b + 6);
+        DIRECT_FMA_4x8(0, va0, 0);
+        DIRECT_FMA_4x8(1, va1, 0);
+        DIRECT_FMA_4x8(2, va2, 0);
+        DIRECT_FMA_4x8(3, va3, 0);
+        b += ldb;
+
+        // 第 k+1 步
+        b0 = vld1q_f64(b);
+        b1 = vld1q_f64(b + 2);
+        b2 = vld1q_f64(b + 4);
+        b3 = vld1q_f64(b + 6);
+        DIRECT_FMA_4x8(0, va0, 1);
+        DIRECT_FMA_4x8(1, va1, 1);
+        DIRECT_FMA_4x8(2, va2, 1);
+        DIRECT_FMA_4x8(3, va3, 1);
+        b += ldb;
+    }
+
+    // p 为奇数时的最后一步
+    if (k < p) {
+        va0 = vld1q_dup_f64(a0 + k);
+        va1 = vld1q_dup_f64(a1 + k);
+        va2 = vld1q_dup_f64(a2 + k);
+        va3 = vld1q_dup_f64(a3 + k);
+        b0 = vld1q_f64(b);
+        b1 = vld1q_f64(b + 2);
+        b2 = vld1q_f64(b + 4);
+        b3 = vld1q_f64(b + 6);
+        DIRECT_FMA_4x8(0, va0, 0);
+        DIRECT_FMA_4x8(1, va1, 0);
+        DIRECT_FMA_4x8(2, va2, 0);
+        DIRECT_FMA_4x8(3, va3, 0);
+    }
+
+    vst1q_f64(c0, c00); vst1q_f64(c0 + 2, c01); vst1q_f64(c0 + 4, c02); vst1q_f64(c0 + 6, c03);
+    vst1q_f64(c1, c10); vst1q_f64(c1 + 2, c11); vst1q_f64(c1 + 4, c12); vst1q_f64(c1 + 6, c13);
+    vst1q_f64(c2, c20); vst1q_f64(c2 + 2, c21); vst1q_f64(c2 + 4, c22); vst1q_f64(c2 + 6, c23);
+    vst1q_f64(c3, c30); vst1q_f64(c3 + 2, c31); vst1q_f64(c3 + 4, c32); vst1q_f64(c3 + 6, c33);
+}
+
+static void kernel_4x4_direct(size_t p, const double *a, size_t lda,
+                              const double *b, size_t ldb,
+                              double *c, size_t ldc) {
+    const double *a0 = a, *a1 = a0 + lda, *a2 = a1 + lda, *a3 = a2 + lda;
+    double *c0 = c, *c1 = c0 + ldc, *c2 = c1 + ldc, *c3 = c2 + ldc;
+    float64x2_t va0, va1, va2, va3, b0, b1;
+    size_t k;
+
+    float64x2_t c00 = vld1q_f64(c0), c01 = vld1q_f64(c0 + 2);
+    float64x2_t c10 = vld1q_f64(c1), c11 = vld1q_f64(c1 + 2);
+    float64x2_t c20 = vld1q_f64(c2), c21 = vld1q_f64(c2 + 2);
+    float64x2_t c30 = vld1q_f64(c3), c31 = vld1q_f64(c3 + 2);
+
+    for (k = 0; k + 1 < p; k += 2) {
+        va0 = vld1q_f64(a0 + k);
+        va1 = vld1q_f64(a1 + k);
+        va2 = vld1q_f64(a2 + k);
+        va3 = vld1q_f64(a3 + k);
+
+        b0 = vld1q_f64(b);
+        b1 = vld1q_f64(b + 2);
+        DIRECT_FMA_4x4(0, va0, 0);
+        DIRECT_FMA_4x4(1, va1, 0);
+        DIRECT_FMA_4x4(2, va2, 0);
+        DIRECT_FMA_4x4(3, va3, 0);
+        b += ldb;
+
+        b0 = vld1q_f64(b);
+        b1 = vld1q_f64(b + 2);
+        DIRECT_FMA_4x4(0, va0, 1);
+        DIRECT_FMA_4x4(1, va1, 1);
+        DIRECT_FMA_4x4(2, va2, 1);
+        DIRECT_FMA_4x4(3, va3, 1);
+        b += ldb;
+    }
+
+    if (k < p) {
+        va0 = vld1q_dup_f64(a0 + k);
+        va1 = vld1q_dup_f64(a1 + k);
+        va2 = vld1q_dup_f64(a2 + k);
+        va3 = vld1q_dup_f64(a3 + k);
+        b0 = vld1q_f64(b);
+        b1 = vld1q_f64(b + 2);
+        DIRECT_FMA_4x4(0, va0, 0);
+        DIRECT_FMA_4x4(1, va1, 0);
+        DIRECT_FMA_4x4(2, va2, 0);
+        DIRECT_FMA_4x4(3, va3, 0);
+    }
+
+    vst1q_f64(c0, c00); vst1q_f64(c0 + 2, c01);
+    vst1q_f64(c1, c10); vst1q_f64(c1 + 2, c11);
+    vst1q_f64(c2, c20); vst1q_f64(c2 + 2, c21);
+    vst1q_f64(c3, c30); vst1q_f64(c3 + 2, c31);
+}
+
+// 多线程时每个任务计算一个 DIRECT_TASK_ROWS 行 x 8 列（最后一条可能是 4 列）的 C 块
+#define DIRECT_TASK_ROWS (32)
+
+typedef struct {
+    size_t m, n, p;
+    double *a, *b, *c;
+    size_t lda, ldb, ldc;
+    size_t row_tasks;           // 每条 8 列分成几个行块
+    size_t blocks, parts;       // C 块总数；分给几个线程（每个线程一段连续的 C 块）
+} direct_args;
+
+// 计算 C 中 [i0, i1) 行、从 j 开始的 8（不足时 4）列
+static void direct_block(const direct_args *d, size_t i0, size_t i1, size_t j) {
+    size_t i;
+
+    if (j + 8 <= d->n) {
+        for (i = i0; i < i1; i += 4) {
+            kernel_4x8_direct(d->p, d->a + i * d->lda, d->lda, d->b + j, d->ldb,
+                              d->c + i * d->ldc + j, d->ldc);
+        }
+    } else {
+        for (i = i0; i < i1; i += 4) {
+            kernel_4x4_direct(d->p, d->a + i * d->lda, d->lda, d->b + j, d->ldb,
+                              d->c + i * d->ldc + j, d->ldc);
+        }
+    }
+}
+
+// 第 index 个线程的一段 C 块，同一条 8 列的行块相邻
+static void direct_task(void *arg, size_t index) {
+    const direct_args *d = (const direct_args*)arg;
+    size_t t, i0, i1;
+
+    for (t = d->blocks * index / d->parts; t < d->blocks * (index + 1) / d->parts; t++) {
+        i0 = t % d->row_tasks * DIRECT_TASK_ROWS;
+        i1 = i0 + DIRECT_TASK_ROWS < d->m ? i0 + DIRECT_TASK_ROWS : d->m;
+        direct_block(d, i0, i1, t / d->row_tasks * 8);
+    }
+}
+
+/**
+ * ============================================================================
+ * 转置操作数的打包函数
+ * ============================================================================
+ * 
+ * 打包后的 A 与 B 布局相同：每 4（或 8）个下标一组，组内按 k 交错，
+ * 各组连续存放。因此按存储方向读取转置的操作数时，不需要新的打包代码：
+ * 
+ *   A^T 以 p x m 存储，A(i, k) = from[k * lda + i]，同一 k 的 4 个 A 元素连续，
+ *       正是 packB_4_fast 读取 B 一行的方式
+ *   B^T 以 n x p 存储，B(k, j) = from[j * ldb + k]，同一组的 4 / 8 列各自沿 k 连续，
+ *       正是 packA_4_fast / packA_8_fast 读取 A 的方式（寄存器内转置）
+ * 
+ * 转置在打包时完成，不需要先显式转置整个矩阵
+ * ============================================================================
+ */
+
+// 打包 A(mxp)，from 为 p x m 存储的 A^T；p 须为 4 的倍数
+void packA_4_fast_trans(unsigned int m, unsigned int p, double *from, size_t lda, double *to) {
+    packB_4_fast(p, m, from, lda, to);
+}
+
+// 打包 B(pxn) 给 4x4 内核，from 为 n x p 存储的 B^T
+void packB_4_fast_trans(unsigned int p, unsigned int n, double *from, size_t ldb, double *to) {
+    packA_4_fast(n, p, from, ldb, to);
+}
+
+// 打包 B(pxn) 给 4x8 内核，from 为 n x p 存储的 B^T；n 须为 8 的倍数
+void packB_8_fast_trans(unsigned int p, unsigned int n, double *from, size_t ldb, double *to) {
+    packA_8_fast(n, p, from, ldb, to);
+}
+
+/**
+ * ============================================================================
+ * 打包 B 与第一个 4 行微面板的计算融合
+ * ============================================================================
+ * 
+ * 分开打包时，B 先被 packB_8_fast 从内存读一遍写入 sb，
+ * 再被第一个行块的内核从 sb 读一遍。融合后第一个 4 行微面板直接从原矩阵
+ * 读取 B 的每一行，计算的同时把它写进 sb（与 packB_8_fast 相同的布局），
+ * 之后的行块照常使用打包好的 B，每个 K 块少一次 B 的完整读取。
+ * 
+ * sa 为 packA_4_fast 打包好的 4 行微面板；n 须为 8 的倍数，p 任意
+ * c_mode 中的 M_BLAS_C_ZERO / M_BLAS_C_PREFETCH 与汇编内核相同；intrinsics 没有 stnp，
+ * M_BLAS_C_STREAM 时仍用普通存储（只涉及每个 B 块的前 4 行）
+ * ============================================================================
+ */
+
+// C 第 r 行的 4 个向量 += B 第 k 行 * A[r][k]（va 的第 lane 个通道）
+#define FUSED_FMA_ROW(r, va, lane)                              \
+    c##r##0 = vfmaq_laneq_f64(c##r##0, b0, va, lane);           \
+    c##r##1 = vfmaq_laneq_f64(c##r##1, b1, va, lane);           \
+    c##r##2 = vfmaq_laneq_f64(c##r##2, b2, va, lane);           \
+    c##r##3 = vfmaq_laneq_f64(c##r##3, b3, va, lane)
+
+static void kernel_4x8_packB(unsigned int p, unsigned int n, double *sa,
+                             double *b, size_t ldb, double *sb,
+                             double *c, size_t ldc, unsigned long c_mode) {
+    unsigned int j, k;
+
+    for (j = 0; j < n; j += 8) {
+        double *c0 = c + j, *c1 = c0 + ldc, *c2 = c1 + ldc, *c3 = c2 + ldc;
+        const double *a_k = sa;
+        const double *b_k = b + j;
+        double *b_out = sb + j * p;  // packB_8_fast 中第 j/8 个 8 列组
+        float64x2_t va01, va23, b0, b1, b2, b3;
+        float64x2_t c00, c01, c02, c03, c10, c11, c12, c13;
+        float64x2_t c20, c21, c22, c23, c30, c31, c32, c33;
+
+        if (c_mode & M_BLAS_C_PREFETCH) {
+            __builtin_prefetch(c0 + 8, 1, 3);
+            __builtin_prefetch(c1 + 8, 1, 3);
+            __builtin_prefetch(c2 + 8, 1, 3);
+            __builtin_prefetch(c3 + 8, 1, 3);
+        }
+        if (c_mode & M_BLAS_C_ZERO) {
+            c00 = c01 = c02 = c03 = c10 = c11 = c12 = c13 = vdupq_n_f64(0.0);
+            c20 = c21 = c22 = c23 = c30 = c31 = c32 = c33 = vdupq_n_f64(0.0);
+        } else {
+            c00 = vld1q_f64(c0); c01 = vld1q_f64(c0 + 2); c02 = vld1q_f64(c0 + 4); c03 = vld1q_f64(c0 + 6);
+            c10 = vld1q_f64(c1); c11 = vld1q_f64(c1 + 2); c12 = vld1q_f64(c1 + 4); c13 = vld1q_f64(c1 + 6);
+            c20 = vld1q_f64(c2); c21 = vld1q_f64(c2 + 2); c22 = vld1q_f64(c2 + 4); c23 = vld1q_f64(c2 + 6);
+            c30 = vld1q_f64(c3); c31 = vld1q_f64(c3 + 2); c32 = vld1q_f64(c3 + 4); c33 = vld1q_f64(c3 + 6);
+        }
+
+        for (k = 0; k < p; k++) {
+            // 从原矩阵读取 B 的第 k 行 8 列，同时写入打包缓冲区
+            b0 = vld1q_f64(b_k);
+            b1 = vld1q_f64(b_k + 2);
+            b2 = vld1q_f64(b_k + 4);
+            b3 = vld1q_f64(b_k + 6);
+            vst1q_f64(b_out,     b0);
+            vst1q_f64(b_out + 2, b1);
+            vst1q_f64(b_out + 4, b2);
+            vst1q_f64(b_out + 6, b3);
+
+            va01 = vld1q_f64(a_k);      // A[0:1][k]
+            va23 = vld1q_f64(a_k + 2);  // A[2:3][k]
+            FUSED_FMA_ROW(0, va01, 0);
+            FUSED_FMA_ROW(1, va01, 1);
+            FUSED_FMA_ROW(2, va23, 0);
+            FUSED_FMA_ROW(3, va23, 1);
+
+            a_k += 4;
+            b_k += ldb;
+            b_out += 8;
+        }
+
+        vst1q_f64(c0, c00); vst1q_f64(c0 + 2, c01); vst1q_f64(c0 + 4, c02); vst1q_f64(c0 + 6, c03);
+        vst1q_f64(c1, c10); vst1q_f64(c1 + 2, c11); vst1q_f64(c1 + 4, c12); vst1q_f64(c1 + 6, c13);
+        vst1q_f64(c2, c20); vst1q_f64(c2 + 2, c21); vst1q_f64(c2 + 4, c22); vst1q_f64(c2 + 6, c23);
+        vst1q_f64(c3, c30); vst1q_f64(c3 + 2, c31); vst1q_f64(c3 + 4, c32); vst1q_f64(c3 + 6, c33);
+    }
+}
+
+#if USE_PIPELINED_4x8
+#define kernel_4x8_select kernel_4x8_pipe_mode
+#else
+#define kernel_4x8_select kernel_4x8_fast_mode
+#endif
+
+// 打包 p x n 的 B 块中第 tid / nt 段列（按 n 选择 4x8 / 4x4 的打包，按 8 / 4 列组均分），
+// 写入 to 中这些列组的位置；nt = 1 时打包整个块。trans_b 时 from 指向 B^T 中对应的块
+static void packB_part(int trans_b, unsigned int p, unsigned int n,
+                       double *from, size_t ldb, double *to, unsigned int tid, unsigned int nt) {
+    unsigned int u = (n & 7) == 0 ? 8 : 4;
+    unsigned int x0 = n / u * tid / nt * u;
+    unsigned int x1 = n / u * (tid + 1) / nt * u;
+
+    if (x1 == x0) {
+        return;
+    }
+    from += trans_b ? x0 * ldb : x0;
+    to += (size_t)x0 * p;
+    if (u == 8) {
+        if (trans_b) {
+            packB_8_fast_trans(p, x1 - x0, from, ldb, to);
+        } else {
+            packB_8_fast(p, x1 - x0, from, ldb, to);
+        }
+    } else {
+        if (trans_b) {
+            packB_4_fast_trans(p, x1 - x0, from, ldb, to);
+        } else {
+            packB_4_fast(p, x1 - x0, from, ldb, to);
+        }
+    }
+}
+
+// 剩余 rest 的维度上的下一个分块：不少于两块时取 blk，不到两块时对半分（4 的倍数），
+// 否则取剩下的全部。blk 为 4 的倍数时结果不超过 blk
+static size_t fast_block(size_t rest, size_t blk) {
+    if (rest >= blk * 2) {
+        return blk;
+    }
+    if (rest > blk) {
+        return (rest / 2 + GEMM_UNROLL - 1) & ~(GEMM_UNROLL - 1);
+    }
+    return rest;
+}
+
+/**
+ * ============================================================================
+ * 流水化的 B 打包
+ * ============================================================================
+ *
+ * 不流水时每个 B 块都是：同步 -> 所有线程打包 B -> 同步 -> 计算，
+ * 打包期间没有计算，最慢的线程打包完之前其他线程都在等。
+ * sb 放得下两个 B 块（gemm_p * gemm_n 的两倍不超过 M_BLAS_PACK_SB_SIZE）时分成两半：
+ *
+ * 1. 计算当前块时，每个线程把自己那段列的下一个块分成 PIPE_STEPS 份，
+ *    每算完一段行（按 M 划分时是一个 A 微面板，否则 PIPE_ROWS 行）就按已算的
+ *    比例打包一部分，打包读 B 的访存和内核的乘加交错进行
+ * 2. 当前块算完后同步一次：下一个块已经打包好，当前这一半也没有线程再读，
+ *    可以用来打包再下一个块
+ *
+ * 每个块从两次同步减少为一次。下一个块是下一个 N 块，或者下一个 K 块的第一个 N 块；
+ * 单线程融合打包（kernel_4x8_packB）的块本来就边算边打包，不提前打包。
+ * 打包只改变时间顺序，不改变任何乘加的顺序，结果与不流水时逐位相同。
+ * ============================================================================
+ */
+
+// 下一个 B 块分成多少份穿插在计算中打包
+#define PIPE_STEPS (8)
+
+// 不按 A 微面板计算时，每计算多少行打包一份
+#define PIPE_ROWS (3 * GEMM_UNROLL)
+
+// 本线程在下一个 B 块中要打包的那段列，steps 为 0 表示没有
+typedef struct {
+    int trans_b;
+    unsigned int p, n;
+    double *from;
+    size_t ldb;
+    double *to;
+    unsigned int tid, nt;
+    unsigned int steps, done;
+} pack_job;
+
+static void pack_job_init(pack_job *job, int trans_b, unsigned int p, unsigned int n,
+                          double *from, size_t ldb, double *to, unsigned int tid, unsigned int nt) {
+    job->trans_b = trans_b;
+    job->p = p;
+    job->n = n;
+    job->from = from;
+    job->ldb = ldb;
+    job->to = to;
+    job->tid = tid;
+    job->nt = nt;
+    job->steps = PIPE_STEPS;
+    job->done = 0;
+}
+
+// 当前块已计算 done / total 时，把打包推进到相同的比例
+static void pack_job_run(pack_job *job, size_t done, size_t total) {
+    unsigned int upto = (unsigned int)(job->steps * done / total);
+
+    for (; job->done < upto; job->done++) {
+        packB_part(job->trans_b, job->p, job->n, job->from, job->ldb, job->to,
+                   job->tid * job->steps + job->done, job->nt * job->steps);
+    }
+}
+
+/**
+ * ============================================================================
+ * 主优化 DGEMM 函数
+ * ============================================================================
+ * 
+ * C(mxn) = A(mxp) * B(pxn)
+ * 
+ * 智能特性：
+ * 1. 根据矩阵维度自动选择最优计算内核
+ * 2. 当 n 是 8 的倍数时使用 4x8 内核（更快）
+ * 3. 其他情况使用 4x4 内核（通用）
+ * 4. 向量化的打包函数提速 2-3 倍
+ * 5. 优化的缓存分块策略（分块大小运行时取自 dgemm_config_get()）
+ * 6. 按 beta 与 C 的大小选择 C 的写回方式（M_BLAS_C_*）：
+ *    beta = 0 时第一个 k 块不读 C；C 大于 stream_c_bytes 时最后一个 k 块
+ *    用非临时存储；其余情况写预取下一个 C 块
+ * 7. 按 m_blas_config.threads 用 OpenMP 把 C 按行、列分给多个线程，B 块合作打包；
+ *    m、n 小而 p 大时按 K 划分，部分和归约到 C；共享 L2 的簇、大小核按拓扑分配
+ * 8. 每个 M 块只进入一次并行区域，计算当前 B 块的同时打包下一个 B 块
+ * 
+ * 参数：
+ *   m, n, p - 矩阵维度
+ *   a, b, c - 输入输出矩阵指针
+ *   lda, ldb, ldc - 各矩阵的 leading dimension
+ *   sa, sb - 预分配的打包缓冲区
+ * 
+ * 预期性能提升：相比原版 15-30%
+ * 
+ * dgemm_neon_fast_abt / dgemm_neon_fast_atb 共用同一个驱动，
+ * 只是打包时按存储方向读取转置的操作数
+ * ============================================================================
+ */
+
+// C = beta * C，beta = 0 时直接写 0（不读 C，C 中的 NaN 也不传播）
+static void scale_c(size_t m, size_t n, double beta, double *c, size_t ldc) {
+    size_t i, j;
+
+    for (i = 0; i < m; i++) {
+        double *c_i = c + i * ldc;
+
+        if (beta == 0.0) {
+            for (j = 0; j < n; j++) {
+                c_i[j] = 0.0;
+            }
+        } else {
+            for (j = 0; j + 2 <= n; j += 2) {
+                vst1q_f64(c_i + j, vmulq_n_f64(vld1q_f64(c_i + j), beta));
+            }
+            for (; j < n; j++) {
+                c_i[j] *= beta;
+            }
+        }
+    }
+}
+
+// 把 nt 个线程排成 gm x gn 的网格（M 方向 gm 组、N 方向 gn 组），mb x nb 为一个 (M 块, N 块)。
+// 取每个线程最大子块面积最小的分解；相同时取 gm 大的：按 M 划分时每个线程的 A 行私有，
+// 只有 B 块共享，也不需要在打包 A 之后同步
+static void fast_grid(unsigned int nt, size_t mb, size_t nb, unsigned int *gm, unsigned int *gn) {
+    size_t um = mb / GEMM_UNROLL;
+    size_t un = (nb & 7) == 0 ? nb / 8 : nb / 4;
+    size_t best = (size_t)-1;
+    unsigned int i;
+
+    *gm = nt;
+    *gn = 1;
+    for (i = nt; i >= 1; i--) {
+        size_t work;
+
+        if (nt % i != 0) {
+            continue;
+        }
+        work = ((um + i - 1) / i) * ((un + nt / i - 1) / (nt / i));
+        if (work < best) {
+            best = work;
+            *gm = i;
+            *gn = nt / i;
+        }
+    }
+}
+
+// 并行区域实际启动的线程数 team 少于计划的 nt 时（OMP_DYNAMIC、OMP_THREAD_LIMIT、嵌套），
+// 按同样的方向重新划分：只按行或只按列的保持方向，网格按 fast_grid 重选
+static void team_grid(unsigned int nt, unsigned int team, size_t mb, size_t nb,
+                      unsigned int *gm, unsigned int *gn) {
+    if (team == nt) {
+        return;
+    }
+    if (*gn == 1) {
+        *gm = team;
+    } else if (*gm == 1) {
+        *gn = team;
+    } else {
+        fast_grid(team, mb, nb, gm, gn);
+    }
+}
+
+/**
+ * ============================================================================
+ * 按拓扑分配线程网格中的位置
+ * ============================================================================
+ *
+ * FT2000Q 每 2 个核共享一个 L2，rk3399 的 A53 只有 A72 一半左右的速度。
+ * dgemm_cpu_topology 不是均匀的时候，每个并行区域开始时各线程记下自己所在的 CPU，
+ * 同步一次，然后按 CPU 在拓扑中的顺序（大核在前、同一 L2 簇相邻）给线程排位：
+ *
+ * 1. 第 r 位负责第 r / gm 组列中的第 r % gm 组行：同一组列（读同一段打包好的 B）
+ *    的线程排位相邻，落在同一个 L2 簇中
+ * 2. 权重为 cpu_capacity：列按各组列的权重和分给各组，组内的行按各线程的权重分，
+ *    小核分到的行、列少，不会最后一个完成
+ *
+ * 均匀的机器上排位就是线程号，权重相同，和均分一样，也不多一次同步。
+ * 库不改变 OpenMP 线程的绑定（它们属于调用者）。只有 OMP_PROC_BIND / OMP_PLACES 绑定了线程时
+ * 才按拓扑排位：不绑定的线程随时可能被迁移，区域开始时记下的 CPU 只是一瞬间的快照，
+ * 按它加权可能让小核分到大核的份额，这时按均匀的机器处理。
+ * ============================================================================
+ */
+
+// units 个单位按权重 w[0, k) 依次分段，第 i 段的起点（i = k 时为 units）
+static size_t weighted_split(size_t units, const unsigned int *w, unsigned int k, unsigned int i) {
+    size_t before = 0, total = 0;
+    unsigned int j;
+
+    for (j = 0; j < k; j++) {
+        total += w[j];
+        before += j < i ? w[j] : 0;
+    }
+    return units * before / total;
+}
+
+// pos[t] 为第 t 个线程所在 CPU 的拓扑下标（-1 未知，排在最后）。返回线程 tid 的排位，
+// w[r] 为第 r 位线程的权重
+static unsigned int topo_role(const m_blas_topology *topo, const int *pos, unsigned int nt,
+                              unsigned int tid, unsigned int *w) {
+    unsigned int t, j, rank, role = tid;
+
+    for (t = 0; t < nt; t++) {
+        size_t key = pos[t] < 0 ? (size_t)-1 : (size_t)pos[t];
+
+        rank = 0;
+        for (j = 0; j < nt; j++) {
+            size_t other = pos[j] < 0 ? (size_t)-1 : (size_t)pos[j];
+
+            rank += other < key || (other == key && j < t);
+        }
+        w[rank] = pos[t] < 0 ? 1024 : topo->capacity[pos[t]];
+        if (t == tid) {
+            role = rank;
+        }
+    }
+    return role;
+}
+
+// 按 K 划分时每个线程至少分到的 k 数：部分和的归约（每个线程 m x n 次加法）相对可以忽略
+#ifndef SPLITK_MIN_P
+#define SPLITK_MIN_P (64)
+#endif
+
+// 按 M / N 划分时每个线程少于这么多个 4x8（或 4x4）子块就改为按 K 划分：
+// 子块太少时每个 k 块都要开一次并行区域、同步两次，内核也只跑几个微块
+#ifndef SPLITK_MN_TILES
+#define SPLITK_MN_TILES (4)
+#endif
+
+// 可复现模式下按 K 划分的段长（4 的倍数）。改变它会改变可复现模式的结果
+#ifndef SPLITK_REPRO_P
+#define SPLITK_REPRO_P (256)
+#endif
+
+/**
+ * ============================================================================
+ * 线程数与划分方向
+ * ============================================================================
+ *
+ * 线程数依次受以下限制：
+ * 1. 上限：thr->threads（显式指定时直接使用，不再按工作量缩减），
+ *    否则为 m_blas_config.threads（0 为 OpenMP 默认线程数）
+ * 2. 工作量：每个线程至少 thread_min_flops 次浮点运算（2*m*n*p 计），
+ *    OpenMP 区域的唤醒、同步开销才摊得开；24x24x24 只用一个线程，256x256x256 用满
+ * 3. 子块：每个线程至少一个 4 行 x 8（或 4）列的子块。按 M 划分时每个线程的
+ *    A 行在 sa 中的私有区间至少是一个 4 行微面板，按 N 划分时 B 块中至少一个列组，
+ *    线程数超过它们只会空转
+ *
+ * 划分方向默认按第一个 (M 块, N 块) 的形状选择（fast_grid），可用 thr->split 固定。
+ * C 只有一个 (M 块, N 块)、每个线程分不到 SPLITK_MN_TILES 个子块时（如 16x16x4096）
+ * 改为按 K 划分，每个线程至少 SPLITK_MIN_P 个 k，sa / sb 按线程数等分后也要放得下这么多 k。
+ * 可复现模式下是否按 K 划分只看形状（K 的段数 p / SPLITK_REPRO_P 的 SPLITK_MN_TILES 倍
+ * 多于子块数），不看线程数。
+ * 已经在并行区域或线程池的任务内调用时不再嵌套。
+ * ============================================================================
+ */
+
+// 规则 1、2 决定的线程数；max_threads 为配置未指定线程数（threads = 0）时的上限
+static size_t threads_want(const m_blas_config *cfg, size_t m, size_t n, size_t p,
+                           const m_blas_threading *thr, size_t max_threads) {
+    double min_flops = thr && thr->min_flops ? thr->min_flops : cfg->thread_min_flops;
+    double flops = 2.0 * m * n * p;
+    size_t nt;
+
+#ifdef _OPENMP
+    if (omp_in_parallel()) {
+        return 1;
+    }
+#endif
+    if (dgemm_pool_in_task()) {
+        return 1;
+    }
+    if (thr && thr->threads) {
+        return thr->threads;
+    }
+    nt = cfg->threads ? cfg->threads : max_threads;
+    if (min_flops > 0 && flops / min_flops < nt) {
+        nt = (size_t)(flops / min_flops);
+    }
+    return nt;
+}
+
+static void threads_plan(const m_blas_config *cfg,
+                         size_t m, size_t n, size_t p, const m_blas_threading *thr,
+                         unsigned int *threads, unsigned int *gm, unsigned int *gn, size_t *chunks) {
+    size_t mb = min(m, cfg->gemm_m), nb = min(n, cfg->gemm_n);
+    size_t um = mb / GEMM_UNROLL;
+    size_t un = (nb & 7) == 0 ? nb / 8 : nb / 4;
+    unsigned int split = thr ? thr->split : M_BLAS_SPLIT_AUTO;
+    int repro = cfg->reproducible || (thr && (thr->flags & M_BLAS_THREAD_REPRODUCIBLE));
+    size_t nt = 1, cap, k_cap, k_fit = 0;
+
+#ifdef _OPENMP
+    nt = threads_want(cfg, m, n, p, thr, (size_t)omp_get_max_threads());
+#endif
+
+    // 按 K 划分：部分和的个数（可复现模式下按固定长度切 K，只取决于 p），
+    // 以及 sa / sb 按线程数等分后每份还放得下 SPLITK_MIN_P 个 k 的线程数
+    k_cap = repro ? (p + SPLITK_REPRO_P - 1) / SPLITK_REPRO_P : p / SPLITK_MIN_P;
+    if (m > 0 && n > 0) {
+        k_fit = min(M_BLAS_PACK_SA_SIZE / (m * SPLITK_MIN_P), M_BLAS_PACK_SB_SIZE / (n * SPLITK_MIN_P));
+    }
+    cap = split == M_BLAS_SPLIT_M ? um : split == M_BLAS_SPLIT_N ? un : um * un;
+    if (split == M_BLAS_SPLIT_AUTO && m <= cfg->gemm_m && n <= cfg->gemm_n && k_fit > 0 &&
+        (repro ? k_cap > 1 && um * un < SPLITK_MN_TILES * (p / SPLITK_REPRO_P)
+               : nt > 1 && min(k_cap, k_fit) > 1 && um * un < nt * SPLITK_MN_TILES)) {
+        split = M_BLAS_SPLIT_K;
+    }
+    *chunks = 0;
+    if (split == M_BLAS_SPLIT_K) {
+        cap = min(k_cap, k_fit);
+        if (repro && k_fit > 0 && k_cap > 1) {
+            *chunks = k_cap;
+        }
+    }
+    if (nt > cap) {
+        nt = cap;
+    }
+    if (nt > M_BLAS_CONFIG_MAX_THREADS) {
+        nt = M_BLAS_CONFIG_MAX_THREADS;
+    }
+    *threads = nt ? (unsigned int)nt : 1;
+
+    if (split == M_BLAS_SPLIT_K) {
+        *gm = 1;
+        *gn = 1;
+        if (!repro && *threads > 1) {
+            *chunks = *threads;
+        }
+    } else if (split == M_BLAS_SPLIT_M) {
+        *gm = *threads;
+        *gn = 1;
+    } else if (split == M_BLAS_SPLIT_N) {
+        *gm = 1;
+        *gn = *threads;
+    } else {
+        fast_grid(*threads, mb, nb, gm, gn);
+    }
+}
+
+void dgemm_threads_plan(size_t m, size_t n, size_t p, const m_blas_threading *thr,
+                        unsigned int *threads, unsigned int *gm, unsigned int *gn) {
+    size_t chunks;
+
+    threads_plan(dgemm_config_get(), m, n, p, thr, threads, gm, gn, &chunks);
+}
+
+/**
+ * ============================================================================
+ * 按 K 划分（split-K）
+ * ============================================================================
+ *
+ * m、n 小而 p 大时（如 16x16x4096）C 只有几个子块，按 M / N 划分分不出线程。
+ * 这时把 K 切成 chunks 段，每段一个 m x n 的部分和（槽）：槽 0 就是 C，其余槽在私有
+ * 缓冲区中（第一个 k 块不读）。第 t 个线程计算第 [chunks * t / nt, chunks * (t + 1) / nt) 段
+ * （nt 为实际启动的线程数），sa / sb 按计划的线程数等分。然后用向量加法按二叉树把各槽归约到槽 0：
+ *
+ * 1. 默认每个线程一段（chunks = nt，按 4 的倍数均分 K）。先算完的线程取走另一个
+ *    已完成的部分和，相加后继续配对，没有可配对的就留下自己的结果退出；
+ *    不等待最慢的线程，但相加顺序随时序变化
+ * 2. M_BLAS_THREAD_DETERMINISTIC：第 s 轮把槽 t + s 加到槽 t（t 为 2s 的倍数），
+ *    每轮的行由所有线程分担，轮间同步；线程数相同时结果逐位一致
+ * 3. 可复现模式：每段固定 SPLITK_REPRO_P 个 k（段数只取决于 p），按 2 的方式归约。
+ *    段内各 k 块由内核从槽中读出继续累加，k 块怎么切不影响结果，
+ *    所以结果与线程数无关（单线程时依次计算各段）
+ *
+ * 部分和缓冲区每次调用分配（(chunks - 1) * m * n 个 double），分配失败时退回
+ * 单线程的按 M / N 分块（可复现模式下此时结果与分段归约不同）。
+ * ============================================================================
+ */
+
+// dst[0, n) += src[0, n)，n 为 4 的倍数
+static void splitk_add_row(double *dst, const double *src, size_t n) {
+    size_t j;
+
+    for (j = 0; j < n; j += 4) {
+        vst1q_f64(dst + j, vaddq_f64(vld1q_f64(dst + j), vld1q_f64(src + j)));
+        vst1q_f64(dst + j + 2, vaddq_f64(vld1q_f64(dst + j + 2), vld1q_f64(src + j + 2)));
+    }
+}
+
+// 槽 t 的部分和：槽 0 为 C，其余为 part 中连续的 m x n 块
+#define SPLITK_SLOT(t)    ((t) == 0 ? c : part + ((t) - 1) * m * n)
+#define SPLITK_LD(t)      ((t) == 0 ? ldc : n)
+
+// 成功返回 0；部分和缓冲区分配失败返回 -1（C 未改动）
+static int dgemm_splitk(const m_blas_config *cfg, int trans_a, int trans_b,
+                        size_t m, size_t n, size_t p,
+                        double *a, size_t lda,
+                        double *b, size_t ldb,
+                        double *c, size_t ldc,
+                        double *sa, double *sb,
+                        unsigned int nt, size_t chunks, unsigned int flags,
+                        unsigned long c_first, unsigned long c_pf) {
+    size_t kc = min(cfg->gemm_p, min(M_BLAS_PACK_SA_SIZE / (nt * m), M_BLAS_PACK_SB_SIZE / (nt * n)));
+    double *part = (double*)aligned_alloc(64, (chunks - 1) * m * n * sizeof(double));
+    int repro = (flags & M_BLAS_THREAD_REPRODUCIBLE) != 0;
+    int pending = -1;
+
+    if (!part) {
+        return -1;
+    }
+    kc &= ~(size_t)(GEMM_UNROLL - 1);
+
+#pragma omp parallel num_threads(nt) if (nt > 1)
+    {
+        size_t t, t0, t1, k0, k1, ks, kb, s, i;
+        unsigned int tid = 0, team = 1, mine, other;
+        unsigned long c_mode;
+        double *sa_t, *sb_t, *cp;
+        size_t ldcp;
+
+#ifdef _OPENMP
+        tid = (unsigned int)omp_get_thread_num();
+        team = (unsigned int)omp_get_num_threads();
+#endif
+        // 实际启动的线程可能少于 nt：段与归约按 team 划分；sa / sb 仍按 nt 等分（kc 按它算）
+        sa_t = sa + M_BLAS_PACK_SA_SIZE / nt * tid;
+        sb_t = sb + M_BLAS_PACK_SB_SIZE / nt * tid;
+        t0 = chunks * tid / team;
+        t1 = chunks * (tid + 1) / team;
+
+        // 本线程的各段：与单线程驱动相同的打包与内核，只是 C 换成该段的槽
+        for (t = t0; t < t1; t++) {
+            if (repro) {
+                k0 = t * SPLITK_REPRO_P;
+                k1 = min(p, k0 + SPLITK_REPRO_P);
+            } else {
+                k0 = p / GEMM_UNROLL * t / chunks * GEMM_UNROLL;
+                k1 = p / GEMM_UNROLL * (t + 1) / chunks * GEMM_UNROLL;
+            }
+            cp = SPLITK_SLOT(t);
+            ldcp = SPLITK_LD(t);
+
+            c_mode = t == 0 ? c_first : M_BLAS_C_ZERO;
+            if (k1 == k0 && (c_mode & M_BLAS_C_ZERO)) {
+                scale_c(m, n, 0.0, cp, ldcp);
+            }
+            for (ks = k0; ks < k1; ks += kb) {
+                kb = min(kc, k1 - ks);
+                if (trans_a) {
+                    packA_4_fast_trans(m, kb, a + ks * lda, lda, sa_t);
+                } else {
+                    packA_4_fast(m, kb, a + ks, lda, sa_t);
+                }
+                packB_part(trans_b, kb, n, trans_b ? b + ks : b + ks * ldb, ldb, sb_t, 0, 1);
+                if ((n & 7) == 0) {
+                    kernel_4x8_select(m, n, kb, sa_t, sb_t, cp, ldcp, c_mode);
+                } else {
+                    kernel_4x4_fast_mode(m, n, kb, sa_t, sb_t, cp, ldcp, c_mode);
+                }
+                c_mode = c_pf;
+            }
+        }
+
+        if (repro || (flags & M_BLAS_THREAD_DETERMINISTIC)) {
+            // 固定的树：第 s 轮槽 t += 槽 t + s，所有 (t, 行) 在线程间均分
+#pragma omp barrier
+            for (s = 1; s < chunks; s <<= 1) {
+                size_t items = (chunks - s + 2 * s - 1) / (2 * s) * m;
+
+                for (i = items * tid / team; i < items * (tid + 1) / team; i++) {
+                    t = i / m * 2 * s;
+                    splitk_add_row(SPLITK_SLOT(t) + i % m * SPLITK_LD(t),
+                                   SPLITK_SLOT(t + s) + i % m * SPLITK_LD(t + s), n);
+                }
+#pragma omp barrier
+            }
+        } else {
+            // 先把本线程的各段加到第一段的槽中（chunks = nt 不少于 team，每个线程至少一段），
+            // 再按完成顺序两两合并，结果留在下标小的槽中，最后剩下的一定是槽 0（C）
+            for (t = t0 + 1; t < t1; t++) {
+                for (i = 0; i < m; i++) {
+                    splitk_add_row(SPLITK_SLOT(t0) + i * SPLITK_LD(t0), SPLITK_SLOT(t) + i * SPLITK_LD(t), n);
+                }
+            }
+            mine = (unsigned int)t0;
+            for (;;) {
+#pragma omp critical(dgemm_splitk)
+                {
+                    other = pending < 0 ? mine : (unsigned int)pending;
+                    pending = pending < 0 ? (int)mine : -1;
+                }
+                if (other == mine) {
+                    break;
+                }
+                if (other < mine) {
+                    unsigned int tmp = other;
+
+                    other = mine;
+                    mine = tmp;
+                }
+                for (i = 0; i < m; i++) {
+                    splitk_add_row(SPLITK_SLOT(mine) + i * SPLITK_LD(mine),
+                                   SPLITK_SLOT(other) + i * SPLITK_LD(other), n);
+                }
+            }
+        }
+    }
+
+    free(part);
+    return 0;
+}
+
+#undef SPLITK_SLOT
+#undef SPLITK_LD
+
+static void dgemm_fast_driver(int trans_a, int trans_b,
+                              size_t m, size_t n, size_t p,
+                              double *a, size_t lda,
+                              double *b, size_t ldb,
+                              double beta,
+                              double *c, size_t ldc,
+                              double *sa, double *sb,
+                              const m_blas_threading *thr) {
+    
+    size_t ms, min_m;
+    unsigned int nt, gm, gn, flags;
+    size_t chunks;
+    unsigned long c_first, c_last, c_pf;
+    const m_blas_config *cfg = dgemm_config_get();
+    const m_blas_topology *topo = dgemm_cpu_topology();
+    int topo_aware, pipe, omp_team, cpu_pos[M_BLAS_CONFIG_MAX_THREADS];
+    size_t sb_half = (size_t)cfg->gemm_p * cfg->gemm_n;
+    
+    // beta 不是 0 / 1 时先缩放 C，之后照常累加
+    if (beta != 1.0 && (p == 0 || beta != 0.0)) {
+        scale_c(m, n, beta, c, ldc);
+        beta = 1.0;
+    }
+
+    // C 的写回方式：第一个 k 块是否读 C，最后一个 k 块是否绕过缓存
+    c_pf = cfg->prefetch_type != M_BLAS_PREFETCH_NONE ? M_BLAS_C_PREFETCH : 0;
+    c_first = beta == 0.0 ? M_BLAS_C_ZERO : 0;
+    c_last = c_pf;
+    if (cfg->stream_c_bytes && m * n * sizeof(double) > cfg->stream_c_bytes) {
+        c_last = M_BLAS_C_STREAM;
+    }
+
+    // 线程数与线程网格
+    threads_plan(cfg, m, n, p, thr, &nt, &gm, &gn, &chunks);
+
+    // OpenMP 线程运行期间，空闲的池线程不自旋（见 dgemm_pool.c）
+    omp_team = nt > 1;
+    if (omp_team) {
+        dgemm_pool_omp_begin();
+    }
+
+    // 按 K 划分；部分和缓冲区分配失败时单线程计算
+    if (chunks > 0) {
+        flags = (thr ? thr->flags : 0) | (cfg->reproducible ? M_BLAS_THREAD_REPRODUCIBLE : 0);
+        if (dgemm_splitk(cfg, trans_a, trans_b, m, n, p, a, lda, b, ldb, c, ldc, sa, sb,
+                         nt, chunks, flags, c_first, c_pf) == 0) {
+            if (omp_team) {
+                dgemm_pool_omp_end();
+            }
+            return;
+        }
+        nt = 1;
+    }
+    topo_aware = nt > 1 && !topo->uniform;
+#ifdef _OPENMP
+    topo_aware = topo_aware && omp_get_proc_bind() != omp_proc_bind_false;
+#endif
+    pipe = USE_PIPELINED_PACK_B && sb_half * 2 <= M_BLAS_PACK_SB_SIZE;
+
+    // M 维度分块
+    for (ms = 0; ms < m; ms += cfg->gemm_m) {
+        min_m = m - ms;
+        if (min_m > cfg->gemm_m) {
+            min_m = cfg->gemm_m;
+        }
+
+        // 多线程时排第 role 位的线程负责每个 N 块中第 role / gm 组列、M 块中该组列的
+        // 第 role % gm 组行，行、列都按 4（列为 8 / 4）的块按权重分；
+        // B 块由所有线程合作打包，打包完成后同步一次
+#pragma omp parallel num_threads(nt) if (nt > 1)
+        {
+            size_t ps, ns, next_ps, next_ns, mms, min_p, min_n, min_mm, r, rows, r0, r1, c0, c1, um, u;
+            unsigned long c_mode;
+            int l1stride, fuse_b, ready = 0, first = 1;
+            unsigned int tid = 0, team = 1, tgm = gm, tgn = gn, role, rg, cg, w[M_BLAS_CONFIG_MAX_THREADS];
+            double *sa_mm, *sb_cur = sb, *sb_next = sb + sb_half, *sb_tmp;
+            pack_job next;
+
+#ifdef _OPENMP
+            tid = (unsigned int)omp_get_thread_num();
+            team = (unsigned int)omp_get_num_threads();
+#endif
+            // 实际启动的线程可能少于 nt：行、列与排位都按实际的线程数 team 划分
+            // （各线程得到的 team 相同，不需要同步）
+            team_grid(nt, team, min_m, min(n, cfg->gemm_n), &tgm, &tgn);
+            if (topo_aware && team > 1) {
+                cpu_pos[tid] = dgemm_topology_current();
+#pragma omp barrier
+                role = topo_role(topo, cpu_pos, team, tid, w);
+            } else {
+                for (role = 0; role < team; role++) {
+                    w[role] = 1;
+                }
+                role = tid;
+            }
+            rg = role % tgm;
+            cg = role / tgm;
+            r0 = ms + weighted_split(min_m / GEMM_UNROLL, w + cg * tgm, tgm, rg) * GEMM_UNROLL;
+            r1 = ms + weighted_split(min_m / GEMM_UNROLL, w + cg * tgm, tgm, rg + 1) * GEMM_UNROLL;
+
+            // 只有一个 N 块时 A 微面板用完即弃
+            l1stride = n > cfg->gemm_n;
+
+            // P(K) 维度分块，其中再按 N 分块，每个 (ps, ns) 打包一个 B 块
+            for (ps = 0; ps < p; ps += min_p) {
+                min_p = fast_block(p - ps, cfg->gemm_p);
+                c_mode = (ps == 0 ? c_first : 0) | (ps + min_p >= p ? c_last : c_pf);
+
+                for (ns = 0; ns < n; ns += min_n) {
+                    min_n = fast_block(n - ns, cfg->gemm_n);
+
+                    // 智能选择打包方式：如果 n 是 8 的倍数，使用 4x8 打包
+                    // 单线程时 B 由第一个 4 行微面板的内核边算边打包；多线程时其他线程
+                    // 要等 B 打包完成，融合反而把打包串行化，改为所有线程各打包一段列
+                    fuse_b = USE_FUSED_PACK_B && team == 1 && !trans_b && (min_n & 7) == 0;
+                    if (!fuse_b && !ready) {
+                        // 没有在上一个块计算时打包好：所有线程用完上一个 B 块后再覆盖 sb
+                        if (!first) {
+#pragma omp barrier
+                        }
+                        packB_part(trans_b, min_p, min_n,
+                                   trans_b ? b + ns * ldb + ps : b + ps * ldb + ns, ldb, sb_cur,
+                                   tid, team);
+                    }
+
+                    // 下一个 B 块（本 K 块的下一个 N 块，或下一个 K 块的第一个 N 块）在本块计算的
+                    // 同时打包进 sb 的另一半；单线程融合打包的块不提前打包
+                    next.steps = 0;
+                    next_ns = ns + min_n < n ? ns + min_n : 0;
+                    next_ps = next_ns > 0 ? ps : ps + min_p;
+                    if (pipe && next_ps < p) {
+                        pack_job_init(&next, trans_b, fast_block(p - next_ps, cfg->gemm_p),
+                                      fast_block(n - next_ns, cfg->gemm_n),
+                                      trans_b ? b + next_ns * ldb + next_ps : b + next_ps * ldb + next_ns,
+                                      ldb, sb_next, tid, team);
+                        if (USE_FUSED_PACK_B && team == 1 && !trans_b && (next.n & 7) == 0) {
+                            next.steps = 0;
+                        }
+                    }
+
+                    if (ns == 0 && tgn > 1) {
+                        // 同一组行由 gn 个线程共用：所有线程合作把整个 A 块打包进 sa，
+                        // 与 B 一起同步，然后每个线程计算自己的 (行, 列) 子块
+                        um = min_m / GEMM_UNROLL;
+                        mms = ms + um * tid / team * GEMM_UNROLL;
+                        min_mm = ms + um * (tid + 1) / team * GEMM_UNROLL - mms;
+                        if (min_mm > 0 && trans_a) {
+                            packA_4_fast_trans(min_mm, min_p, a + ps * lda + mms, lda, sa + min_p * (mms - ms));
+                        } else if (min_mm > 0) {
+                            packA_4_fast(min_mm, min_p, a + mms * lda + ps, lda, sa + min_p * (mms - ms));
+                        }
+                    }
+                    if ((!fuse_b && !ready) || (ns == 0 && tgn > 1)) {
+#pragma omp barrier
+                    }
+
+                    if (ns == 0 && tgn == 1) {
+                        // 按 M 划分：每个线程只打包、使用自己的 A 行
+                        for (mms = r0; mms < r1; mms += min_mm) {
+                            min_mm = r1 - mms;
+                            if (min_mm >= 3 * GEMM_UNROLL) {
+                                min_mm = 3 * GEMM_UNROLL;
+                            } else if (min_mm >= 2 * GEMM_UNROLL) {
+                                min_mm = 2 * GEMM_UNROLL;
+                            } else if (min_mm > GEMM_UNROLL) {
+                                min_mm = GEMM_UNROLL;
+                            }
+
+                            // 只有一个 N 块时每个线程反复使用自己行范围起点处的同一块 sa（留在 L1 中）
+                            sa_mm = sa + min_p * (l1stride ? mms - ms : r0 - ms);
+
+                            // 使用优化的 packA
+                            if (trans_a) {
+                                packA_4_fast_trans(min_mm, min_p, a + ps * lda + mms, lda, sa_mm);
+                            } else {
+                                packA_4_fast(min_mm, min_p, a + mms * lda + ps, lda, sa_mm);
+                            }
+
+                            // 根据 n 维度智能选择计算内核
+                            if (fuse_b) {
+                                // 前 4 行读原始 B 并写出打包的 B，其余行使用打包好的 B
+                                kernel_4x8_packB(min_p, min_n, sa_mm,
+                                                 b + ps * ldb, ldb, sb_cur, c + mms * ldc, ldc, c_mode);
+                                if (min_mm > GEMM_UNROLL) {
+                                    kernel_4x8_select(min_mm - GEMM_UNROLL, min_n, min_p,
+                                                      sa_mm + GEMM_UNROLL * min_p, sb_cur,
+                                                      c + (mms + GEMM_UNROLL) * ldc, ldc, c_mode);
+                                }
+                                fuse_b = 0;
+                            } else if ((min_n & 7) == 0) {
+                                // n 是 8 的倍数，使用更快的 4x8 内核
+                                kernel_4x8_select(min_mm, min_n, min_p, sa_mm, sb_cur,
+                                                  c + mms * ldc, ldc, c_mode);
+                            } else {
+                                // 使用通用 4x4 内核
+                                kernel_4x4_fast_mode(min_mm, min_n, min_p, sa_mm, sb_cur,
+                                                     c + mms * ldc, ldc, c_mode);
+                            }
+                            pack_job_run(&next, mms + min_mm - r0, r1 - r0);
+                        }
+                    } else if (fuse_b) {
+                        // 其余的 B 块：打包好的 A 在 sa 中
+                        kernel_4x8_packB(min_p, min_n, sa, b + ns + ldb * ps, ldb, sb_cur,
+                                         c + ms * ldc + ns, ldc, c_mode);
+                        if (min_m > GEMM_UNROLL) {
+                            kernel_4x8_select(min_m - GEMM_UNROLL, min_n, min_p, sa + GEMM_UNROLL * min_p, sb_cur,
+                                              c + (ms + GEMM_UNROLL) * ldc + ns, ldc, c_mode);
+                        }
+                    } else {
+                        // 每个线程计算自己的行与本块中自己的列；要打包下一个 B 块时
+                        // 按 PIPE_ROWS 行一段计算，每段之后打包一部分
+                        u = (min_n & 7) == 0 ? 8 : 4;
+                        c0 = weighted_split(min_n / u, w, team, cg * tgm) * u;
+                        c1 = weighted_split(min_n / u, w, team, (cg + 1) * tgm) * u;
+                        for (r = r0; r < r1 && c1 > c0; r += rows) {
+                            rows = next.steps && r1 - r > PIPE_ROWS ? PIPE_ROWS : r1 - r;
+                            sa_mm = sa + min_p * (r - ms);
+                            if (u == 8) {
+                                kernel_4x8_select(rows, c1 - c0, min_p, sa_mm, sb_cur + c0 * min_p,
+                                                  c + r * ldc + ns + c0, ldc, c_mode);
+                            } else {
+                                kernel_4x4_fast_mode(rows, c1 - c0, min_p, sa_mm, sb_cur + c0 * min_p,
+                                                     c + r * ldc + ns + c0, ldc, c_mode);
+                            }
+                            pack_job_run(&next, r + rows - r0, r1 - r0);
+                        }
+                    }
+
+                    // 没有分到行的线程也打包完自己那段，同步后下一个块直接使用
+                    pack_job_run(&next, 1, 1);
+                    ready = next.steps > 0;
+                    if (ready) {
+#pragma omp barrier
+                        sb_tmp = sb_cur;
+                        sb_cur = sb_next;
+                        sb_next = sb_tmp;
+                    }
+                    first = 0;
+                }
+            }
+        }
+    }
+
+    if (omp_team) {
+        dgemm_pool_omp_end();
+    }
+}
+
+//C(mxn) = A(mxp)*B(pxn)
+void dgemm_neon_fast_64(size_t m, size_t n, size_t p,
+                        double *a, size_t lda,
+                        double *b, size_t ldb,
+                        double *c, size_t ldc,
+                        double *sa, double *sb) {
+    dgemm_fast_driver(0, 0, m, n, p, a, lda, b, ldb, 1.0, c, ldc, sa, sb, NULL);
+}
+
+//C(mxn) = A(mxp)*B(pxn) + beta*C，beta = 0 时不读 C
+void dgemm_neon_fast_beta_64(size_t m, size_t n, size_t p,
+                             double *a, size_t lda,
+                             double *b, size_t ldb,
+                             double beta,
+                             double *c, size_t ldc,
+                             double *sa, double *sb) {
+    dgemm_fast_driver(0, 0, m, n, p, a, lda, b, ldb, beta, c, ldc, sa, sb, NULL);
+}
+
+//C(mxn) = A(mxp)*BT(pxn)，b 为 n x p 存储
+void dgemm_neon_fast_abt_64(size_t m, size_t n, size_t p,
+                            double *a, size_t lda,
+                            double *b, size_t ldb,
+                            double *c, size_t ldc,
+                            double *sa, double *sb) {
+    dgemm_fast_driver(0, 1, m, n, p, a, lda, b, ldb, 1.0, c, ldc, sa, sb, NULL);
+}
+
+//C(mxn) = AT(mxp)*B(pxn)，a 为 p x m 存储
+void dgemm_neon_fast_atb_64(size_t m, size_t n, size_t p,
+                            double *a, size_t lda,
+                            double *b, size_t ldb,
+                            double *c, size_t ldc,
+                            double *sa, double *sb) {
+    dgemm_fast_driver(1, 0, m, n, p, a, lda, b, ldb, 1.0, c, ldc, sa, sb, NULL);
+}
+
+//C(mxn) = A(mxp)*B(pxn)，thr 覆盖本次调用的线程数 / 划分方向 / 工作量阈值（NULL 同 dgemm_neon_fast）
+void dgemm_neon_fast_threads_64(size_t m, size_t n, size_t p,
+                                double *a, size_t lda,
+                                double *b, size_t ldb,
+                                double *c, size_t ldc,
+                                double *sa, double *sb,
+                                const m_blas_threading *thr) {
+    dgemm_fast_driver(0, 0, m, n, p, a, lda, b, ldb, 1.0, c, ldc, sa, sb, thr);
+}
+
+//C(mxn) = A(mxp)*B(pxn)，不打包；sa/sb 不使用，保留是为了与其它实现接口一致。
+// 线程数与 dgemm_neon_fast 相同地由 thr / 配置 / thread_min_flops 决定（只取 M / N 划分无关的
+// 规则 1、2），再以 C 块数与默认线程池的大小为上限，每个线程一段连续的 C 块
+void dgemm_neon_direct_threads_64(size_t m, size_t n, size_t p,
+                                  double *a, size_t lda,
+                                  double *b, size_t ldb,
+                                  double *c, size_t ldc,
+                                  double *sa, double *sb,
+                                  const m_blas_threading *thr) {
+    direct_args d = { m, n, p, a, b, c, lda, ldb, ldc, 0, 0, 1 };
+    m_blas_pool *pool;
+    size_t j;
+
+    (void)sa;
+    (void)sb;
+
+    d.row_tasks = (m + DIRECT_TASK_ROWS - 1) / DIRECT_TASK_ROWS;
+    d.blocks = (n + 7) / 8 * d.row_tasks;
+    d.parts = threads_want(dgemm_config_get(), m, n, p, thr, d.blocks);
+    if (d.parts > d.blocks) {
+        d.parts = d.blocks;
+    }
+    if (d.parts > 1 && (pool = dgemm_pool_default()) != NULL && dgemm_pool_size(pool) > 1) {
+        if (d.parts > dgemm_pool_size(pool)) {
+            d.parts = dgemm_pool_size(pool);
+        }
+        dgemm_pool_run(pool, d.parts, direct_task, &d);
+        return;
+    }
+
+    // 按 B 的 8 列条带循环，条带在 L1 中被所有行块复用
+    for (j = 0; j < n; j += 8) {
+        direct_block(&d, 0, m, j);
+    }
+}
+
+void dgemm_neon_direct_64(size_t m, size_t n, size_t p,
+                          double *a, size_t lda,
+                          double *b, size_t ldb,
+                          double *c, size_t ldc,
+                          double *sa, double *sb) {
+    dgemm_neon_direct_threads_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb, NULL);
+}
+
+// 32 位接口，转发到上面的 64 位版本
+void dgemm_neon_fast(unsigned int m, unsigned int n, unsigned int p, 
+                     double *a, unsigned int lda, 
+                     double *b, unsigned int ldb,
+                     double *c, unsigned int ldc, 
+                     double *sa, double *sb) {
+    dgemm_neon_fast_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+}
+
+void dgemm_neon_fast_beta(unsigned int m, unsigned int n, unsigned int p,
+                          double *a, unsigned int lda,
+                          double *b, unsigned int ldb,
+                          double beta,
+                          double *c, unsigned int ldc,
+                          double *sa, double *sb) {
+    dgemm_neon_fast_beta_64(m, n, p, a, lda, b, ldb, beta, c, ldc, sa, sb);
+}
+
+void dgemm_neon_fast_abt(unsigned int m, unsigned int n, unsigned int p,
+                         double *a, unsigned int lda,
+                         double *b, unsigned int ldb,
+                         double *c, unsigned int ldc,
+                         double *sa, double *sb) {
+    dgemm_neon_fast_abt_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+}
+
+void dgemm_neon_fast_atb(unsigned int m, unsigned int n, unsigned int p,
+                         double *a, unsigned int lda,
+                         double *b, unsigned int ldb,
+                         double *c, unsigned int ldc,
+                         double *sa, double *sb) {
+    dgemm_neon_fast_atb_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+}
+
+void dgemm_neon_fast_threads(unsigned int m, unsigned int n, unsigned int p,
+                             double *a, unsigned int lda,
+                             double *b, unsigned int ldb,
+                             double *c, unsigned int ldc,
+                             double *sa, double *sb,
+                             const m_blas_threading *thr) {
+    dgemm_neon_fast_threads_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb, thr);
+}
+
+void dgemm_neon_direct(unsigned int m, unsigned int n, unsigned int p,
+                       double *a, unsigned int lda,
+                       double *b, unsigned int ldb,
+                       double *c, unsigned int ldc,
+                       double *sa, double *sb) {
+    dgemm_neon_direct_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+}
+
+void dgemm_neon_direct_threads(unsigned int m, unsigned int n, unsigned int p,
+                               double *a, unsigned int lda,
+                               double *b, unsigned int ldb,
+                               double *c, unsigned int ldc,
+                               double *sa, double *sb,
+                               const m_blas_threading *thr) {
+    dgemm_neon_direct_threads_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb, thr);
+}
+
+#endif
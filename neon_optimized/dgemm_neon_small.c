@@ -1,8 +1,11 @@
 #ifdef __ARM_NEON
 #include <arm_neon.h>
 
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include "blas_dgemm.h"
+#include "dgemm_jit.h"
 
 /* 矩阵按行优先顺序存储的宏定义 */
 #define A(i, j) a[(i) * lda + (j)]
@@ -11,6 +14,9 @@
 
 #define min(i, j) ((i) < (j) ? (i) : (j))
 
+// 小形状优先使用运行时 JIT 生成的内核（dgemm_jit.c），置 0 关闭
+#define USE_JIT_SMALL (1)
+
 /**
  * ============================================================================
  * 针对小矩阵（24×24×24 及以下）的高度优化 DGEMM
@@ -41,15 +47,15 @@
  * - 在 O0 下也能保持高效
  * ============================================================================
  */
-static inline void kernel_2x2_tiny(unsigned int p, 
+static inline void kernel_2x2_tiny(size_t p, 
                                    const double *a, const double *b, 
-                                   double *c, unsigned int ldc) {
+                                   double *c, size_t ldc) {
     // 加载 C (2×2)
     float64x2_t c00 = vld1q_f64(&c[0]);        // C[0][0:1]
     float64x2_t c10 = vld1q_f64(&c[ldc]);      // C[1][0:1]
     
     // 主循环：遍历 K 维度
-    for (unsigned int k = 0; k < p; k++) {
+    for (size_t k = 0; k < p; k++) {
         // 加载 A (2×1)
         float64x2_t a_vec = vld1q_f64(&a[k * 2]);  // A[0:1][k]
         
@@ -75,16 +81,16 @@ static inline void kernel_2x2_tiny(unsigned int p,
  * 在小矩阵中 2×4 比 4×4 更高效（O0级别下）
  * ============================================================================
  */
-static inline void kernel_2x4_tiny(unsigned int p,
+static inline void kernel_2x4_tiny(size_t p,
                                    const double *a, const double *b,
-                                   double *c, unsigned int ldc) {
+                                   double *c, size_t ldc) {
     // 加载 C (2×4)
     float64x2_t c00 = vld1q_f64(&c[0]);
     float64x2_t c01 = vld1q_f64(&c[2]);
     float64x2_t c10 = vld1q_f64(&c[ldc]);
     float64x2_t c11 = vld1q_f64(&c[ldc + 2]);
     
-    for (unsigned int k = 0; k < p; k++) {
+    for (size_t k = 0; k < p; k++) {
         // 加载 A (2×1)
         float64x2_t a_vec = vld1q_f64(&a[k * 2]);
         
@@ -106,6 +112,59 @@ static inline void kernel_2x4_tiny(unsigned int p,
     vst1q_f64(&c[ldc + 2], c11);
 }
 
+/**
+ * ============================================================================
+ * 不打包的 2×4 / 2×2 微内核
+ * ============================================================================
+ * 
+ * 与上面的内核相同，但直接读取行优先的 A（行距 lda）和 B（行距 ldb），
+ * 供不打包的极小矩阵和分块路径使用
+ * ============================================================================
+ */
+static inline void kernel_2x4_direct(size_t p,
+                                     const double *a, size_t lda,
+                                     const double *b, size_t ldb,
+                                     double *c, size_t ldc) {
+    float64x2_t c00 = vld1q_f64(&c[0]);
+    float64x2_t c01 = vld1q_f64(&c[2]);
+    float64x2_t c10 = vld1q_f64(&c[ldc]);
+    float64x2_t c11 = vld1q_f64(&c[ldc + 2]);
+    
+    for (size_t k = 0; k < p; k++) {
+        // B[k][0:3]，A[0][k] 与 A[1][k] 按标量广播
+        float64x2_t b0 = vld1q_f64(&b[k * ldb]);
+        float64x2_t b1 = vld1q_f64(&b[k * ldb + 2]);
+        
+        c00 = vfmaq_n_f64(c00, b0, a[k]);
+        c01 = vfmaq_n_f64(c01, b1, a[k]);
+        c10 = vfmaq_n_f64(c10, b0, a[lda + k]);
+        c11 = vfmaq_n_f64(c11, b1, a[lda + k]);
+    }
+    
+    vst1q_f64(&c[0], c00);
+    vst1q_f64(&c[2], c01);
+    vst1q_f64(&c[ldc], c10);
+    vst1q_f64(&c[ldc + 2], c11);
+}
+
+static inline void kernel_2x2_direct(size_t p,
+                                     const double *a, size_t lda,
+                                     const double *b, size_t ldb,
+                                     double *c, size_t ldc) {
+    float64x2_t c00 = vld1q_f64(&c[0]);
+    float64x2_t c10 = vld1q_f64(&c[ldc]);
+    
+    for (size_t k = 0; k < p; k++) {
+        float64x2_t b_vec = vld1q_f64(&b[k * ldb]);
+        
+        c00 = vfmaq_n_f64(c00, b_vec, a[k]);
+        c10 = vfmaq_n_f64(c10, b_vec, a[lda + k]);
+    }
+    
+    vst1q_f64(&c[0], c00);
+    vst1q_f64(&c[ldc], c10);
+}
+
 /**
  * ============================================================================
  * 简化的转置打包 - 仅用于提高数据局部性
@@ -115,11 +174,13 @@ static inline void kernel_2x4_tiny(unsigned int p,
  * 使用 intrinsics 而不是汇编，在 O0 下更可靠
  * ============================================================================
  */
-static inline void pack_a_2x2(unsigned int m, unsigned int p,
-                              const double *from, unsigned int lda,
+// A 的成对行：第 i、i+1 行交错存放在 to + i*p（kernel_*_tiny 读 a[k*2 + r]）；
+// m 为奇数时最后一行不打包，由调用方按标量处理
+static inline void pack_a_2x2(size_t m, size_t p,
+                              const double *from, size_t lda,
                               double *to) {
-    for (unsigned int i = 0; i < m; i += 2) {
-        for (unsigned int j = 0; j < p; j++) {
+    for (size_t i = 0; i + 1 < m; i += 2) {
+        for (size_t j = 0; j < p; j++) {
             to[j * 2 + 0] = from[i * lda + j];
             to[j * 2 + 1] = from[(i + 1) * lda + j];
         }
@@ -127,15 +188,29 @@ static inline void pack_a_2x2(unsigned int m, unsigned int p,
     }
 }
 
-static inline void pack_b_2x2(unsigned int p, unsigned int n,
-                              const double *from, unsigned int ldb,
+// B 的列面板，与主函数中的列划分一致：先是 4 列一组（kernel_2x4_tiny 读 b[k*4 + c]），
+// 剩下的 2 列一组（kernel_2x2_tiny 读 b[k*2 + c]），起始列为 j 的面板放在 to + j*p；
+// n 为奇数时最后一列不打包，由调用方按标量处理
+static inline void pack_b_2x2(size_t p, size_t n,
+                              const double *from, size_t ldb,
                               double *to) {
-    for (unsigned int i = 0; i < p; i++) {
-        for (unsigned int j = 0; j < n; j += 2) {
-            to[i * 2 + 0] = from[i * ldb + j];
-            to[i * 2 + 1] = from[i * ldb + j + 1];
+    size_t j = 0;
+
+    for (; j + 3 < n; j += 4) {
+        double *panel = to + j * p;
+        for (size_t k = 0; k < p; k++) {
+            panel[k * 4 + 0] = from[k * ldb + j];
+            panel[k * 4 + 1] = from[k * ldb + j + 1];
+            panel[k * 4 + 2] = from[k * ldb + j + 2];
+            panel[k * 4 + 3] = from[k * ldb + j + 3];
+        }
+    }
+    for (; j + 1 < n; j += 2) {
+        double *panel = to + j * p;
+        for (size_t k = 0; k < p; k++) {
+            panel[k * 2 + 0] = from[k * ldb + j];
+            panel[k * 2 + 1] = from[k * ldb + j + 1];
         }
-        to += 2;
     }
 }
 
@@ -156,31 +231,41 @@ static inline void pack_b_2x2(unsigned int p, unsigned int n,
  * - 尽量用 inline 函数而不是宏
  * ============================================================================
  */
-void dgemm_neon_small(unsigned int m, unsigned int n, unsigned int p,
-                      double *a, unsigned int lda,
-                      double *b, unsigned int ldb,
-                      double *c, unsigned int ldc,
-                      double *sa, double *sb) {
+void dgemm_neon_small_64(size_t m, size_t n, size_t p,
+                         double *a, size_t lda,
+                         double *b, size_t ldb,
+                         double *c, size_t ldc,
+                         double *sa, double *sb) {
     
+#if USE_JIT_SMALL
+    // 形状和步长固化的 JIT 内核；不支持时返回 -1，继续走下面的通用路径。
+    // JIT 缓存以 32 位记录形状，超出范围的直接走通用路径
+    if ((m | n | p | lda | ldb | ldc) <= UINT_MAX &&
+        dgemm_jit_run((unsigned int)m, (unsigned int)n, (unsigned int)p,
+                      (unsigned int)lda, (unsigned int)ldb, (unsigned int)ldc, a, b, c) == 0) {
+        return;
+    }
+#endif
+
     // 对于极小矩阵（≤ 16），直接计算不打包
     if (m <= 16 && n <= 16 && p <= 16) {
         // 直接在原始数据上计算
-        unsigned int i, j;
+        size_t i, j;
         
         // 按 2×4 块处理
         for (i = 0; i + 1 < m; i += 2) {
             for (j = 0; j + 3 < n; j += 4) {
-                kernel_2x4_tiny(p, a + i * lda, b + j, c + i * ldc + j, ldc);
+                kernel_2x4_direct(p, a + i * lda, lda, b + j, ldb, c + i * ldc + j, ldc);
             }
             
             // 处理 j 维度的余数（2×2 块）
             for (; j + 1 < n; j += 2) {
-                kernel_2x2_tiny(p, a + i * lda, b + j, c + i * ldc + j, ldc);
+                kernel_2x2_direct(p, a + i * lda, lda, b + j, ldb, c + i * ldc + j, ldc);
             }
             
             // 处理单列余数
             if (j < n) {
-                for (unsigned int k = 0; k < p; k++) {
+                for (size_t k = 0; k < p; k++) {
                     c[i * ldc + j] += a[i * lda + k] * b[k * ldb + j];
                     c[(i + 1) * ldc + j] += a[(i + 1) * lda + k] * b[k * ldb + j];
                 }
@@ -190,7 +275,7 @@ void dgemm_neon_small(unsigned int m, unsigned int n, unsigned int p,
         // 处理 i 维度的余数（单行）
         if (i < m) {
             for (j = 0; j < n; j++) {
-                for (unsigned int k = 0; k < p; k++) {
+                for (size_t k = 0; k < p; k++) {
                     c[i * ldc + j] += a[i * lda + k] * b[k * ldb + j];
                 }
             }
@@ -199,18 +284,17 @@ void dgemm_neon_small(unsigned int m, unsigned int n, unsigned int p,
         return;
     }
     
-    // 对于稍大的小矩阵（16 < size ≤ 32），使用简单打包
-    if (m <= 32 && n <= 32 && p <= 32) {
+    // 对于稍大的小矩阵（16 < size ≤ 32），使用简单打包；
+    // 没有打包缓冲区（sa/sb 为 NULL）时走下面不打包的分块路径，逐元素的 FMA 顺序相同
+    if (m <= 32 && n <= 32 && p <= 32 && sa && sb) {
         // 打包 A：按行打包成 2 行一组
-        unsigned int packed_m = (m + 1) & ~1;  // 向上取偶数
         pack_a_2x2(m, p, a, lda, sa);
         
-        // 打包 B：按列打包成 2 列一组  
-        unsigned int packed_n = (n + 1) & ~1;
+        // 打包 B：按列打包成 4 列一组，余下 2 列一组
         pack_b_2x2(p, n, b, ldb, sb);
         
         // 使用打包后的数据计算
-        unsigned int i, j;
+        size_t i, j;
         for (i = 0; i + 1 < m; i += 2) {
             for (j = 0; j + 3 < n; j += 4) {
                 kernel_2x4_tiny(p, sa + i * p, sb + j * p, c + i * ldc + j, ldc);
@@ -221,7 +305,7 @@ void dgemm_neon_small(unsigned int m, unsigned int n, unsigned int p,
             }
             
             if (j < n) {
-                for (unsigned int k = 0; k < p; k++) {
+                for (size_t k = 0; k < p; k++) {
                     c[i * ldc + j] += a[i * lda + k] * b[k * ldb + j];
                     c[(i + 1) * ldc + j] += a[(i + 1) * lda + k] * b[k * ldb + j];
                 }
@@ -230,7 +314,7 @@ void dgemm_neon_small(unsigned int m, unsigned int n, unsigned int p,
         
         if (i < m) {
             for (j = 0; j < n; j++) {
-                for (unsigned int k = 0; k < p; k++) {
+                for (size_t k = 0; k < p; k++) {
                     c[i * ldc + j] += a[i * lda + k] * b[k * ldb + j];
                 }
             }
@@ -241,47 +325,47 @@ void dgemm_neon_small(unsigned int m, unsigned int n, unsigned int p,
     
     // 对于更大的矩阵（但仍然算"小"，如 64×64），使用改进的分块
     // 但保持分块逻辑简单
-    const unsigned int BLOCK_M = 16;
-    const unsigned int BLOCK_N = 16;
-    const unsigned int BLOCK_K = 16;
+    const size_t BLOCK_M = 16;
+    const size_t BLOCK_N = 16;
+    const size_t BLOCK_K = 16;
     
-    for (unsigned int ii = 0; ii < m; ii += BLOCK_M) {
-        unsigned int im = min(BLOCK_M, m - ii);
+    for (size_t ii = 0; ii < m; ii += BLOCK_M) {
+        size_t im = min(BLOCK_M, m - ii);
         
-        for (unsigned int jj = 0; jj < n; jj += BLOCK_N) {
-            unsigned int jn = min(BLOCK_N, n - jj);
+        for (size_t jj = 0; jj < n; jj += BLOCK_N) {
+            size_t jn = min(BLOCK_N, n - jj);
             
-            for (unsigned int kk = 0; kk < p; kk += BLOCK_K) {
-                unsigned int kp = min(BLOCK_K, p - kk);
+            for (size_t kk = 0; kk < p; kk += BLOCK_K) {
+                size_t kp = min(BLOCK_K, p - kk);
                 
                 // 在小块上使用 2×2 或 2×4 内核
-                unsigned int i, j;
+                size_t i, j;
                 for (i = 0; i + 1 < im; i += 2) {
                     for (j = 0; j + 3 < jn; j += 4) {
-                        unsigned int abs_i = ii + i;
-                        unsigned int abs_j = jj + j;
-                        kernel_2x4_tiny(kp,
-                                       a + abs_i * lda + kk,
-                                       b + kk * ldb + abs_j,
-                                       c + abs_i * ldc + abs_j,
-                                       ldc);
+                        size_t abs_i = ii + i;
+                        size_t abs_j = jj + j;
+                        kernel_2x4_direct(kp,
+                                          a + abs_i * lda + kk, lda,
+                                          b + kk * ldb + abs_j, ldb,
+                                          c + abs_i * ldc + abs_j,
+                                          ldc);
                     }
                     
                     for (; j + 1 < jn; j += 2) {
-                        unsigned int abs_i = ii + i;
-                        unsigned int abs_j = jj + j;
-                        kernel_2x2_tiny(kp,
-                                       a + abs_i * lda + kk,
-                                       b + kk * ldb + abs_j,
-                                       c + abs_i * ldc + abs_j,
-                                       ldc);
+                        size_t abs_i = ii + i;
+                        size_t abs_j = jj + j;
+                        kernel_2x2_direct(kp,
+                                          a + abs_i * lda + kk, lda,
+                                          b + kk * ldb + abs_j, ldb,
+                                          c + abs_i * ldc + abs_j,
+                                          ldc);
                     }
                     
                     // 余数
                     for (; j < jn; j++) {
-                        unsigned int abs_i = ii + i;
-                        unsigned int abs_j = jj + j;
-                        for (unsigned int k = 0; k < kp; k++) {
+                        size_t abs_i = ii + i;
+                        size_t abs_j = jj + j;
+                        for (size_t k = 0; k < kp; k++) {
                             c[abs_i * ldc + abs_j] += 
                                 a[abs_i * lda + kk + k] * b[(kk + k) * ldb + abs_j];
                             c[(abs_i + 1) * ldc + abs_j] += 
@@ -292,10 +376,10 @@ void dgemm_neon_small(unsigned int m, unsigned int n, unsigned int p,
                 
                 // i 维度余数
                 for (; i < im; i++) {
-                    unsigned int abs_i = ii + i;
+                    size_t abs_i = ii + i;
                     for (j = 0; j < jn; j++) {
-                        unsigned int abs_j = jj + j;
-                        for (unsigned int k = 0; k < kp; k++) {
+                        size_t abs_j = jj + j;
+                        for (size_t k = 0; k < kp; k++) {
                             c[abs_i * ldc + abs_j] += 
                                 a[abs_i * lda + kk + k] * b[(kk + k) * ldb + abs_j];
                         }
@@ -306,5 +390,14 @@ void dgemm_neon_small(unsigned int m, unsigned int n, unsigned int p,
     }
 }
 
+// 32 位接口，转发到上面的 64 位版本
+void dgemm_neon_small(unsigned int m, unsigned int n, unsigned int p,
+                      double *a, unsigned int lda,
+                      double *b, unsigned int ldb,
+                      double *c, unsigned int ldc,
+                      double *sa, double *sb) {
+    dgemm_neon_small_64(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+}
+
 #endif
 
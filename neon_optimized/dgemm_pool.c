@@ -0,0 +1,536 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "blas_dgemm.h"
+
+/**
+ * ============================================================================
+ * 常驻的工作窃取线程池
+ * ============================================================================
+ *
+ * OpenMP 每个并行区域要唤醒、同步一遍线程，开销是几微秒，比整个 48x48 的乘法还长。
+ * 这里的线程创建一次后常驻：
+ *
+ * 1. 每个工作线程一个双端队列，存放任务下标区间 [begin, end)；
+ *    所有者从底部取，其他线程从顶部窃取
+ * 2. 执行前把区间对半拆分，上半段放回队列供空闲线程窃取，直到只剩一个下标
+ * 3. dgemm_pool_run 把任务切成参与线程数段轮流放入各队列，调用者自己也通过
+ *    窃取参与计算，直到本次提交的任务全部完成
+ * 4. 空闲的工作线程先自旋 DGEMM_POOL_SPIN 次（连续调用之间不必睡眠、唤醒），
+ *    之后在条件变量上睡眠，有新任务时被唤醒。dgemm_neon_fast 的 OpenMP 线程与池线程
+ *    是两组线程、绑定在同样的 CPU 上：OpenMP 区域运行期间（dgemm_pool_omp_begin / end）
+ *    空闲的池线程不自旋，直接睡眠，不与 OpenMP 线程争抢 CPU；
+ *    此时提交给池的任务照常由被唤醒的工作线程执行
+ * 5. M_BLAS_POOL_PIN 时工作线程按 dgemm_cpu_topology 的顺序绑定到进程允许的 CPU 上：
+ *    大核在前，同一 L2 簇的 CPU 相邻；窃取时先找同一簇的线程（共享的数据还在 L2 中）
+ * 6. 区间对半拆分、空闲即窃取本身就是动态分块：big.LITTLE 上小核执行的任务少，
+ *    不会在每次提交的末尾拖后腿
+ * 7. dgemm_pool_submit 的任务放入队列后立即返回，调用者不参与计算；
+ *    执行完最后一个下标的线程调用完成回调并释放这次提交。所有队列都满时
+ *    放入溢出链表（节点随提交一起分配），由空闲的工作线程取走，从不在提交者中执行
+ *
+ * 任务是粗粒度的（一个 C 块、一个 GEMM），队列用互斥锁保护即可。
+ * ============================================================================
+ */
+
+// 每个队列的容量（区间个数），2 的幂；满时换下一个队列，都满时见 pool_enqueue
+#define POOL_DEQUE_SIZE (256)
+
+// 空闲工作线程睡眠前的自旋次数
+#ifndef DGEMM_POOL_SPIN
+#define DGEMM_POOL_SPIN (1 << 14)
+#endif
+
+#if defined(__aarch64__)
+#define cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#elif defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __asm__ __volatile__("pause" ::: "memory")
+#else
+#define cpu_relax() do { } while (0)
+#endif
+
+typedef struct pool_job pool_job;
+
+typedef struct {
+    pool_job *job;
+    size_t begin, end;
+} pool_range;
+
+// 溢出链表的节点
+typedef struct pool_overflow {
+    struct pool_overflow *next;
+    pool_range r;
+} pool_overflow;
+
+// 一次 dgemm_pool_run / dgemm_pool_submit 提交的任务
+struct pool_job {
+    m_blas_task_fn fn;
+    void *arg;
+    atomic_size_t remaining;    // 尚未执行完的下标数
+    m_blas_done_fn done;        // dgemm_pool_submit 的完成回调（pool_job 在堆上），dgemm_pool_run 为 NULL
+    void *done_arg;
+    pool_overflow spill[];      // dgemm_pool_submit：每段一个，所有队列都满时用于溢出链表
+};
+
+typedef struct {
+    pthread_mutex_t lock;
+    size_t top, bottom;         // [top, bottom) 中有区间
+    pool_range ranges[POOL_DEQUE_SIZE];
+} pool_deque;
+
+typedef struct {
+    m_blas_pool *pool;
+    pthread_t thread;
+    unsigned int id;
+    int cpu;                    // 绑定的 CPU，-1 不绑定
+    int cluster;                // 所在 L2 簇（dgemm_cpu_topology），-1 未知
+} pool_worker;
+
+struct m_blas_pool {
+    unsigned int size;          // 参与计算的线程数（工作线程 + 调用者）
+    unsigned int workers;       // 工作线程数
+    pool_deque *deques;         // 每个工作线程一个
+    pool_worker *threads;
+    atomic_size_t queued;       // 所有队列中的区间数
+    atomic_uint next;           // 下一次提交从哪个队列开始放
+    atomic_uint sleepers;       // 正在（或即将）睡眠的工作线程数
+    atomic_int shutdown;
+    pthread_mutex_t park_lock;
+    pthread_cond_t park_cond;
+    pthread_mutex_t overflow_lock;
+    pool_overflow *overflow_head;   // 先进先出；其中的区间也计入 queued
+    pool_overflow *overflow_tail;
+};
+
+static __thread int t_task_depth;   // 当前线程正在执行的任务层数
+static atomic_int g_omp_regions;    // 正在运行的驱动 OpenMP 区域数
+
+// 没有完成回调的异步提交也要由最后完成的线程释放
+static void pool_done_none(void *arg) {
+    (void)arg;
+}
+
+static int deque_push(m_blas_pool *pool, pool_deque *d, pool_range r) {
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom - d->top == POOL_DEQUE_SIZE) {
+        pthread_mutex_unlock(&d->lock);
+        return -1;
+    }
+    d->ranges[d->bottom++ & (POOL_DEQUE_SIZE - 1)] = r;
+    atomic_fetch_add(&pool->queued, 1);
+    pthread_mutex_unlock(&d->lock);
+    return 0;
+}
+
+// from_top 为 1 时从顶部窃取，否则由所有者从底部取
+static int deque_take(m_blas_pool *pool, pool_deque *d, int from_top, pool_range *r) {
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom == d->top) {
+        pthread_mutex_unlock(&d->lock);
+        return -1;
+    }
+    if (from_top) {
+        *r = d->ranges[d->top++ & (POOL_DEQUE_SIZE - 1)];
+    } else {
+        *r = d->ranges[--d->bottom & (POOL_DEQUE_SIZE - 1)];
+    }
+    atomic_fetch_sub(&pool->queued, 1);
+    pthread_mutex_unlock(&d->lock);
+    return 0;
+}
+
+static void overflow_push(m_blas_pool *pool, pool_overflow *node) {
+    pthread_mutex_lock(&pool->overflow_lock);
+    node->next = NULL;
+    if (pool->overflow_tail) {
+        pool->overflow_tail->next = node;
+    } else {
+        pool->overflow_head = node;
+    }
+    pool->overflow_tail = node;
+    atomic_fetch_add(&pool->queued, 1);
+    pthread_mutex_unlock(&pool->overflow_lock);
+}
+
+static int overflow_take(m_blas_pool *pool, pool_range *r) {
+    pool_overflow *node;
+
+    pthread_mutex_lock(&pool->overflow_lock);
+    node = pool->overflow_head;
+    if (!node) {
+        pthread_mutex_unlock(&pool->overflow_lock);
+        return -1;
+    }
+    pool->overflow_head = node->next;
+    if (!pool->overflow_head) {
+        pool->overflow_tail = NULL;
+    }
+    // 节点在 job 中，取出后 job 才可能完成并被释放，这里先复制区间
+    *r = node->r;
+    atomic_fetch_sub(&pool->queued, 1);
+    pthread_mutex_unlock(&pool->overflow_lock);
+    return 0;
+}
+
+static void pool_wake(m_blas_pool *pool) {
+    // queued 已在入队时增加；与 pool_park 中先增加 sleepers 再检查 queued 配对，不会丢失唤醒
+    if (atomic_load(&pool->sleepers)) {
+        pthread_mutex_lock(&pool->park_lock);
+        pthread_cond_broadcast(&pool->park_cond);
+        pthread_mutex_unlock(&pool->park_lock);
+    }
+}
+
+static void pool_park(m_blas_pool *pool) {
+    pthread_mutex_lock(&pool->park_lock);
+    atomic_fetch_add(&pool->sleepers, 1);
+    while (atomic_load(&pool->queued) == 0 && !atomic_load(&pool->shutdown)) {
+        pthread_cond_wait(&pool->park_cond, &pool->park_lock);
+    }
+    atomic_fetch_sub(&pool->sleepers, 1);
+    pthread_mutex_unlock(&pool->park_lock);
+}
+
+// 找一个区间：self >= 0 时先取自己的队列，再从 self + 1 起依次窃取，
+// 第一轮只找与 self 同一 L2 簇的线程，最后取溢出链表；
+// *d 为执行时拆分出的上半段放回的队列（区间来自的队列，溢出的放回自己的队列）
+static int pool_find(m_blas_pool *pool, int self, pool_range *r, pool_deque **d) {
+    unsigned int i, start;
+    int pass, cluster = self >= 0 ? pool->threads[self].cluster : -1;
+
+    if (atomic_load(&pool->queued) == 0) {
+        return 0;
+    }
+    if (self >= 0 && deque_take(pool, &pool->deques[self], 0, r) == 0) {
+        *d = &pool->deques[self];
+        return 1;
+    }
+    start = self >= 0 ? (unsigned int)self + 1 : atomic_load(&pool->next);
+    for (pass = cluster >= 0 ? 0 : 1; pass < 2; pass++) {
+        for (i = 0; i < pool->workers; i++) {
+            unsigned int v = (start + i) % pool->workers;
+
+            if (pass == 0 && pool->threads[v].cluster != cluster) {
+                continue;
+            }
+            if (deque_take(pool, &pool->deques[v], 1, r) == 0) {
+                *d = &pool->deques[v];
+                return 1;
+            }
+        }
+    }
+    if (overflow_take(pool, r) == 0) {
+        *d = self >= 0 ? &pool->deques[self] : NULL;
+        return 1;
+    }
+    return 0;
+}
+
+// 执行一个区间：先把上半段放回 d 供其他线程窃取，只执行剩下的部分
+static void pool_execute(m_blas_pool *pool, pool_deque *d, pool_range r) {
+    pool_job *job = r.job;
+    m_blas_done_fn done = job->done;
+    size_t i;
+    int split = 0;
+
+    while (d && r.end - r.begin > 1) {
+        pool_range hi = { r.job, r.begin + (r.end - r.begin) / 2, r.end };
+
+        if (deque_push(pool, d, hi) != 0) {
+            break;
+        }
+        r.end = hi.begin;
+        split = 1;
+    }
+    if (split) {
+        pool_wake(pool);
+    }
+
+    t_task_depth++;
+    for (i = r.begin; i < r.end; i++) {
+        job->fn(job->arg, i);
+    }
+    // dgemm_pool_run 的 job 在调用者的栈上，remaining 减到 0 后调用者可能已经返回，
+    // 所以 done 在此之前读出；异步提交由最后完成的线程回调并释放
+    if (atomic_fetch_sub_explicit(&job->remaining, r.end - r.begin, memory_order_acq_rel) == r.end - r.begin &&
+        done) {
+        done(job->done_arg);
+        free(job);
+    }
+    t_task_depth--;
+}
+
+static void *pool_worker_main(void *arg) {
+    pool_worker *w = (pool_worker*)arg;
+    m_blas_pool *pool = w->pool;
+    pool_range r;
+    pool_deque *d;
+    unsigned int idle = 0;
+
+#ifdef CPU_SET
+    if (w->cpu >= 0) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(w->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
+
+    for (;;) {
+        if (pool_find(pool, (int)w->id, &r, &d)) {
+            pool_execute(pool, d, r);
+            idle = 0;
+        } else if (atomic_load(&pool->shutdown)) {
+            break;
+        } else if (++idle < DGEMM_POOL_SPIN &&
+                   atomic_load_explicit(&g_omp_regions, memory_order_relaxed) == 0) {
+            cpu_relax();
+        } else {
+            pool_park(pool);
+            idle = 0;
+        }
+    }
+    return NULL;
+}
+
+// 按拓扑顺序（大核在前、同簇相邻）进程允许运行的第 index 个 CPU（按允许的个数取模），
+// 返回它在 dgemm_cpu_topology() 中的下标，取不到返回 -1
+static int pool_cpu(unsigned int index) {
+#ifdef CPU_SET
+    const m_blas_topology *topo = dgemm_cpu_topology();
+    cpu_set_t set;
+    unsigned int i, count = 0, n = 0;
+
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return -1;
+    }
+    for (i = 0; i < topo->ncpus; i++) {
+        n += CPU_ISSET(topo->cpu[i], &set) != 0;
+    }
+    if (n == 0) {
+        return -1;
+    }
+    index %= n;
+    for (i = 0; i < topo->ncpus; i++) {
+        if (CPU_ISSET(topo->cpu[i], &set) && count++ == index) {
+            return (int)i;
+        }
+    }
+#else
+    (void)index;
+#endif
+    return -1;
+}
+
+m_blas_pool *dgemm_pool_create(unsigned int threads, unsigned int flags) {
+    m_blas_pool *pool = (m_blas_pool*)calloc(1, sizeof(m_blas_pool));
+    unsigned int i;
+
+    if (!pool) {
+        return NULL;
+    }
+    pool->size = threads ? threads : 1;
+    pool->workers = pool->size - 1;
+    pthread_mutex_init(&pool->park_lock, NULL);
+    pthread_cond_init(&pool->park_cond, NULL);
+    pthread_mutex_init(&pool->overflow_lock, NULL);
+    if (pool->workers == 0) {
+        return pool;
+    }
+
+    pool->deques = (pool_deque*)calloc(pool->workers, sizeof(pool_deque));
+    pool->threads = (pool_worker*)calloc(pool->workers, sizeof(pool_worker));
+    if (!pool->deques || !pool->threads) {
+        free(pool->deques);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    for (i = 0; i < pool->workers; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+    for (i = 0; i < pool->workers; i++) {
+        pool_worker *w = &pool->threads[i];
+        int pos = (flags & M_BLAS_POOL_PIN) ? pool_cpu(i + 1) : -1;  // 第 0 个 CPU 留给调用者
+
+        w->pool = pool;
+        w->id = i;
+        w->cpu = pos >= 0 ? dgemm_cpu_topology()->cpu[pos] : -1;
+        w->cluster = pos >= 0 ? dgemm_cpu_topology()->cluster[pos] : -1;
+    }
+    for (i = 0; i < pool->workers; i++) {
+        pool_worker *w = &pool->threads[i];
+
+        if (pthread_create(&w->thread, NULL, pool_worker_main, w) != 0) {
+            pool->workers = i;
+            break;
+        }
+    }
+    pool->size = pool->workers + 1;
+    return pool;
+}
+
+void dgemm_pool_destroy(m_blas_pool *pool) {
+    unsigned int i;
+
+    if (!pool) {
+        return;
+    }
+    pthread_mutex_lock(&pool->park_lock);
+    atomic_store(&pool->shutdown, 1);
+    pthread_cond_broadcast(&pool->park_cond);
+    pthread_mutex_unlock(&pool->park_lock);
+    for (i = 0; i < pool->workers; i++) {
+        pthread_join(pool->threads[i].thread, NULL);
+    }
+    for (i = 0; i < pool->workers; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+    }
+    pthread_mutex_destroy(&pool->park_lock);
+    pthread_cond_destroy(&pool->park_cond);
+    pthread_mutex_destroy(&pool->overflow_lock);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool);
+}
+
+unsigned int dgemm_pool_size(const m_blas_pool *pool) {
+    return pool ? pool->size : 1;
+}
+
+int dgemm_pool_in_task(void) {
+    return t_task_depth > 0;
+}
+
+void dgemm_pool_omp_begin(void) {
+    atomic_fetch_add_explicit(&g_omp_regions, 1, memory_order_relaxed);
+}
+
+void dgemm_pool_omp_end(void) {
+    atomic_fetch_sub_explicit(&g_omp_regions, 1, memory_order_relaxed);
+}
+
+/**
+ * 把 job 的 count 个下标切成不超过 parts 段，从上次之后的队列开始轮流放入；
+ * 队列满时依次换下一个队列。所有队列都满时：
+ *   dgemm_pool_run    - 调用者反正要等，直接执行这一段
+ *   dgemm_pool_submit - 放入溢出链表（节点为 job->spill[k]），保证提交者不参与计算
+ */
+static void pool_enqueue(m_blas_pool *pool, pool_job *job, size_t count, size_t parts) {
+    unsigned int start = atomic_fetch_add(&pool->next, 1);
+    unsigned int v;
+    size_t k;
+
+    parts = count < parts ? count : parts;
+    for (k = 0; k < parts; k++) {
+        pool_range part = { job, count * k / parts, count * (k + 1) / parts };
+
+        for (v = 0; v < pool->workers; v++) {
+            if (deque_push(pool, &pool->deques[(start + k + v) % pool->workers], part) == 0) {
+                break;
+            }
+        }
+        if (v < pool->workers) {
+            continue;
+        }
+        if (job->done) {
+            job->spill[k].r = part;
+            overflow_push(pool, &job->spill[k]);
+        } else {
+            pool_execute(pool, NULL, part);
+        }
+    }
+    pool_wake(pool);
+}
+
+void dgemm_pool_run(m_blas_pool *pool, size_t count, m_blas_task_fn fn, void *arg) {
+    pool_job job;
+    pool_range r;
+    pool_deque *d;
+    size_t k;
+
+    if (count == 0) {
+        return;
+    }
+    if (!pool || pool->workers == 0 || count == 1) {
+        t_task_depth++;
+        for (k = 0; k < count; k++) {
+            fn(arg, k);
+        }
+        t_task_depth--;
+        return;
+    }
+
+    job.fn = fn;
+    job.arg = arg;
+    job.done = NULL;
+    job.done_arg = NULL;
+    atomic_init(&job.remaining, count);
+    pool_enqueue(pool, &job, count, pool->size);
+
+    // 调用者也参与窃取，直到本次的任务全部完成（可能顺带执行其他提交者的任务）
+    while (atomic_load_explicit(&job.remaining, memory_order_acquire) > 0) {
+        if (pool_find(pool, -1, &r, &d)) {
+            pool_execute(pool, d, r);
+        } else {
+            cpu_relax();
+        }
+    }
+}
+
+int dgemm_pool_submit(m_blas_pool *pool, size_t count, m_blas_task_fn fn, void *arg,
+                      m_blas_done_fn done, void *done_arg) {
+    pool_job *job;
+    size_t k;
+
+    // 没有工作线程时只能由调用者执行
+    if (count == 0 || !pool || pool->workers == 0) {
+        t_task_depth++;
+        for (k = 0; k < count; k++) {
+            fn(arg, k);
+        }
+        if (done) {
+            done(done_arg);
+        }
+        t_task_depth--;
+        return 0;
+    }
+
+    job = (pool_job*)malloc(sizeof(pool_job) + pool->workers * sizeof(pool_overflow));
+    if (!job) {
+        return -1;
+    }
+    job->fn = fn;
+    job->arg = arg;
+    job->done = done ? done : pool_done_none;
+    job->done_arg = done_arg;
+    atomic_init(&job->remaining, count);
+    // 调用者不参与计算，只切成工作线程数段
+    pool_enqueue(pool, job, count, pool->workers);
+    return 0;
+}
+
+/* ========== 默认线程池 ========== */
+
+static m_blas_pool *g_pool;
+static pthread_once_t g_pool_once = PTHREAD_ONCE_INIT;
+
+static void pool_default_init(void) {
+    unsigned int threads = dgemm_config_get()->threads;
+
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (unsigned int)online : 1;
+    }
+    g_pool = dgemm_pool_create(threads, M_BLAS_POOL_PIN);
+}
+
+m_blas_pool *dgemm_pool_default(void) {
+    pthread_once(&g_pool_once, pool_default_init);
+    return g_pool;
+}
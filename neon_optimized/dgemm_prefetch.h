@@ -0,0 +1,70 @@
+#ifndef M_DGEMM_PREFETCH_H
+#define M_DGEMM_PREFETCH_H
+
+#include "blas_dgemm.h"
+
+/**
+ * ============================================================================
+ * 内核预取策略的实例化辅助宏
+ * ============================================================================
+ *
+ * 预取距离可以作为寄存器偏移（prfm op, [xA, xD]）在运行时传入，
+ * 但预取类型（pldl1keep / pldl2strm ...）编码在指令的立即数里，
+ * 只能按 m_blas_prefetch 的每种取值各生成一份内核。
+ *
+ * 内核写在 .inc 文件中，实例化方式：
+ *
+ *   #define PF_SUFFIX l2keep
+ *   #define PF_OP     "pldl2keep"
+ *   #include "dgemm_neon_fast_kernels.inc"
+ *
+ * 不定义 PF_OP 时生成不带预取指令的版本；.inc 末尾会 #undef 这两个宏。
+ * .inc 中用 PF_NAME(kernel) 命名函数，用 PF_INSN(基址, 距离) 生成预取指令。
+ *
+ * 每份内核的签名在原内核后追加 A/B 预取距离（字节），
+ * 再由 PF_TABLE 按 m_blas_prefetch 的顺序排成函数表，由原内核名按配置查表调用。
+ * ============================================================================
+ */
+
+#define PF_CAT_(name, suffix) name##_##suffix
+#define PF_CAT(name, suffix) PF_CAT_(name, suffix)
+#define PF_NAME(name) PF_CAT(name, PF_SUFFIX)
+
+// 各预取策略的内核，顺序与 m_blas_prefetch 一致
+#define PF_TABLE(name) {            \
+        PF_CAT(name, none),         \
+        PF_CAT(name, l1keep),       \
+        PF_CAT(name, l1strm),       \
+        PF_CAT(name, l2keep),       \
+        PF_CAT(name, l2strm),       \
+    }
+
+typedef void (*m_blas_kernel_pf)(unsigned int m, unsigned int n, unsigned int p,
+                                 double *sa, double *sb, double *sc, size_t ldc,
+                                 unsigned long pf_a, unsigned long pf_b);
+
+/**
+ * ============================================================================
+ * C 块的写回方式（dgemm_neon_fast 的内核）
+ * ============================================================================
+ *
+ * 内核默认先装载 C 再累加。C 刚被清零（beta = 0）时这次读没有用处，
+ * C 又放不进缓存时，读入再写回使 C 的访存量翻倍。按位组合：
+ *
+ *   M_BLAS_C_ZERO     - 不读 C，累加器清零（beta = 0 时的第一个 k 块）
+ *   M_BLAS_C_STREAM   - 用 stnp 非临时存储写回（最后一个 k 块且 C 大于 stream_c_bytes）
+ *   M_BLAS_C_PREFETCH - 计算前对同一行的下一个 C 块发 prfm pstl1keep
+ *
+ * 位号与内核 asm 中的 tbz/tbnz 一一对应，不要改动
+ * ============================================================================
+ */
+#define M_BLAS_C_ZERO     (1UL << 0)
+#define M_BLAS_C_STREAM   (1UL << 1)
+#define M_BLAS_C_PREFETCH (1UL << 2)
+
+typedef void (*m_blas_kernel_pfc)(unsigned int m, unsigned int n, unsigned int p,
+                                  double *sa, double *sb, double *sc, size_t ldc,
+                                  unsigned long pf_a, unsigned long pf_b,
+                                  unsigned long c_mode);
+
+#endif
@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "blas_dgemm.h"
+
+/*
+ * 自动调优工具
+ * 用法: ./dgemm_tune [矩阵规模，默认 512] [配置文件，默认 $DGEMM_CONFIG 或 dgemm_tune.conf]
+ * 生成的配置文件在库首次调用 dgemm_config_get() 时自动加载
+ */
+int main(int argc, char **argv) {
+    unsigned int size = argc > 1 ? (unsigned int)atoi(argv[1]) : 512;
+    const char *path = argc > 2 ? argv[2] : getenv("DGEMM_CONFIG");
+    m_blas_cache_info info;
+    m_blas_config model, best;
+
+    if (!path) {
+        path = "dgemm_tune.conf";
+    }
+
+    if (dgemm_cache_info(&info) == 0) {
+        printf("L1d: %u KB, L2: %u KB (%u CPU 共享), L3: %u KB (%u CPU 共享)\n",
+               info.l1d_size >> 10, info.l2_size >> 10, info.l2_shared,
+               info.l3_size >> 10, info.l3_shared);
+        dgemm_config_from_cache(&info, &model);
+        printf("缓存推导: gemm_m=%u gemm_n=%u gemm_p=%u direct_max_mnp=%u\n",
+               model.gemm_m, model.gemm_n, model.gemm_p, model.direct_max_mnp);
+    } else {
+        printf("无法读取 /sys 缓存信息，从默认值开始搜索\n");
+    }
+
+    printf("在 %ux%ux%u 上搜索...\n", size, size, size);
+    if (dgemm_autotune(size, path, &best) != 0) {
+        fprintf(stderr, "自动调优失败（需要 NEON，且配置文件可写: %s）\n", path);
+        return 1;
+    }
+
+    printf("最佳配置: gemm_m=%u gemm_n=%u gemm_p=%u prefetch_a=%u prefetch_b=%u prefetch_type=%s\n",
+           best.gemm_m, best.gemm_n, best.gemm_p, best.prefetch_a, best.prefetch_b,
+           dgemm_prefetch_name(best.prefetch_type));
+    printf("不打包交叉点: m*n*p <= %u\n", best.direct_max_mnp);
+    printf("已保存到: %s\n", path);
+    return 0;
+}
@@ -30,7 +30,9 @@
  // ========== 测试配置 ==========
  #define NUM_RUNS 50           // 每个测试运行次数
  #define OUTLIER_PERCENT 0.1   // 排除的异常值比例（前后各10%，仅MODE 1和2）
- #define VERIFY_CORRECTNESS 0  // 是否验证结果正确性（0=否，1=是）
+ #ifndef VERIFY_CORRECTNESS
+ #define VERIFY_CORRECTNESS 0  // 是否验证结果正确性（0=否，1=是），可用 make VERIFY=1 打开
+ #endif
  #define EPSILON 1e-9          // double精度比较阈值
  
  // ⭐⭐⭐ 测试模式选择 ⭐⭐⭐
@@ -39,6 +41,11 @@
  // 2 = 完整流程模式（每次重新分配，计时全部，排除异常值）
  #define TEST_MODE 0
  
+ // 行距填充：1 = 行距取 dgemm_ld_pad(列数)，避开 128 / 256 等 2 的幂规模的 4K 混叠
+ //           0 = 行距等于列数（与 op-lyb 一致）✅ 默认
+ // 矩阵按行距整行分配，初始化和清零覆盖填充部分
+ #define PAD_LD 0
+ 
  // 测试用例结构
  typedef struct {
      const char *name;
@@ -65,9 +72,18 @@
      dgemm_func_ptr func;
  } OptFunc;
  
-// 1个优化版本：dgemm_neon_small
+// 优化版本：库中三个实现及其分发入口（对比各实现即可得到 dgemm_dispatch.c 的分界点）、
+// 固定形状内核 + gen_kernels.py 生成的内核（Makefile 中 GEN_SHAPES）
 static const OptFunc opt_funcs[] = {
-    {"dgemm_neon_small",     dgemm_neon_small_wrapper}
+    {"dgemm_neon",           dgemm_neon_wrapper},
+    {"dgemm_neon_fast",      dgemm_neon_fast_wrapper},
+    {"dgemm_neon_small",     dgemm_neon_small_wrapper},
+    {"dgemm_neon_auto",      dgemm_neon_auto_wrapper},
+    {"dgemm_neon_direct",    dgemm_neon_direct_wrapper},
+    {"dgemm_fixed",          dgemm_fixed_wrapper},
+#ifdef DGEMM_GEN_OPT_FUNCS
+    DGEMM_GEN_OPT_FUNCS
+#endif
 };
 #define NUM_OPT_FUNCS (sizeof(opt_funcs) / sizeof(OptFunc))
  
@@ -141,6 +157,11 @@ static const OptFunc opt_funcs[] = {
      memset(mat, 0, rows * cols * sizeof(double));
  }
  
+ // 测试使用的行距（见 PAD_LD）
+ static unsigned int bench_ld(int cols) {
+     return PAD_LD ? dgemm_ld_pad(cols) : (unsigned int)cols;
+ }
+ 
  #if VERIFY_CORRECTNESS
  // 简单的参考实现（用于验证正确性）
  static void reference_dgemm(int m, int n, int p, 
@@ -178,9 +199,9 @@ static const OptFunc opt_funcs[] = {
      int M = tc->M;
      int P = tc->P;
      int N = tc->N;
-     unsigned int lda = P;
-     unsigned int ldb = N;
-     unsigned int ldc = N;
+     unsigned int lda = bench_ld(P);
+     unsigned int ldb = bench_ld(N);
+     unsigned int ldc = bench_ld(N);
      
      double *times = (double*)malloc(NUM_RUNS * sizeof(double));
      if (!times) {
@@ -191,9 +212,9 @@ static const OptFunc opt_funcs[] = {
      // 模拟op-lyb的test.sh循环：每次启动新进程
      for (int run = 0; run < NUM_RUNS; run++) {
          // === 不计时：分配内存（模拟进程启动） ===
-         double *A = (double*)malloc(M * P * sizeof(double));
-         double *B = (double*)malloc(P * N * sizeof(double));
-         double *C = (double*)malloc(M * N * sizeof(double));
+         double *A = (double*)malloc(M * lda * sizeof(double));
+         double *B = (double*)malloc(P * ldb * sizeof(double));
+         double *C = (double*)malloc(M * ldc * sizeof(double));
          
          if (!A || !B || !C) {
              fprintf(stderr, "错误: 内存分配失败 (run %d)\n", run);
@@ -205,9 +226,9 @@ static const OptFunc opt_funcs[] = {
          }
          
          // === 不计时：初始化矩阵 ===
-         init_matrix(M, P, A);
-         init_matrix(P, N, B);
-         zero_matrix(M, N, C);
+         init_matrix(M, lda, A);
+         init_matrix(P, ldb, B);
+         zero_matrix(M, ldc, C);
          
          // === ⭐ 只计时这部分：DGEMM调用 ⭐ ===
          double start = get_time_ms();
@@ -237,9 +258,9 @@ static const OptFunc opt_funcs[] = {
      int M = tc->M;
      int P = tc->P;
      int N = tc->N;
-     unsigned int lda = P;
-     unsigned int ldb = N;
-     unsigned int ldc = N;
+     unsigned int lda = bench_ld(P);
+     unsigned int ldb = bench_ld(N);
+     unsigned int ldc = bench_ld(N);
      
      double *times = (double*)malloc(NUM_RUNS * sizeof(double));
      if (!times) {
@@ -248,9 +269,9 @@ static const OptFunc opt_funcs[] = {
      }
      
      // 分配矩阵（只一次）
-     double *A = (double*)malloc(M * P * sizeof(double));
-     double *B = (double*)malloc(P * N * sizeof(double));
-     double *C = (double*)malloc(M * N * sizeof(double));
+     double *A = (double*)malloc(M * lda * sizeof(double));
+     double *B = (double*)malloc(P * ldb * sizeof(double));
+     double *C = (double*)malloc(M * ldc * sizeof(double));
      
      if (!A || !B || !C) {
          fprintf(stderr, "错误: 内存分配失败\n");
@@ -262,20 +283,20 @@ static const OptFunc opt_funcs[] = {
      }
      
      // 初始化矩阵（只一次）
-     init_matrix(M, P, A);
-     init_matrix(P, N, B);
+     init_matrix(M, lda, A);
+     init_matrix(P, ldb, B);
      
  #if VERIFY_CORRECTNESS
-     double *C_ref = (double*)malloc(M * N * sizeof(double));
+     double *C_ref = (double*)malloc(M * ldc * sizeof(double));
      if (C_ref) {
-         zero_matrix(M, N, C_ref);
+         zero_matrix(M, ldc, C_ref);
          reference_dgemm(M, N, P, A, lda, B, ldb, C_ref, ldc);
      }
  #endif
      
      // 运行多次测试（只测DGEMM，热缓存）
      for (int run = 0; run < NUM_RUNS; run++) {
-         zero_matrix(M, N, C);
+         zero_matrix(M, ldc, C);
          
          double start = get_time_ms();
          opt->func(M, N, P, A, lda, B, ldb, C, ldc);
@@ -285,7 +306,7 @@ static const OptFunc opt_funcs[] = {
          
  #if VERIFY_CORRECTNESS
          if (run == 0 && C_ref) {
-             if (!verify_matrix(M, N, C, C_ref)) {
+             if (!verify_matrix(M, ldc, C, C_ref)) {
                  fprintf(stderr, "\n警告: 结果不正确！\n");
                  free(C_ref);
                  free(times);
@@ -321,9 +342,9 @@ static const OptFunc opt_funcs[] = {
      int M = tc->M;
      int P = tc->P;
      int N = tc->N;
-     unsigned int lda = P;
-     unsigned int ldb = N;
-     unsigned int ldc = N;
+     unsigned int lda = bench_ld(P);
+     unsigned int ldb = bench_ld(N);
+     unsigned int ldc = bench_ld(N);
      
      double *times = (double*)malloc(NUM_RUNS * sizeof(double));
      if (!times) {
@@ -336,9 +357,9 @@ static const OptFunc opt_funcs[] = {
          double start = get_time_ms();
          
          // 分配矩阵
-         double *A = (double*)malloc(M * P * sizeof(double));
-         double *B = (double*)malloc(P * N * sizeof(double));
-         double *C = (double*)malloc(M * N * sizeof(double));
+         double *A = (double*)malloc(M * lda * sizeof(double));
+         double *B = (double*)malloc(P * ldb * sizeof(double));
+         double *C = (double*)malloc(M * ldc * sizeof(double));
          
          if (!A || !B || !C) {
              fprintf(stderr, "错误: 内存分配失败 (run %d)\n", run);
@@ -350,9 +371,9 @@ static const OptFunc opt_funcs[] = {
          }
          
          // 初始化矩阵
-         init_matrix(M, P, A);
-         init_matrix(P, N, B);
-         zero_matrix(M, N, C);
+         init_matrix(M, lda, A);
+         init_matrix(P, ldb, B);
+         zero_matrix(M, ldc, C);
          
          // DGEMM计算
          opt->func(M, N, P, A, lda, B, ldb, C, ldc);
@@ -412,6 +433,7 @@ static const OptFunc opt_funcs[] = {
  #else
      printf("  - 正确性验证: 已禁用\n");
  #endif
+     printf("  - 行距: %s\n", PAD_LD ? "dgemm_ld_pad 填充（避开 4K 混叠）" : "等于列数");
      printf("========================================================================================================\n\n");
  }
  
@@ -0,0 +1,841 @@
+/*
+ * DGEMM 库的功能测试（make check）
+ *
+ * benchmark.c 只测性能，这里检查库中各条路径算得对、并发接口用得对：
+ *
+ *   shapes       - dgemm_neon_small / dgemm_neon_auto（含不对齐的 dgemm_neon_edge）在各种形状、
+ *                  行距下与朴素实现逐位相同（整数数据，乘加没有舍入）
+ *   config       - 另一个线程不停地 dgemm_config_set 时，dgemm_neon_fast 的结果仍然正确
+ *   batch        - 77 个乘法的 dgemm_neon_batch 与朴素实现一致，dgemm_neon_batch_interleaved
+ *                  与它逐位相同，且都与线程池大小无关
+ *   splitk       - 按 K 划分在 1..8 个线程下与朴素实现一致；M_BLAS_THREAD_DETERMINISTIC
+ *                  时同一线程数重复运行逐位相同
+ *   reproducible - 按 K 划分的形状在可复现模式下 1..8 个线程逐位相同；
+ *                  dgemm_neon_auto 与批量接口在不同线程数 / 线程池大小下逐位相同
+ *   async        - dgemm_submit* 的 poll / wait / release、NULL 回调、只用回调、空批量
+ *   pool         - 队列全满时异步提交的任务也不在提交者中执行
+ *   team         - OpenMP 实际启动的线程少于计划的线程数时，按 M / N / 网格与按 K 划分
+ *                  （含确定性、可复现模式）的结果正确
+ *   direct       - dgemm_neon_direct 按 thr / 配置的线程数分给线程池时结果正确
+ *   topology     - 假的 rk3399 sysfs（DGEMM_SYSFS_CPU）：大核在前、按 L2 分簇，
+ *                  在这种拓扑下各种划分方式的多线程结果正确（按拓扑排位只在 OpenMP 线程
+ *                  绑定时进行，make check 另以 OMP_PROC_BIND=close 单独运行这一项）
+ *
+ * 用法：./check_O2 [测试名 ...]，不带参数时运行全部；任何一项失败时返回 1。
+ * config / async / pool / batch 四项也用于 make check_tsan（ThreadSanitizer）。
+ */
+
+#define _GNU_SOURCE
+#include <ftw.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "blas_dgemm.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond, ...) do {                               \
+        if (!(cond)) {                                      \
+            printf("  失败 %s:%d: ", __FILE__, __LINE__);   \
+            printf(__VA_ARGS__);                            \
+            printf("\n");                                   \
+            g_failures++;                                   \
+        }                                                   \
+    } while (0)
+
+static double *g_sa, *g_sb;
+
+// [-range, range] 内的整数，乘积与和都能精确表示
+static void fill_int(double *x, size_t count, unsigned int *seed, int range) {
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        x[i] = (double)((int)(rand_r(seed) % (2 * range + 1)) - range);
+    }
+}
+
+static void fill_real(double *x, size_t count, unsigned int *seed) {
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        x[i] = rand_r(seed) / (double)RAND_MAX - 0.5;
+    }
+}
+
+// C += A*B 的朴素实现
+static void gemm_ref(size_t m, size_t n, size_t p, const double *a, size_t lda,
+                     const double *b, size_t ldb, double *c, size_t ldc) {
+    size_t i, j, k;
+
+    for (i = 0; i < m; i++) {
+        for (k = 0; k < p; k++) {
+            for (j = 0; j < n; j++) {
+                c[i * ldc + j] += a[i * lda + k] * b[k * ldb + j];
+            }
+        }
+    }
+}
+
+// 相对误差（按 |C| + 1 归一）
+static double max_relerr(size_t m, size_t n, const double *c, const double *ref, size_t ldc) {
+    double e = 0;
+    size_t i, j;
+
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < n; j++) {
+            double d = fabs(c[i * ldc + j] - ref[i * ldc + j]) / (fabs(ref[i * ldc + j]) + 1);
+            e = d > e ? d : e;
+        }
+    }
+    return e;
+}
+
+/* ========== shapes ========== */
+
+// 行距比列数多出 pad，C 的填充部分也参与比较（不能被写）
+static int shape_exact(unsigned int m, unsigned int n, unsigned int p, unsigned int pad, int use_auto) {
+    unsigned int lda = p + pad, ldb = n + pad, ldc = n + pad;
+    unsigned int seed = m * 131 + n * 17 + p;
+    double *a = malloc((size_t)m * lda * sizeof(double)), *b = malloc((size_t)p * ldb * sizeof(double));
+    double *c = malloc((size_t)m * ldc * sizeof(double)), *ref = malloc((size_t)m * ldc * sizeof(double));
+    int ok;
+
+    fill_int(a, (size_t)m * lda, &seed, 4);
+    fill_int(b, (size_t)p * ldb, &seed, 4);
+    fill_int(c, (size_t)m * ldc, &seed, 4);
+    memcpy(ref, c, (size_t)m * ldc * sizeof(double));
+    gemm_ref(m, n, p, a, lda, b, ldb, ref, ldc);
+    if (use_auto) {
+        dgemm_neon_auto(m, n, p, a, lda, b, ldb, c, ldc, g_sa, g_sb);
+    } else {
+        dgemm_neon_small(m, n, p, a, lda, b, ldb, c, ldc, g_sa, g_sb);
+    }
+    ok = memcmp(c, ref, (size_t)m * ldc * sizeof(double)) == 0;
+    free(a);
+    free(b);
+    free(c);
+    free(ref);
+    return ok;
+}
+
+static void test_shapes(void) {
+    static const unsigned int big[][3] = {
+        { 100, 100, 100 }, { 250, 250, 250 }, { 65, 67, 70 }, { 128, 3, 300 }, { 3, 200, 77 },
+        { 129, 131, 5 }, { 64, 64, 63 }, { 260, 4, 4 }, { 33, 33, 33 }, { 1, 1000, 1 },
+        { 200, 200, 2 }, { 96, 96, 96 }, { 256, 240, 248 }
+    };
+    unsigned int m, n, p, i;
+
+    // 先在打包缓冲区中留下无关的数据：结果不能依赖之前的调用
+    memset(g_sa, 0x7f, M_BLAS_PACK_SA_SIZE * sizeof(double));
+    memset(g_sb, 0x7f, M_BLAS_PACK_SB_SIZE * sizeof(double));
+
+    for (m = 1; m <= 40; m += m < 20 ? 1 : 3) {
+        for (n = 1; n <= 40; n += n < 20 ? 1 : 3) {
+            for (p = 1; p <= 40; p += p < 12 ? 1 : 5) {
+                CHECK(shape_exact(m, n, p, 1, 0), "dgemm_neon_small %ux%ux%u", m, n, p);
+            }
+        }
+    }
+    for (i = 0; i < sizeof(big) / sizeof(big[0]); i++) {
+        m = big[i][0], n = big[i][1], p = big[i][2];
+        CHECK(shape_exact(m, n, p, 3, 0), "dgemm_neon_small %ux%ux%u", m, n, p);
+        CHECK(shape_exact(m, n, p, 3, 1), "dgemm_neon_auto %ux%ux%u (route %d)",
+              m, n, p, (int)dgemm_neon_auto_route(m, n, p));
+    }
+}
+
+/* ========== config ========== */
+
+static atomic_int g_config_stop;
+
+// 在两份分块参数差别很大的配置之间来回切换
+static void *config_flipper(void *arg) {
+    const m_blas_config *base = (const m_blas_config*)arg;
+    m_blas_config cfg[2] = { *base, *base };
+    unsigned int i = 0;
+
+    cfg[0].gemm_m = 64, cfg[0].gemm_n = 512, cfg[0].gemm_p = 256;
+    cfg[1].gemm_m = 4096, cfg[1].gemm_n = 16, cfg[1].gemm_p = 32;
+    while (!atomic_load(&g_config_stop)) {
+        dgemm_config_set(&cfg[i++ & 1]);
+    }
+    return NULL;
+}
+
+static void test_config(void) {
+    const size_t m = 192, n = 200, p = 176;
+    m_blas_config saved = *dgemm_config_get();
+    unsigned int seed = 31;
+    double *a = malloc(m * p * sizeof(double)), *b = malloc(p * n * sizeof(double));
+    double *c = malloc(m * n * sizeof(double)), *ref = calloc(m * n, sizeof(double));
+    pthread_t flipper;
+    int round;
+
+    fill_int(a, m * p, &seed, 4);
+    fill_int(b, p * n, &seed, 4);
+    gemm_ref(m, n, p, a, p, b, n, ref, n);
+    atomic_store(&g_config_stop, 0);
+    if (pthread_create(&flipper, NULL, config_flipper, &saved) != 0) {
+        CHECK(0, "无法创建线程");
+        return;
+    }
+    for (round = 0; round < 20; round++) {
+        memset(c, 0, m * n * sizeof(double));
+        dgemm_neon_auto_64(m, n, p, a, p, b, n, c, n, g_sa, g_sb);
+        CHECK(memcmp(c, ref, m * n * sizeof(double)) == 0, "第 %d 轮结果错误", round);
+    }
+    atomic_store(&g_config_stop, 1);
+    pthread_join(flipper, NULL);
+    dgemm_config_set(&saved);
+    free(a);
+    free(b);
+    free(c);
+    free(ref);
+}
+
+/* ========== batch ========== */
+
+#define BATCH_COUNT (77)
+
+// 小矩阵、打包、不打包、不对齐与空乘法混在一起
+static void batch_make(m_blas_gemm *g, size_t count, unsigned int seed) {
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        size_t m, n, p, lda, ldb, ldc;
+
+        switch (i % 5) {
+        case 0:
+            m = 4 * (1 + rand_r(&seed) % 8), n = 4 * (1 + rand_r(&seed) % 8), p = 4 * (1 + rand_r(&seed) % 8);
+            break;
+        case 1:
+            m = 4 * (8 + rand_r(&seed) % 16), n = 4 * (8 + rand_r(&seed) % 16), p = 1 + rand_r(&seed) % 300;
+            break;
+        case 2:
+            m = 4 * (8 + rand_r(&seed) % 16), n = 8 * (4 + rand_r(&seed) % 8), p = 4 * (10 + rand_r(&seed) % 60);
+            break;
+        case 3:
+            m = i % 2 ? 160 : 130, n = i % 2 ? 168 : 77, p = i % 2 ? 200 : 300;
+            break;
+        default:
+            m = rand_r(&seed) % 4 ? 12 : 0, n = 16, p = rand_r(&seed) % 3 ? 40 : 0;
+            break;
+        }
+        lda = p + 3, ldb = n + 5, ldc = n + 1;
+        g[i].m = m, g[i].n = n, g[i].p = p;
+        g[i].lda = lda, g[i].ldb = ldb, g[i].ldc = ldc;
+        g[i].a = malloc((m * lda + 1) * sizeof(double));
+        g[i].b = malloc((p * ldb + 1) * sizeof(double));
+        g[i].c = malloc((m * ldc + 1) * sizeof(double));
+        fill_real(g[i].a, m * lda, &seed);
+        fill_real(g[i].b, p * ldb, &seed);
+        fill_real(g[i].c, m * ldc, &seed);
+    }
+}
+
+static void batch_free(m_blas_gemm *g, size_t count) {
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        free(g[i].a);
+        free(g[i].b);
+        free(g[i].c);
+    }
+}
+
+// 另一份 C 相同、A / B 共用的批量
+static void batch_clone(m_blas_gemm *dst, const m_blas_gemm *src, size_t count) {
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        dst[i] = src[i];
+        dst[i].c = malloc((src[i].m * src[i].ldc + 1) * sizeof(double));
+        memcpy(dst[i].c, src[i].c, src[i].m * src[i].ldc * sizeof(double));
+    }
+}
+
+static void batch_free_c(m_blas_gemm *g, size_t count) {
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        free(g[i].c);
+    }
+}
+
+static void test_batch(void) {
+    m_blas_gemm g[BATCH_COUNT], base[BATCH_COUNT], ref[BATCH_COUNT], tmp[BATCH_COUNT];
+    static const unsigned int pools[] = { 1, 2, 4 };
+    size_t i, w;
+
+    batch_make(g, BATCH_COUNT, 5);
+    batch_clone(ref, g, BATCH_COUNT);
+    for (i = 0; i < BATCH_COUNT; i++) {
+        gemm_ref(ref[i].m, ref[i].n, ref[i].p, ref[i].a, ref[i].lda, ref[i].b, ref[i].ldb,
+                 ref[i].c, ref[i].ldc);
+    }
+
+    // 以单线程池的 dgemm_neon_batch 为基准
+    batch_clone(base, g, BATCH_COUNT);
+    {
+        m_blas_pool *pool = dgemm_pool_create(1, 0);
+        dgemm_neon_batch_pool(pool, base, BATCH_COUNT);
+        dgemm_pool_destroy(pool);
+    }
+    for (i = 0; i < BATCH_COUNT; i++) {
+        CHECK(max_relerr(g[i].m, g[i].n, base[i].c, ref[i].c, g[i].ldc) < 1e-12,
+              "batch 第 %zu 个（%zux%zux%zu）误差", i, g[i].m, g[i].n, g[i].p);
+    }
+
+    for (w = 0; w < sizeof(pools) / sizeof(pools[0]); w++) {
+        m_blas_pool *pool = dgemm_pool_create(pools[w], 0);
+
+        batch_clone(tmp, g, BATCH_COUNT);
+        dgemm_neon_batch_pool(pool, tmp, BATCH_COUNT);
+        for (i = 0; i < BATCH_COUNT; i++) {
+            CHECK(memcmp(tmp[i].c, base[i].c, g[i].m * g[i].ldc * sizeof(double)) == 0,
+                  "batch 第 %zu 个（%zux%zux%zu）：%u 线程的池结果不同", i, g[i].m, g[i].n, g[i].p, pools[w]);
+        }
+        batch_free_c(tmp, BATCH_COUNT);
+
+        batch_clone(tmp, g, BATCH_COUNT);
+        dgemm_neon_batch_interleaved_pool(pool, tmp, BATCH_COUNT);
+        for (i = 0; i < BATCH_COUNT; i++) {
+            CHECK(memcmp(tmp[i].c, base[i].c, g[i].m * g[i].ldc * sizeof(double)) == 0,
+                  "batch_interleaved 第 %zu 个（%zux%zux%zu，route %d）：%u 线程的池与 batch 不同",
+                  i, g[i].m, g[i].n, g[i].p, (int)dgemm_neon_auto_route_64(g[i].m, g[i].n, g[i].p),
+                  pools[w]);
+        }
+        batch_free_c(tmp, BATCH_COUNT);
+        dgemm_pool_destroy(pool);
+    }
+    batch_free_c(base, BATCH_COUNT);
+    batch_free_c(ref, BATCH_COUNT);
+    batch_free(g, BATCH_COUNT);
+}
+
+/* ========== splitk ========== */
+
+static void test_splitk(void) {
+    static const size_t shapes[][3] = {
+        { 16, 16, 4096 }, { 8, 8, 4096 }, { 4, 8, 300 }, { 32, 16, 2048 }, { 12, 20, 1000 }
+    };
+    size_t i, k;
+
+    for (i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+        size_t m = shapes[i][0], n = shapes[i][1], p = shapes[i][2];
+        size_t lda = p + 1, ldb = n + 3, ldc = n;
+        unsigned int seed = (unsigned int)i + 3, th;
+        double *a = malloc(m * lda * sizeof(double)), *b = malloc(p * ldb * sizeof(double));
+        double *c = malloc(m * ldc * sizeof(double)), *c1 = malloc(m * ldc * sizeof(double));
+        double *ref = malloc(m * ldc * sizeof(double));
+
+        fill_real(a, m * lda, &seed);
+        fill_real(b, p * ldb, &seed);
+        for (k = 0; k < m * ldc; k++) {
+            ref[k] = k * 0.25;
+        }
+        gemm_ref(m, n, p, a, lda, b, ldb, ref, ldc);
+
+        for (th = 1; th <= 8; th++) {
+            m_blas_threading thr = { th, M_BLAS_SPLIT_K, 0, M_BLAS_THREAD_DETERMINISTIC };
+            int run;
+
+            for (run = 0; run < 2; run++) {
+                for (k = 0; k < m * ldc; k++) {
+                    c[k] = k * 0.25;
+                }
+                dgemm_neon_fast_threads_64(m, n, p, a, lda, b, ldb, c, ldc, g_sa, g_sb, &thr);
+                if (run == 0) {
+                    memcpy(c1, c, m * ldc * sizeof(double));
+                    CHECK(max_relerr(m, n, c, ref, ldc) < 1e-12, "splitk %zux%zux%zu %u 个线程误差",
+                          m, n, p, th);
+                } else {
+                    CHECK(memcmp(c, c1, m * ldc * sizeof(double)) == 0,
+                          "splitk %zux%zux%zu %u 个线程：两次结果不同", m, n, p, th);
+                }
+            }
+        }
+        free(a);
+        free(b);
+        free(c);
+        free(c1);
+        free(ref);
+    }
+}
+
+/* ========== reproducible ========== */
+
+static void test_reproducible(void) {
+    // 前四个按 K 划分
+    static const size_t shapes[][3] = {
+        { 16, 16, 4096 }, { 8, 8, 4096 }, { 12, 20, 1000 }, { 4, 8, 300 },
+        { 120, 136, 96 }, { 100, 100, 100 }, { 17, 19, 4099 }, { 300, 64, 31 }, { 28, 24, 12 }
+    };
+    m_blas_config saved = *dgemm_config_get(), cfg = saved;
+    size_t i, k;
+
+    for (i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+        size_t m = shapes[i][0], n = shapes[i][1], p = shapes[i][2];
+        size_t lda = p + 1, ldb = n + 3, ldc = n;
+        unsigned int seed = (unsigned int)i + 1, th, w;
+        double *a = malloc(m * lda * sizeof(double)), *b = malloc(p * ldb * sizeof(double));
+        double *c = malloc(m * ldc * sizeof(double)), *c1 = malloc(m * ldc * sizeof(double));
+        double *ref = malloc(m * ldc * sizeof(double));
+
+        fill_real(a, m * lda, &seed);
+        fill_real(b, p * ldb, &seed);
+        for (k = 0; k < m * ldc; k++) {
+            ref[k] = k * 0.25;
+        }
+        gemm_ref(m, n, p, a, lda, b, ldb, ref, ldc);
+
+        // 对齐的形状：dgemm_neon_fast_threads 带 M_BLAS_THREAD_REPRODUCIBLE
+        if (((m | n | p) & 3) == 0) {
+            for (th = 1; th <= 8; th++) {
+                m_blas_threading thr = { th, M_BLAS_SPLIT_AUTO, 0, M_BLAS_THREAD_REPRODUCIBLE };
+
+                for (k = 0; k < m * ldc; k++) {
+                    c[k] = k * 0.25;
+                }
+                dgemm_neon_fast_threads_64(m, n, p, a, lda, b, ldb, c, ldc, g_sa, g_sb, &thr);
+                if (th == 1) {
+                    memcpy(c1, c, m * ldc * sizeof(double));
+                    CHECK(max_relerr(m, n, c, ref, ldc) < 1e-12, "fast_threads %zux%zux%zu 误差",
+                          m, n, p);
+                } else {
+                    CHECK(memcmp(c, c1, m * ldc * sizeof(double)) == 0,
+                          "fast_threads %zux%zux%zu：%u 个线程与 1 个线程不同", m, n, p, th);
+                }
+            }
+        }
+
+        // 任意形状：配置中打开可复现模式，dgemm_neon_auto 与批量接口
+        cfg.reproducible = 1;
+        for (th = 1; th <= 6; th++) {
+            cfg.threads = th;
+            dgemm_config_set(&cfg);
+            for (k = 0; k < m * ldc; k++) {
+                c[k] = k * 0.25;
+            }
+            dgemm_neon_auto_64(m, n, p, a, lda, b, ldb, c, ldc, g_sa, g_sb);
+            if (th == 1) {
+                memcpy(c1, c, m * ldc * sizeof(double));
+                CHECK(max_relerr(m, n, c, ref, ldc) < 1e-12, "auto %zux%zux%zu 误差", m, n, p);
+            } else {
+                CHECK(memcmp(c, c1, m * ldc * sizeof(double)) == 0,
+                      "auto %zux%zux%zu：%u 个线程与 1 个线程不同", m, n, p, th);
+            }
+        }
+        for (w = 1; w <= 5; w += 2) {
+            m_blas_pool *pool = dgemm_pool_create(w, 0);
+            m_blas_gemm g = { m, n, p, a, lda, b, ldb, c, ldc };
+
+            for (k = 0; k < m * ldc; k++) {
+                c[k] = k * 0.25;
+            }
+            dgemm_neon_batch_pool(pool, &g, 1);
+            CHECK(memcmp(c, c1, m * ldc * sizeof(double)) == 0,
+                  "batch %zux%zux%zu：%u 线程的池与单线程不同", m, n, p, w);
+            for (k = 0; k < m * ldc; k++) {
+                c[k] = k * 0.25;
+            }
+            dgemm_neon_batch_interleaved_pool(pool, &g, 1);
+            CHECK(memcmp(c, c1, m * ldc * sizeof(double)) == 0,
+                  "batch_interleaved %zux%zux%zu：%u 线程的池与单线程不同", m, n, p, w);
+            dgemm_pool_destroy(pool);
+        }
+        dgemm_config_set(&saved);
+        free(a);
+        free(b);
+        free(c);
+        free(c1);
+        free(ref);
+    }
+}
+
+/* ========== async ========== */
+
+static atomic_int g_callbacks;
+
+static void count_done(void *arg) {
+    atomic_fetch_add((atomic_int*)arg, 1);
+}
+
+static void test_async(void) {
+    static const size_t sizes[] = { 32, 40, 48, 64, 56, 36 };
+    m_blas_pool *pool = dgemm_pool_create(4, 0);
+    int round;
+
+    for (round = 0; round < 6; round++) {
+        m_blas_gemm g[6], ref[6];
+        m_blas_request *r1, *r2, *r3, *r4;
+        atomic_int only_cb = 0;
+        unsigned int seed = (unsigned int)round + 7;
+        int i, before = atomic_load(&g_callbacks);
+
+        for (i = 0; i < 6; i++) {
+            size_t s = sizes[i];
+
+            g[i] = (m_blas_gemm){ s, s, s, malloc(s * s * sizeof(double)), s,
+                                  malloc(s * s * sizeof(double)), s, calloc(s * s, sizeof(double)), s };
+            fill_int(g[i].a, s * s, &seed, 3);
+            fill_int(g[i].b, s * s, &seed, 3);
+        }
+        batch_clone(ref, g, 6);
+        for (i = 0; i < 6; i++) {
+            gemm_ref(ref[i].m, ref[i].n, ref[i].p, ref[i].a, ref[i].lda, ref[i].b, ref[i].ldb,
+                     ref[i].c, ref[i].ldc);
+        }
+
+        r1 = dgemm_submit_batch_pool(pool, g, 3, count_done, &g_callbacks);
+        r2 = dgemm_submit_batch_pool(pool, g + 3, 2, count_done, &only_cb);
+        dgemm_release(r2);      // 只用回调
+        r3 = dgemm_submit_batch_pool(pool, g + 5, 1, NULL, NULL);
+        CHECK(r1 && r2 && r3, "dgemm_submit_batch_pool 返回 NULL");
+        while (!dgemm_poll(r1)) {
+            sched_yield();
+        }
+        CHECK(atomic_load(&g_callbacks) == before + 1, "poll 返回 1 时回调应已返回");
+        dgemm_wait(r3);
+        dgemm_wait(r1);         // 已完成的请求可以再 wait
+        dgemm_release(r1);
+        dgemm_release(r3);
+        while (atomic_load(&only_cb) == 0) {
+            sched_yield();
+        }
+
+        // 空批量立即完成
+        r4 = dgemm_submit_batch_pool(pool, NULL, 0, count_done, &g_callbacks);
+        CHECK(r4 != NULL, "空批量返回 NULL");
+        dgemm_wait(r4);
+        CHECK(dgemm_poll(r4) == 1, "空批量未完成");
+        dgemm_release(r4);
+        CHECK(atomic_load(&g_callbacks) == before + 2, "空批量的回调应执行一次");
+
+        // 默认线程池上的单个乘法
+        r4 = dgemm_submit(&g[0], NULL, NULL);
+        dgemm_wait(r4);
+        dgemm_release(r4);
+        gemm_ref(ref[0].m, ref[0].n, ref[0].p, ref[0].a, ref[0].lda, ref[0].b, ref[0].ldb,
+                 ref[0].c, ref[0].ldc);
+
+        for (i = 0; i < 6; i++) {
+            CHECK(memcmp(g[i].c, ref[i].c, g[i].m * g[i].ldc * sizeof(double)) == 0,
+                  "异步第 %d 个乘法结果错误（第 %d 轮）", i, round);
+        }
+        batch_free_c(ref, 6);
+        batch_free(g, 6);
+    }
+    dgemm_pool_destroy(pool);
+}
+
+/* ========== pool ========== */
+
+static pthread_t g_submitter;
+static atomic_int g_gate, g_inline, g_ran;
+
+static void gated_task(void *arg, size_t index) {
+    (void)arg;
+    (void)index;
+    if (pthread_equal(pthread_self(), g_submitter)) {
+        atomic_fetch_add(&g_inline, 1);
+    }
+    while (!atomic_load(&g_gate)) {
+        usleep(100);
+    }
+    atomic_fetch_add(&g_ran, 1);
+}
+
+static void test_pool(void) {
+    // 每个队列 256 个区间，1500 次提交（每次 2 段）足以填满 2 个工作线程的队列
+    const int jobs = 1500;
+    m_blas_pool *pool = dgemm_pool_create(3, 0);
+    atomic_int done = 0;
+    int j;
+
+    g_submitter = pthread_self();
+    atomic_store(&g_gate, 0);
+    atomic_store(&g_inline, 0);
+    atomic_store(&g_ran, 0);
+    for (j = 0; j < jobs; j++) {
+        CHECK(dgemm_pool_submit(pool, 4, gated_task, NULL, j % 2 ? count_done : NULL, &done) == 0,
+              "dgemm_pool_submit 失败");
+    }
+    // 任务在 gate 打开前都阻塞，提交者若执行了任何一个，上面的循环不会返回
+    CHECK(atomic_load(&g_inline) == 0, "异步任务在提交者中执行了 %d 次", atomic_load(&g_inline));
+    atomic_store(&g_gate, 1);
+    while (atomic_load(&g_ran) < jobs * 4 || atomic_load(&done) < jobs / 2) {
+        usleep(1000);
+    }
+    dgemm_pool_destroy(pool);
+}
+
+/* ========== topology ========== */
+
+static char g_fake_root[64];
+
+static void fake_write(const char *content, const char *fmt, ...) {
+    char path[256], *slash;
+    va_list ap;
+    FILE *fp;
+
+    va_start(ap, fmt);
+    vsnprintf(path, sizeof(path), fmt, ap);
+    va_end(ap);
+    for (slash = strchr(path + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(path, 0755);
+        *slash = '/';
+    }
+    fp = fopen(path, "w");
+    if (fp) {
+        fprintf(fp, "%s\n", content);
+        fclose(fp);
+    }
+}
+
+static int fake_remove(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+// rk3399：cpu0-3 为 A53（共享 512KB L2，容量 485），cpu4-5 为 A72（共享 1MB L2，容量 1024）
+static int fake_rk3399(void) {
+    unsigned int cpu;
+
+    strcpy(g_fake_root, "/tmp/dgemm_sysfs_XXXXXX");
+    if (!mkdtemp(g_fake_root)) {
+        return -1;
+    }
+    fake_write("0-5", "%s/online", g_fake_root);
+    for (cpu = 0; cpu < 6; cpu++) {
+        int big = cpu >= 4;
+
+        fake_write(big ? "1024" : "485", "%s/cpu%u/cpu_capacity", g_fake_root, cpu);
+        fake_write("1", "%s/cpu%u/cache/index0/level", g_fake_root, cpu);
+        fake_write("Data", "%s/cpu%u/cache/index0/type", g_fake_root, cpu);
+        fake_write("32K", "%s/cpu%u/cache/index0/size", g_fake_root, cpu);
+        fake_write("1", "%s/cpu%u/cache/index1/level", g_fake_root, cpu);
+        fake_write("Instruction", "%s/cpu%u/cache/index1/type", g_fake_root, cpu);
+        fake_write("2", "%s/cpu%u/cache/index2/level", g_fake_root, cpu);
+        fake_write("Unified", "%s/cpu%u/cache/index2/type", g_fake_root, cpu);
+        fake_write(big ? "1024K" : "512K", "%s/cpu%u/cache/index2/size", g_fake_root, cpu);
+        fake_write(big ? "4-5" : "0-3", "%s/cpu%u/cache/index2/shared_cpu_list", g_fake_root, cpu);
+    }
+    return 0;
+}
+
+// 必须在其他测试之前运行：拓扑在第一次使用时读取并缓存
+static void test_topology(void) {
+    static const size_t shapes[][3] = {
+        { 256, 256, 256 }, { 120, 128, 96 }, { 8, 1000, 64 }, { 520, 600, 300 }, { 16, 16, 4096 }
+    };
+    const m_blas_topology *topo;
+    unsigned int i, split;
+
+    if (fake_rk3399() != 0) {
+        CHECK(0, "无法创建假的 sysfs");
+        return;
+    }
+    setenv("DGEMM_SYSFS_CPU", g_fake_root, 1);
+    topo = dgemm_cpu_topology();
+
+    CHECK(topo->ncpus == 6 && topo->nclusters == 2 && !topo->uniform,
+          "rk3399 拓扑：ncpus %u nclusters %u uniform %u", topo->ncpus, topo->nclusters, topo->uniform);
+    for (i = 0; i < topo->ncpus && i < 6; i++) {
+        unsigned int cpu = i < 2 ? 4 + i : i - 2;   // 大核在前，同簇相邻
+
+        CHECK(topo->cpu[i] == cpu && topo->cluster[i] == (i < 2 ? 0u : 1u) &&
+              topo->capacity[i] == (i < 2 ? 1024u : 485u),
+              "第 %u 位：cpu%u 簇 %u 容量 %u", i, topo->cpu[i], topo->cluster[i], topo->capacity[i]);
+    }
+
+    for (i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+        size_t m = shapes[i][0], n = shapes[i][1], p = shapes[i][2], k;
+        unsigned int seed = i + 11;
+        double *a = malloc(m * p * sizeof(double)), *b = malloc(p * n * sizeof(double));
+        double *c = malloc(m * n * sizeof(double)), *ref = calloc(m * n, sizeof(double));
+
+        fill_int(a, m * p, &seed, 4);
+        fill_int(b, p * n, &seed, 3);
+        gemm_ref(m, n, p, a, p, b, n, ref, n);
+        for (split = M_BLAS_SPLIT_AUTO; split <= M_BLAS_SPLIT_K; split++) {
+            m_blas_threading thr = { 6, split, 0, 0 };
+
+            for (k = 0; k < m * n; k++) {
+                c[k] = 0;
+            }
+            dgemm_neon_fast_threads_64(m, n, p, a, p, b, n, c, n, g_sa, g_sb, &thr);
+            CHECK(memcmp(c, ref, m * n * sizeof(double)) == 0,
+                  "rk3399 上 %zux%zux%zu 划分 %u 结果错误", m, n, p, split);
+        }
+        free(a);
+        free(b);
+        free(c);
+        free(ref);
+    }
+
+    unsetenv("DGEMM_SYSFS_CPU");
+    nftw(g_fake_root, fake_remove, 8, FTW_DEPTH | FTW_PHYS);
+}
+
+/* ========== team ========== */
+
+// OpenMP 实际启动的线程少于计划的线程数时（OMP_DYNAMIC、OMP_THREAD_LIMIT、嵌套），
+// 行、列与 B / A 的合作打包都按实际的线程数划分。max_active_levels 为 0 时
+// 每个并行区域只有一个线程；dynamic 打开时线程数由运行时决定
+static void test_team(void) {
+    static const size_t shapes[][3] = {
+        { 256, 256, 256 }, { 120, 128, 96 }, { 8, 1000, 64 }, { 520, 600, 300 }, { 200, 64, 40 },
+        { 16, 16, 4096 }, { 32, 16, 2048 }
+    };
+    static const m_blas_threading plans[] = {
+        { 4, M_BLAS_SPLIT_AUTO, 0, 0 }, { 4, M_BLAS_SPLIT_M, 0, 0 }, { 4, M_BLAS_SPLIT_N, 0, 0 },
+        { 4, M_BLAS_SPLIT_K, 0, 0 }, { 4, M_BLAS_SPLIT_K, 0, M_BLAS_THREAD_DETERMINISTIC },
+        { 4, M_BLAS_SPLIT_K, 0, M_BLAS_THREAD_REPRODUCIBLE }
+    };
+    int levels = omp_get_max_active_levels(), dynamic = omp_get_dynamic(), mode;
+    unsigned int i, j;
+
+    for (mode = 0; mode < 2; mode++) {
+        if (mode == 0) {
+            omp_set_max_active_levels(0);
+        } else {
+            omp_set_max_active_levels(levels);
+            omp_set_dynamic(1);
+        }
+        for (i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+            size_t m = shapes[i][0], n = shapes[i][1], p = shapes[i][2], k;
+            unsigned int seed = i + 17;
+            double *a = malloc(m * p * sizeof(double)), *b = malloc(p * n * sizeof(double));
+            double *c = malloc(m * n * sizeof(double)), *ref = calloc(m * n, sizeof(double));
+
+            fill_int(a, m * p, &seed, 4);
+            fill_int(b, p * n, &seed, 3);
+            gemm_ref(m, n, p, a, p, b, n, ref, n);
+            for (j = 0; j < sizeof(plans) / sizeof(plans[0]); j++) {
+                m_blas_threading thr = plans[j];
+
+                for (k = 0; k < m * n; k++) {
+                    c[k] = 0;
+                }
+                dgemm_neon_fast_threads_64(m, n, p, a, p, b, n, c, n, g_sa, g_sb, &thr);
+                CHECK(memcmp(c, ref, m * n * sizeof(double)) == 0,
+                      "%s 时 %zux%zux%zu 划分 %u 标志 %u 结果错误", mode == 0 ? "单线程区域" : "dynamic",
+                      m, n, p, thr.split, thr.flags);
+            }
+            free(a);
+            free(b);
+            free(c);
+            free(ref);
+        }
+    }
+    omp_set_max_active_levels(levels);
+    omp_set_dynamic(dynamic);
+}
+
+/* ========== direct ========== */
+
+// dgemm_neon_direct 的线程数来自 thr、配置的 threads 与 thread_min_flops，结果与单线程逐位相同
+static void test_direct(void) {
+    static const size_t shapes[][3] = { { 64, 64, 64 }, { 200, 96, 40 }, { 36, 1000, 20 }, { 4, 4, 3 } };
+    static const unsigned int threads[] = { 0, 1, 2, 3, 8, 64 };
+    m_blas_config saved = *dgemm_config_get(), cfg = saved;
+    size_t i, j, k;
+
+    for (i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+        size_t m = shapes[i][0], n = shapes[i][1], p = shapes[i][2];
+        unsigned int seed = (unsigned int)i + 23;
+        double *a = malloc(m * p * sizeof(double)), *b = malloc(p * n * sizeof(double));
+        double *c = malloc(m * n * sizeof(double)), *ref = calloc(m * n, sizeof(double));
+
+        fill_int(a, m * p, &seed, 4);
+        fill_int(b, p * n, &seed, 3);
+        gemm_ref(m, n, p, a, p, b, n, ref, n);
+        for (j = 0; j < sizeof(threads) / sizeof(threads[0]); j++) {
+            m_blas_threading thr = { threads[j], M_BLAS_SPLIT_AUTO, 0, 0 };
+
+            // threads 为 0 时由配置决定：每个线程至少 1 次浮点运算
+            cfg.threads = threads[j] ? 0 : 4;
+            cfg.thread_min_flops = 1;
+            dgemm_config_set(&cfg);
+            for (k = 0; k < m * n; k++) {
+                c[k] = 0;
+            }
+            dgemm_neon_direct_threads_64(m, n, p, a, p, b, n, c, n, g_sa, g_sb, threads[j] ? &thr : NULL);
+            CHECK(memcmp(c, ref, m * n * sizeof(double)) == 0,
+                  "direct %zux%zux%zu %u 个线程结果错误", m, n, p, threads[j]);
+        }
+        free(a);
+        free(b);
+        free(c);
+        free(ref);
+    }
+    dgemm_config_set(&saved);
+}
+
+/* ========== 入口 ========== */
+
+typedef struct {
+    const char *name;
+    void (*fn)(void);
+} check_case;
+
+// topology 必须排在第一个
+static const check_case cases[] = {
+    { "topology",     test_topology },
+    { "shapes",       test_shapes },
+    { "config",       test_config },
+    { "batch",        test_batch },
+    { "splitk",       test_splitk },
+    { "reproducible", test_reproducible },
+    { "async",        test_async },
+    { "pool",         test_pool },
+    { "team",         test_team },
+    { "direct",       test_direct },
+};
+#define NUM_CASES (sizeof(cases) / sizeof(cases[0]))
+
+int main(int argc, char **argv) {
+    size_t i;
+    int j;
+
+    g_sa = aligned_alloc(64, M_BLAS_PACK_SA_SIZE * sizeof(double));
+    g_sb = aligned_alloc(64, M_BLAS_PACK_SB_SIZE * sizeof(double));
+    if (!g_sa || !g_sb) {
+        printf("内存不足\n");
+        return 1;
+    }
+
+    for (i = 0; i < NUM_CASES; i++) {
+        int selected = argc < 2;
+        int before = g_failures;
+
+        for (j = 1; j < argc; j++) {
+            selected |= strcmp(argv[j], cases[i].name) == 0;
+        }
+        if (!selected) {
+            continue;
+        }
+        printf("%-14s ", cases[i].name);
+        fflush(stdout);
+        cases[i].fn();
+        printf("%s\n", g_failures == before ? "通过" : "失败");
+    }
+
+    free(g_sa);
+    free(g_sb);
+    printf("%s\n", g_failures ? "有测试失败" : "全部通过");
+    return g_failures ? 1 : 0;
+}
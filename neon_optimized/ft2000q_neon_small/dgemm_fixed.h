@@ -0,0 +1,225 @@
+/*
+ * 编译期固定形状的小矩阵 DGEMM（纯头文件）
+ * 每个形状由 DGEMM_FIXED_DEFINE(M, N, P) 实例化为一个内联函数
+ */
+
+#ifndef DGEMM_FIXED_H
+#define DGEMM_FIXED_H
+
+#include <stddef.h>
+
+/**
+ * ============================================================================
+ * 固定形状 DGEMM：C(MxN) += A(MxP) * B(PxN)，行优先
+ * ============================================================================
+ *
+ * JIT（dgemm_jit.c）之外的另一条路：把 m/n/p 做成编译期常量，
+ * 让编译器完成展开和寄存器分配：
+ *
+ * 1. dgemm_fixed_run 强制内联，M/N/P 以常量传入，所有循环边界都是常量
+ * 2. mr/nr 循环完全展开，C 块（最多 FIXED_TILE_M x FIXED_TILE_N）
+ *    的累加器数组被标量替换为向量寄存器，整个 k 循环内不写回内存
+ * 3. k 循环按 FIXED_KC 分块，并用 GCC unroll 提示展开 FIXED_UNROLL_K 次
+ *    （编译器可按代码体积自行取舍）
+ * 4. 不打包，直接在 A/B 上计算；M/N 的余数块也是编译期确定的
+ *
+ * 与 kernel_2x4_tiny 相比：没有逐块的函数调用，也没有运行时的 p 循环判断。
+ * 注意 always_inline 在 -O0 下同样生效，但展开和寄存器提升需要 -O1 以上。
+ *
+ * 后端：NEON（float64x2_t）优先，否则 AVX2+FMA（__m256d）；
+ * 都没有时 DGEMM_FIXED_AVAILABLE 为 0，dgemm_fixed_lookup 总是返回 NULL。
+ * ============================================================================
+ */
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+
+#define DGEMM_FIXED_AVAILABLE (1)
+#define FIXED_VLEN   (2)            // 每个向量的 double 数
+#define FIXED_TILE_M (4)            // 4x8 块：16 个累加器 + 4 个 B 向量
+#define FIXED_TILE_N (8)
+
+typedef float64x2_t fixed_vec;
+#define fixed_load(p)          vld1q_f64(p)
+#define fixed_store(p, v)      vst1q_f64(p, v)
+#define fixed_fma(acc, bv, s)  vfmaq_n_f64(acc, bv, s)
+
+#elif defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+#define DGEMM_FIXED_AVAILABLE (1)
+#define FIXED_VLEN   (4)
+#define FIXED_TILE_M (6)            // 6x8 块：12 个累加器 + 2 个 B + 1 个广播
+#define FIXED_TILE_N (8)
+
+typedef __m256d fixed_vec;
+#define fixed_load(p)          _mm256_loadu_pd(p)
+#define fixed_store(p, v)      _mm256_storeu_pd(p, v)
+#define fixed_fma(acc, bv, s)  _mm256_fmadd_pd(bv, _mm256_set1_pd(s), acc)
+
+#else
+#define DGEMM_FIXED_AVAILABLE (0)
+#endif
+
+#define FIXED_KC       (128)        // k 方向分块，B 面板留在 L2
+#define FIXED_UNROLL_K (8)          // k 循环展开提示
+
+#define FIXED_STR(x) #x
+#define FIXED_UNROLL(n) _Pragma(FIXED_STR(GCC unroll n))
+
+#define FIXED_ALWAYS_INLINE static inline __attribute__((always_inline))
+
+// 固定形状内核：步长运行时传入，形状编译期固定
+typedef void (*dgemm_fixed_fn)(const double *a, unsigned int lda,
+                               const double *b, unsigned int ldb,
+                               double *c, unsigned int ldc);
+
+#if DGEMM_FIXED_AVAILABLE
+
+/*
+ * 一个 mr x nr 块在 k ∈ [0, kc) 上的累加；mr/nr/kc 在内联后都是常量
+ * nr 的向量部分在寄存器中计算，不足一个向量的列（nr % FIXED_VLEN）走标量
+ */
+FIXED_ALWAYS_INLINE void dgemm_fixed_tile(const unsigned int mr, const unsigned int nr,
+                                          const unsigned int kc,
+                                          const double *a, unsigned int lda,
+                                          const double *b, unsigned int ldb,
+                                          double *c, unsigned int ldc) {
+    const unsigned int nv = nr / FIXED_VLEN;
+    fixed_vec acc[FIXED_TILE_M][FIXED_TILE_N / FIXED_VLEN];
+    fixed_vec bv[FIXED_TILE_N / FIXED_VLEN];
+    unsigned int i, j, k;
+
+    FIXED_UNROLL(8)
+    for (i = 0; i < mr; i++) {
+        FIXED_UNROLL(8)
+        for (j = 0; j < nv; j++) {
+            acc[i][j] = fixed_load(&c[i * ldc + j * FIXED_VLEN]);
+        }
+    }
+
+    FIXED_UNROLL(FIXED_UNROLL_K)
+    for (k = 0; k < kc; k++) {
+        FIXED_UNROLL(8)
+        for (j = 0; j < nv; j++) {
+            bv[j] = fixed_load(&b[k * ldb + j * FIXED_VLEN]);
+        }
+        FIXED_UNROLL(8)
+        for (i = 0; i < mr; i++) {
+            const double s = a[i * lda + k];
+            FIXED_UNROLL(8)
+            for (j = 0; j < nv; j++) {
+                acc[i][j] = fixed_fma(acc[i][j], bv[j], s);
+            }
+        }
+    }
+
+    FIXED_UNROLL(8)
+    for (i = 0; i < mr; i++) {
+        FIXED_UNROLL(8)
+        for (j = 0; j < nv; j++) {
+            fixed_store(&c[i * ldc + j * FIXED_VLEN], acc[i][j]);
+        }
+    }
+
+    // 余数列（仅在 N 不是 FIXED_VLEN 的倍数时存在）
+    for (j = nv * FIXED_VLEN; j < nr; j++) {
+        for (i = 0; i < mr; i++) {
+            double sum = c[i * ldc + j];
+            for (k = 0; k < kc; k++) {
+                sum += a[i * lda + k] * b[k * ldb + j];
+            }
+            c[i * ldc + j] = sum;
+        }
+    }
+}
+
+// 分块驱动：k 分块在外，保证同一 C 块在 k 块内只读写一次
+FIXED_ALWAYS_INLINE void dgemm_fixed_run(const unsigned int M, const unsigned int N,
+                                         const unsigned int P,
+                                         const double *a, unsigned int lda,
+                                         const double *b, unsigned int ldb,
+                                         double *c, unsigned int ldc) {
+    unsigned int ks, i, j;
+
+    for (ks = 0; ks < P; ks += FIXED_KC) {
+        const unsigned int kc = P - ks < FIXED_KC ? P - ks : FIXED_KC;
+
+        for (i = 0; i + FIXED_TILE_M <= M; i += FIXED_TILE_M) {
+            for (j = 0; j + FIXED_TILE_N <= N; j += FIXED_TILE_N) {
+                dgemm_fixed_tile(FIXED_TILE_M, FIXED_TILE_N, kc, a + i * lda + ks, lda,
+                                 b + (size_t)ks * ldb + j, ldb, c + i * ldc + j, ldc);
+            }
+            if (N % FIXED_TILE_N) {
+                dgemm_fixed_tile(FIXED_TILE_M, N % FIXED_TILE_N, kc, a + i * lda + ks, lda,
+                                 b + (size_t)ks * ldb + j, ldb, c + i * ldc + j, ldc);
+            }
+        }
+        if (M % FIXED_TILE_M) {
+            for (j = 0; j + FIXED_TILE_N <= N; j += FIXED_TILE_N) {
+                dgemm_fixed_tile(M % FIXED_TILE_M, FIXED_TILE_N, kc, a + i * lda + ks, lda,
+                                 b + (size_t)ks * ldb + j, ldb, c + i * ldc + j, ldc);
+            }
+            if (N % FIXED_TILE_N) {
+                dgemm_fixed_tile(M % FIXED_TILE_M, N % FIXED_TILE_N, kc, a + i * lda + ks, lda,
+                                 b + (size_t)ks * ldb + j, ldb, c + i * ldc + j, ldc);
+            }
+        }
+    }
+}
+
+// 实例化：定义 dgemm_fixed_MxNxP
+#define DGEMM_FIXED_DEFINE(M, N, P)                                                 \
+    static inline void dgemm_fixed_##M##x##N##x##P(const double *a, unsigned int lda, \
+                                                   const double *b, unsigned int ldb, \
+                                                   double *c, unsigned int ldc) {     \
+        dgemm_fixed_run(M, N, P, a, lda, b, ldb, c, ldc);                           \
+    }
+
+/*
+ * 基准测试的 9 个形状，按 (m, n, p) 给出
+ * 注意 benchmark.c 的测试用例写作 {M, P, N}
+ */
+#define DGEMM_FIXED_SHAPES(X)   \
+    X(16, 16, 16)               \
+    X(24, 24, 24)               \
+    X(24, 16, 32)               \
+    X(96, 96, 96)               \
+    X(128, 128, 128)            \
+    X(120, 96, 128)             \
+    X(240, 240, 240)            \
+    X(256, 256, 256)            \
+    X(256, 248, 240)
+
+DGEMM_FIXED_SHAPES(DGEMM_FIXED_DEFINE)
+
+#endif // DGEMM_FIXED_AVAILABLE
+
+typedef struct {
+    unsigned int m, n, p;
+    dgemm_fixed_fn fn;
+} dgemm_fixed_entry;
+
+// 形状 -> 实例的静态分发表
+#define DGEMM_FIXED_ENTRY(M, N, P) { M, N, P, dgemm_fixed_##M##x##N##x##P },
+
+static const dgemm_fixed_entry dgemm_fixed_table[] = {
+#if DGEMM_FIXED_AVAILABLE
+    DGEMM_FIXED_SHAPES(DGEMM_FIXED_ENTRY)
+#endif
+    { 0, 0, 0, NULL }
+};
+
+// 查找形状对应的实例；没有时返回 NULL
+static inline dgemm_fixed_fn dgemm_fixed_lookup(unsigned int m, unsigned int n, unsigned int p) {
+    const dgemm_fixed_entry *e;
+
+    for (e = dgemm_fixed_table; e->fn; e++) {
+        if (e->m == m && e->n == n && e->p == p) {
+            return e->fn;
+        }
+    }
+    return NULL;
+}
+
+#endif // DGEMM_FIXED_H
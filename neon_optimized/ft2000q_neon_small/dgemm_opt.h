@@ -1,6 +1,6 @@
 /*
  * DGEMM 优化版本函数声明
- * 独立头文件，无需其他依赖
+ * 库函数声明在上级目录的 blas_dgemm.h 中
  */
 
 #ifndef DGEMM_OPT_H
@@ -14,35 +14,66 @@ typedef void (*dgemm_func_ptr)(unsigned int m, unsigned int n, unsigned int p,
                                double *b, unsigned int ldb,
                                double *c, unsigned int ldc);
 
-// dgemm_neon_small 原始函数（需要额外缓冲区）
-void dgemm_neon_small(unsigned int m, unsigned int n, unsigned int p, 
-                      double *a, unsigned int lda,
-                      double *b, unsigned int ldb,
-                      double *c, unsigned int ldc,
-                      double *sa, double *sb);
-
-// dgemm_neon_small 的包装函数（符合标准接口）
-static inline void dgemm_neon_small_wrapper(unsigned int m, unsigned int n, unsigned int p, 
-                                            double *a, unsigned int lda,
-                                            double *b, unsigned int ldb,
-                                            double *c, unsigned int ldc) {
-    // 为 NEON 版本分配必要的打包缓冲区
-    #define GEMM_M_WRAPPER (2048)
-    #define GEMM_P_WRAPPER (128)
-    
-    size_t sa_size = GEMM_M_WRAPPER * GEMM_P_WRAPPER * sizeof(double);
-    size_t sb_size = GEMM_P_WRAPPER * n * sizeof(double);
-    
-    double *sa = (double*)malloc(sa_size);
-    double *sb = (double*)malloc(sb_size);
+// 库中各实现的声明（dgemm_neon / dgemm_neon_fast / dgemm_neon_small / dgemm_neon_auto / dgemm_neon_direct）
+#include "blas_dgemm.h"
+
+// 需要额外打包缓冲区的库函数
+typedef void (*dgemm_packed_func_ptr)(unsigned int m, unsigned int n, unsigned int p,
+                                      double *a, unsigned int lda,
+                                      double *b, unsigned int ldb,
+                                      double *c, unsigned int ldc,
+                                      double *sa, double *sb);
+
+// 按库要求的大小分配打包缓冲区后调用（各实现使用相同的缓冲区，计时可比）
+static inline void dgemm_call_packed(dgemm_packed_func_ptr func,
+                                     unsigned int m, unsigned int n, unsigned int p,
+                                     double *a, unsigned int lda,
+                                     double *b, unsigned int ldb,
+                                     double *c, unsigned int ldc) {
+    double *sa = (double*)malloc(M_BLAS_PACK_SA_SIZE * sizeof(double));
+    double *sb = (double*)malloc(M_BLAS_PACK_SB_SIZE * sizeof(double));
     
     if (sa && sb) {
-        dgemm_neon_small(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
+        func(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);
     }
     
     if (sa) free(sa);
     if (sb) free(sb);
 }
 
+// 包装函数（符合标准接口）
+#define DGEMM_PACKED_WRAPPER(name)                                                   \
+    static inline void name##_wrapper(unsigned int m, unsigned int n, unsigned int p, \
+                                      double *a, unsigned int lda,                   \
+                                      double *b, unsigned int ldb,                   \
+                                      double *c, unsigned int ldc) {                 \
+        dgemm_call_packed(name, m, n, p, a, lda, b, ldb, c, ldc);                    \
+    }
+
+DGEMM_PACKED_WRAPPER(dgemm_neon)
+DGEMM_PACKED_WRAPPER(dgemm_neon_fast)
+DGEMM_PACKED_WRAPPER(dgemm_neon_small)
+DGEMM_PACKED_WRAPPER(dgemm_neon_auto)
+DGEMM_PACKED_WRAPPER(dgemm_neon_direct)
+
+// 编译期固定形状的内核（dgemm_fixed.h），未实例化的形状回退到 dgemm_neon_small
+#include "dgemm_fixed.h"
+
+static inline void dgemm_fixed_wrapper(unsigned int m, unsigned int n, unsigned int p,
+                                       double *a, unsigned int lda,
+                                       double *b, unsigned int ldb,
+                                       double *c, unsigned int ldc) {
+    dgemm_fixed_fn fn = dgemm_fixed_lookup(m, n, p);
+
+    if (fn) {
+        fn(a, lda, b, ldb, c, ldc);
+    } else {
+        dgemm_neon_small_wrapper(m, n, p, a, lda, b, ldb, c, ldc);
+    }
+}
+
+// gen_kernels.py 生成的内核（由 Makefile 生成，提供 DGEMM_GEN_OPT_FUNCS）
+#include "dgemm_gen.h"
+
 #endif // DGEMM_OPT_H
 
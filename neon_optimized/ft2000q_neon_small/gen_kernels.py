@@ -0,0 +1,537 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+DGEMM 微内核生成器
+从同一个模板生成任意 MRxNR、任意 k 展开因子的计算内核、打包函数和驱动
+
+用法:
+    python3 gen_kernels.py [--backend asm|intrin] [--prefetch 字节] [--out 前缀] 形状...
+
+形状写作 MRxNR 或 MRxNRuU，例如 4x8u4、8x4u2、6x8
+  - MR、NR 必须是偶数（按 2 个 double 一个向量寄存器组织）
+  - C 块、A/B 操作数需要装得进 32 个 NEON 寄存器
+  - 寄存器足够放两组 A/B 且 U 为偶数时，自动生成软件流水（双缓冲）版本
+
+输出:
+    <前缀>.h  函数声明、缓冲区大小、包装函数、基准测试注册表 DGEMM_GEN_OPT_FUNCS
+    <前缀>.c  内核、打包函数、分块驱动
+"""
+
+import argparse
+import re
+import sys
+
+NUM_VREGS = 32
+
+# 分块大小，与 dgemm_neon_fast 的 GEMM_N / GEMM_P 一致
+GEN_KC = 128
+GEN_NC = 256
+GEN_MC = 128
+
+
+class Shape:
+    """一个待生成的内核形状"""
+
+    def __init__(self, mr, nr, u):
+        self.mr = mr
+        self.nr = nr
+        self.u = u
+        self.a_regs = mr // 2
+        self.b_regs = nr // 2
+        self.c_regs = mr * nr // 2
+        set_regs = self.a_regs + self.b_regs
+        self.pipelined = (u % 2 == 0 and
+                          self.c_regs + 2 * set_regs <= NUM_VREGS)
+
+    @property
+    def name(self):
+        return "%dx%d_u%d" % (self.mr, self.nr, self.u)
+
+
+def parse_shape(text):
+    """解析 MRxNR[uU]"""
+    m = re.fullmatch(r"(\d+)x(\d+)(?:u(\d+))?", text)
+    if not m:
+        raise ValueError("无法解析形状: %s" % text)
+    mr, nr = int(m.group(1)), int(m.group(2))
+    u = int(m.group(3) or 4)
+    if mr < 2 or nr < 2 or mr % 2 or nr % 2:
+        raise ValueError("%s: MR 和 NR 必须是不小于 2 的偶数" % text)
+    if mr > 8:
+        raise ValueError("%s: MR 最大为 8（C 行地址寄存器 x9-x15）" % text)
+    if u < 1:
+        raise ValueError("%s: 展开因子至少为 1" % text)
+    shape = Shape(mr, nr, u)
+    if shape.c_regs + shape.a_regs + shape.b_regs > NUM_VREGS:
+        raise ValueError("%s: 需要 %d 个向量寄存器，超过 %d 个" %
+                         (text, shape.c_regs + shape.a_regs + shape.b_regs,
+                          NUM_VREGS))
+    return shape
+
+
+# ============================================================================
+# 汇编后端
+# ============================================================================
+
+def reg_sets(shape):
+    """分配寄存器：C 在最前面，随后是一组或两组 A/B（组内编号连续）"""
+    sets = []
+    base = shape.c_regs
+    for _ in range(2 if shape.pipelined else 1):
+        a = list(range(base, base + shape.a_regs))
+        base += shape.a_regs
+        b = list(range(base, base + shape.b_regs))
+        base += shape.b_regs
+        sets.append((a, b))
+    return sets, base
+
+
+def c_reg(shape, r, j):
+    return r * shape.b_regs + j
+
+
+def row_ptr(r):
+    return "%2" if r == 0 else "x%d" % (8 + r)
+
+
+def asm_line(text, comment=None):
+    line = '                "%s\\n"' % (text + " ").ljust(36)
+    if comment:
+        line += "  // " + comment
+    return line
+
+
+def ld1_groups(regs, ptr, comment):
+    """ld1 一次最多 4 个连续寄存器"""
+    out = []
+    for i in range(0, len(regs), 4):
+        chunk = regs[i:i + 4]
+        lst = ", ".join("v%d.2d" % r for r in chunk)
+        out.append(asm_line("   ld1 {%s}, [%s], #%d" % (lst, ptr, 16 * len(chunk)),
+                            comment if i == 0 else None))
+    return out
+
+
+def asm_step(shape, cur, nxt):
+    """一个 k 步：用 cur 组计算，同时（若 nxt 非空）装入下一步到 nxt 组"""
+    a, b = cur
+    groups = []
+    for j in range(shape.b_regs):
+        g = []
+        for r in range(shape.mr):
+            cr = "v%d.2d," % c_reg(shape, r, j)
+            g.append(asm_line("   fmla %-7s v%d.2d, v%d.d[%d]" %
+                              (cr, b[j], a[r // 2], r % 2)))
+        groups.append(g)
+    loads = []
+    if nxt is not None:
+        loads = (ld1_groups(nxt[0], "%0", "下一步 A") +
+                 ld1_groups(nxt[1], "%1", "下一步 B"))
+    out = []
+    # 把装载均匀地插到各组 FMLA 之前
+    slots = {}
+    for i, ld in enumerate(loads):
+        slots.setdefault(i * len(groups) // len(loads), []).append(ld)
+    for gi, g in enumerate(groups):
+        out += slots.get(gi, [])
+        out += g
+    return out
+
+
+def gen_asm_kernel(shape, prefetch):
+    sets, _ = reg_sets(shape)
+    lines = []
+    lines.append(asm_line("mov  x8,   %4", "循环计数器 = kc/U"))
+    lines.append("")
+    lines.append("                // 加载 C（%dx%d 块）" % (shape.mr, shape.nr))
+    for r in range(shape.mr):
+        if r > 0:
+            lines.append(asm_line("add  %-4s %s, %%3" % (row_ptr(r) + ",", row_ptr(r - 1)),
+                                  "C[%d]" % r))
+        for j in range(shape.b_regs):
+            off = "" if j == 0 else ", #%d" % (16 * j)
+            lines.append(asm_line("ldr  %-4s [%s%s]" % ("q%d," % c_reg(shape, r, j), row_ptr(r), off)))
+    lines.append("")
+
+    def prefetch_lines():
+        if prefetch <= 0:
+            return []
+        return [asm_line("   prfm pldl1keep, [%%0, #%d]" % prefetch),
+                asm_line("   prfm pldl1keep, [%%1, #%d]" % prefetch)]
+
+    if shape.pipelined:
+        lines.append("                // 序言：预先装入第 0 步的 A/B")
+        lines += ld1_groups(sets[0][0], "%0", None)
+        lines += ld1_groups(sets[0][1], "%1", None)
+        lines.append(asm_line("subs x8,   x8,  #1"))
+        lines.append(asm_line("beq  tail_gen%="))
+        lines.append("")
+        lines.append(asm_line("loop_gen%=:"))
+        lines += prefetch_lines()
+        lines.append(asm_line("   subs x8, x8, #1"))
+        for k in range(shape.u):
+            lines.append("")
+            lines.append("                // K=%d" % k)
+            lines += asm_step(shape, sets[k % 2], sets[(k + 1) % 2])
+        lines.append(asm_line("   bne loop_gen%="))
+        lines.append("")
+        lines.append("                // 尾声：最后一步不再装载")
+        lines.append(asm_line("tail_gen%=:"))
+        for k in range(shape.u):
+            lines.append("")
+            lines.append("                // K=%d" % k)
+            nxt = sets[(k + 1) % 2] if k + 1 < shape.u else None
+            lines += asm_step(shape, sets[k % 2], nxt)
+    else:
+        lines.append(asm_line("loop_gen%=:"))
+        lines += prefetch_lines()
+        for k in range(shape.u):
+            lines.append("")
+            lines.append("                // K=%d" % k)
+            lines += ld1_groups(sets[0][0], "%0", "A")
+            lines += ld1_groups(sets[0][1], "%1", "B")
+            lines += asm_step(shape, sets[0], None)
+        lines.append(asm_line("   subs x8, x8, #1"))
+        lines.append(asm_line("   bne loop_gen%="))
+    lines.append("")
+    lines.append("                // 存储 C")
+    for r in range(shape.mr):
+        for j in range(shape.b_regs):
+            off = "" if j == 0 else ", #%d" % (16 * j)
+            lines.append(asm_line("   str %-4s [%s%s]" % ("q%d," % c_reg(shape, r, j), row_ptr(r), off)))
+
+    used_v = reg_sets(shape)[1]
+    xregs = ["x8"] + ["x%d" % (8 + r) for r in range(1, shape.mr)]
+    clob = ['"memory"', '"cc"'] + ['"%s"' % x for x in xregs]
+    vclob = ['"v%d"' % i for i in range(used_v)]
+    clob_lines = []
+    cur = "                : " + ", ".join(clob)
+    clob_lines.append(cur + ",")
+    for i in range(0, len(vclob), 8):
+        clob_lines.append("                  " + ", ".join(vclob[i:i + 8]) +
+                          ("," if i + 8 < len(vclob) else ""))
+
+    body = "\n".join(lines)
+    return '''static void kernel_gen_{name}(unsigned long kc, const double *a, const double *b,
+                             double *c, unsigned long ldc) {{
+    unsigned long ldc_offset = ldc * sizeof(double);
+    unsigned long k_iter = kc / {u};
+
+    asm volatile(
+{body}
+                : "=r"(a), "=r"(b), "=r"(c), "=r"(ldc_offset), "=r"(k_iter)
+                : "0"(a), "1"(b), "2"(c), "3"(ldc_offset), "4"(k_iter)
+{clob}
+    );
+}}
+'''.format(name=shape.name, u=shape.u, body=body, clob="\n".join(clob_lines))
+
+
+# ============================================================================
+# intrinsics 后端（便于在高优化级别下交给编译器调度）
+# ============================================================================
+
+def gen_intrin_kernel(shape):
+    mr, nb = shape.mr, shape.b_regs
+    L = []
+    for r in range(mr):
+        for j in range(nb):
+            L.append("    float64x2_t c%d_%d = vld1q_f64(c + %d * ldc + %d);" % (r, j, r, 2 * j))
+    L.append("")
+    L.append("    for (unsigned long k = 0; k < kc; k += %d) {" % shape.u)
+    for u in range(shape.u):
+        L.append("        // K=%d" % u)
+        for i in range(shape.a_regs):
+            L.append("        float64x2_t a%d_%d = vld1q_f64(a + %d);" % (u, i, u * mr + 2 * i))
+        for j in range(nb):
+            L.append("        float64x2_t b%d_%d = vld1q_f64(b + %d);" % (u, j, u * shape.nr + 2 * j))
+        for j in range(nb):
+            for r in range(mr):
+                L.append("        c%d_%d = vfmaq_laneq_f64(c%d_%d, b%d_%d, a%d_%d, %d);" %
+                         (r, j, r, j, u, j, u, r // 2, r % 2))
+    L.append("        a += %d;" % (shape.u * mr))
+    L.append("        b += %d;" % (shape.u * shape.nr))
+    L.append("    }")
+    L.append("")
+    for r in range(mr):
+        for j in range(nb):
+            L.append("    vst1q_f64(c + %d * ldc + %d, c%d_%d);" % (r, 2 * j, r, j))
+    return '''static void kernel_gen_{name}(unsigned long kc, const double *a, const double *b,
+                             double *c, unsigned long ldc) {{
+{body}
+}}
+'''.format(name=shape.name, body="\n".join(L))
+
+
+# ============================================================================
+# 打包函数与驱动（两个后端共用）
+# ============================================================================
+
+def gen_packers(mr_set, nr_set):
+    out = []
+    for mr in sorted(mr_set):
+        if mr in (4, 8):
+            # 整组用库中寄存器内转置的 packA_4_fast / packA_8_fast（dgemm_neon_fast.c）
+            full = '''            packA_{mr}_fast({mr}, kc, (double*)src, lda, to);
+            to += {mr} * kc;
+            k = kc;'''.format(mr=mr)
+        else:
+            full = '''            for (k = 0; k < kc; k++) {{
+                for (r = 0; r < {mr}; r++) {{
+                    to[r] = src[(unsigned long)r * lda + k];
+                }}
+                to += {mr};
+            }}'''.format(mr=mr)
+        out.append('''/*
+ * 打包 A：每 {mr} 行一组，组内按 k 交错存放 {mr} 个元素
+ * 不足 {mr} 行、不足 kc_pad 列的部分补 0
+ */
+static void packA_gen_{mr}(unsigned int mc, unsigned int kc, unsigned int kc_pad,
+                          const double *from, unsigned int lda, double *to) {{
+    unsigned int i, k, r;
+
+    for (i = 0; i < mc; i += {mr}) {{
+        const double *src = from + (unsigned long)i * lda;
+        unsigned int rows = mc - i < {mr} ? mc - i : {mr};
+
+        if (rows == {mr}) {{
+{full}
+        }} else {{
+            for (k = 0; k < kc; k++) {{
+                for (r = 0; r < {mr}; r++) {{
+                    to[r] = r < rows ? src[(unsigned long)r * lda + k] : 0.0;
+                }}
+                to += {mr};
+            }}
+        }}
+        for (; k < kc_pad; k++) {{
+            memset(to, 0, {mr} * sizeof(double));
+            to += {mr};
+        }}
+    }}
+}}
+'''.format(mr=mr, full=full))
+    for nr in sorted(nr_set):
+        out.append('''/*
+ * 打包 B：每 {nr} 列一组，组内按 k 顺序存放 {nr} 个元素
+ * 不足 {nr} 列、不足 kc_pad 行的部分补 0
+ */
+static void packB_gen_{nr}(unsigned int kc, unsigned int nc, unsigned int kc_pad,
+                          const double *from, unsigned int ldb, double *to) {{
+    unsigned int j, k, col;
+
+    for (j = 0; j < nc; j += {nr}) {{
+        const double *src = from + j;
+        unsigned int cols = nc - j < {nr} ? nc - j : {nr};
+
+        if (cols == {nr}) {{
+            for (k = 0; k < kc; k++) {{
+                memcpy(to, src + (unsigned long)k * ldb, {nr} * sizeof(double));
+                to += {nr};
+            }}
+        }} else {{
+            for (k = 0; k < kc; k++) {{
+                for (col = 0; col < {nr}; col++) {{
+                    to[col] = col < cols ? src[(unsigned long)k * ldb + col] : 0.0;
+                }}
+                to += {nr};
+            }}
+        }}
+        for (; k < kc_pad; k++) {{
+            memset(to, 0, {nr} * sizeof(double));
+            to += {nr};
+        }}
+    }}
+}}
+'''.format(nr=nr))
+    return "\n".join(out)
+
+
+def gen_driver(shape):
+    return '''/*
+ * C(mxn) += A(mxp) * B(pxn)，{mr}x{nr} 内核，k 展开 {u}
+ * 边缘块先在栈上的 {mr}x{nr} 临时块中计算，再写回 C
+ */
+void dgemm_gen_{name}(unsigned int m, unsigned int n, unsigned int p,
+                   double *a, unsigned int lda,
+                   double *b, unsigned int ldb,
+                   double *c, unsigned int ldc,
+                   double *sa, double *sb) {{
+    unsigned int jc, pc, ic, jr, ir, r, col;
+    unsigned int nc, kc, kc_pad, mc;
+    double tile[{mr} * {nr}];
+
+    for (jc = 0; jc < n; jc += GEN_NC) {{
+        nc = min(GEN_NC, n - jc);
+
+        for (pc = 0; pc < p; pc += GEN_KC) {{
+            kc = min(GEN_KC, p - pc);
+            kc_pad = (kc + {u} - 1) / {u} * {u};
+            packB_gen_{nr}(kc, nc, kc_pad, b + (unsigned long)pc * ldb + jc, ldb, sb);
+
+            for (ic = 0; ic < m; ic += GEN_MC) {{
+                mc = min(GEN_MC, m - ic);
+                packA_gen_{mr}(mc, kc, kc_pad, a + (unsigned long)ic * lda + pc, lda, sa);
+
+                for (jr = 0; jr < nc; jr += {nr}) {{
+                    for (ir = 0; ir < mc; ir += {mr}) {{
+                        double *cc = c + (unsigned long)(ic + ir) * ldc + jc + jr;
+                        unsigned int rows = min({mr}, mc - ir);
+                        unsigned int cols = min({nr}, nc - jr);
+
+                        if (rows == {mr} && cols == {nr}) {{
+                            kernel_gen_{name}(kc_pad, sa + ir * kc_pad, sb + jr * kc_pad,
+                                         cc, ldc);
+                            continue;
+                        }}
+
+                        // 边缘块
+                        for (r = 0; r < {mr}; r++) {{
+                            for (col = 0; col < {nr}; col++) {{
+                                tile[r * {nr} + col] = (r < rows && col < cols) ?
+                                                     cc[(unsigned long)r * ldc + col] : 0.0;
+                            }}
+                        }}
+                        kernel_gen_{name}(kc_pad, sa + ir * kc_pad, sb + jr * kc_pad,
+                                     tile, {nr});
+                        for (r = 0; r < rows; r++) {{
+                            for (col = 0; col < cols; col++) {{
+                                cc[(unsigned long)r * ldc + col] = tile[r * {nr} + col];
+                            }}
+                        }}
+                    }}
+                }}
+            }}
+        }}
+    }}
+}}
+'''.format(name=shape.name, mr=shape.mr, nr=shape.nr, u=shape.u)
+
+
+def round_up(x, n):
+    return (x + n - 1) // n * n
+
+
+def gen_header(shapes, prefix, backend):
+    guard = re.sub(r"\W", "_", prefix.split("/")[-1]).upper() + "_H"
+    L = []
+    L.append("/*")
+    L.append(" * 由 gen_kernels.py 自动生成，请勿手工修改")
+    L.append(" * 后端: %s  形状: %s" % (backend, " ".join(s.name for s in shapes)))
+    L.append(" */")
+    L.append("")
+    L.append("#ifndef %s" % guard)
+    L.append("#define %s" % guard)
+    L.append("")
+    L.append("#include <stdlib.h>")
+    L.append("")
+    L.append("#ifdef __ARM_NEON")
+    for s in shapes:
+        sa = round_up(GEN_MC, s.mr) * round_up(GEN_KC, s.u)
+        sb = round_up(GEN_KC, s.u) * round_up(GEN_NC, s.nr)
+        L.append("")
+        L.append("// %dx%d 内核，k 展开 %d%s" % (s.mr, s.nr, s.u, "，软件流水" if s.pipelined else ""))
+        L.append("#define DGEMM_GEN_%s_SA_SIZE (%d)" % (s.name.upper(), sa))
+        L.append("#define DGEMM_GEN_%s_SB_SIZE (%d)" % (s.name.upper(), sb))
+        L.append("void dgemm_gen_%s(unsigned int m, unsigned int n, unsigned int p," % s.name)
+        L.append("                   double *a, unsigned int lda,")
+        L.append("                   double *b, unsigned int ldb,")
+        L.append("                   double *c, unsigned int ldc,")
+        L.append("                   double *sa, double *sb);")
+        L.append("")
+        L.append("static inline void dgemm_gen_%s_wrapper(unsigned int m, unsigned int n, unsigned int p," % s.name)
+        L.append("                                           double *a, unsigned int lda,")
+        L.append("                                           double *b, unsigned int ldb,")
+        L.append("                                           double *c, unsigned int ldc) {")
+        L.append("    double *sa = (double*)malloc(DGEMM_GEN_%s_SA_SIZE * sizeof(double));" % s.name.upper())
+        L.append("    double *sb = (double*)malloc(DGEMM_GEN_%s_SB_SIZE * sizeof(double));" % s.name.upper())
+        L.append("")
+        L.append("    if (sa && sb) {")
+        L.append("        dgemm_gen_%s(m, n, p, a, lda, b, ldb, c, ldc, sa, sb);" % s.name)
+        L.append("    }")
+        L.append("")
+        L.append("    if (sa) free(sa);")
+        L.append("    if (sb) free(sb);")
+        L.append("}")
+    L.append("")
+    L.append("// 基准测试注册表：展开到 benchmark.c 的 opt_funcs[] 中")
+    L.append("#define DGEMM_GEN_OPT_FUNCS \\")
+    for s in shapes:
+        L.append('    {"dgemm_gen_%s", dgemm_gen_%s_wrapper}, \\' % (s.name, s.name))
+    L.append("")
+    L.append("#endif // __ARM_NEON")
+    L.append("")
+    L.append("#endif // %s" % guard)
+    L.append("")
+    return "\n".join(L)
+
+
+def gen_source(shapes, prefix, backend, prefetch):
+    L = []
+    L.append("/*")
+    L.append(" * 由 gen_kernels.py 自动生成，请勿手工修改")
+    L.append(" * 后端: %s  形状: %s" % (backend, " ".join(s.name for s in shapes)))
+    L.append(" */")
+    L.append("")
+    L.append("#ifdef __ARM_NEON")
+    L.append("#include <arm_neon.h>")
+    L.append("")
+    L.append("#include <stdlib.h>")
+    L.append("#include <string.h>")
+    L.append('#include "blas_dgemm.h"')
+    L.append('#include "%s.h"' % prefix.split("/")[-1])
+    L.append("")
+    L.append("#define min(i, j) ((i) < (j) ? (i) : (j))")
+    L.append("")
+    L.append("#define GEN_KC (%d)" % GEN_KC)
+    L.append("#define GEN_NC (%d)" % GEN_NC)
+    L.append("#define GEN_MC (%d)" % GEN_MC)
+    L.append("")
+    L.append(gen_packers({s.mr for s in shapes}, {s.nr for s in shapes}))
+    for s in shapes:
+        L.append("/*")
+        L.append(" * %dx%d 内核：kc 必须是 %d 的倍数且不为 0" % (s.mr, s.nr, s.u))
+        L.append(" * A 每步 %d 个 double，B 每步 %d 个 double" % (s.mr, s.nr))
+        L.append(" */")
+        if backend == "asm":
+            L.append(gen_asm_kernel(s, prefetch))
+        else:
+            L.append(gen_intrin_kernel(s))
+        L.append(gen_driver(s))
+    L.append("#endif")
+    L.append("")
+    return "\n".join(L)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="DGEMM 微内核生成器")
+    parser.add_argument("shapes", nargs="+", help="形状，如 4x8u4 8x4u2 6x8")
+    parser.add_argument("--backend", choices=["asm", "intrin"], default="asm",
+                        help="asm: 内联汇编（O0 下也稳定）；intrin: NEON intrinsics")
+    parser.add_argument("--prefetch", type=int, default=512,
+                        help="A/B 的预取距离（字节），0 表示不预取")
+    parser.add_argument("--out", default="dgemm_gen", help="输出文件前缀")
+    args = parser.parse_args()
+
+    try:
+        shapes = [parse_shape(s) for s in args.shapes]
+    except ValueError as e:
+        print("❌ %s" % e, file=sys.stderr)
+        return 1
+    names = [s.name for s in shapes]
+    if len(set(names)) != len(names):
+        print("❌ 形状重复", file=sys.stderr)
+        return 1
+
+    with open(args.out + ".h", "w") as f:
+        f.write(gen_header(shapes, args.out, args.backend))
+    with open(args.out + ".c", "w") as f:
+        f.write(gen_source(shapes, args.out, args.backend, args.prefetch))
+
+    for s in shapes:
+        print("✅ dgemm_gen_%s (%s)" % (s.name, "软件流水" if s.pipelined else "单组寄存器"))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,704 +0,0 @@
-#ifdef __ARM_NEON
-#include <arm_neon.h>
-
-#include <stdlib.h>
-#include "blas_dgemm.h"
-
-/* 矩阵按行优先顺序存储的宏定义 */
-#define A(i, j) a[(i) * lda + (j)]
-#define B(i, j) b[(i) * ldb + (j)]
-#define C(i, j) c[(i) * ldc + (j)]
-
-#define min(i, j) ((i) < (j) ? (i) : (j))
-
-/**
- * ============================================================================
- * ARM NEON 高度优化的 DGEMM 实现 (双精度矩阵乘法)
- * ============================================================================
- * 
- * 主要优化技术：
- * 
- * 1. 向量化的数据打包函数
- *    - 使用 NEON intrinsics 替代标量操作
- *    - 预期性能提升：2-3倍
- * 
- * 2. 优化的 4x4 计算核心
- *    - 改进的指令调度，减少流水线停顿
- *    - 交错的加载和计算，隐藏内存延迟
- *    - 预取距离优化（640字节）
- * 
- * 3. 高性能 4x8 计算核心
- *    - 更大的计算块，提高计算密度
- *    - 充分利用32个NEON寄存器
- *    - 更好地摊销循环开销
- * 
- * 4. 智能内核选择
- *    - 根据矩阵维度自动选择最优内核
- *    - 4x8 内核用于 n 是 8 的倍数的情况
- *    - 4x4 内核用于其他情况
- * 
- * 5. 改进的预取策略
- *    - 更激进的预取距离
- *    - 针对 L1/L2 缓存优化
- * 
- * 预期总体性能提升：15-30%
- * ============================================================================
- */
-
-// 双精度浮点数的缓存优化分块大小
-#define GEMM_N (256)   // N 维度分块大小
-#define GEMM_M (2048)  // M 维度分块大小  
-#define GEMM_P (128)   // P(K) 维度分块大小
-#define GEMM_UNROLL (4)
-
-/**
- * ============================================================================
- * 优化的 4x4 计算内核 - 核心优化点
- * ============================================================================
- * 
- * 关键改进：
- * 1. 交错的 A 和 B 矩阵加载，隐藏内存访问延迟
- * 2. 按输出寄存器分组的 FMLA 操作，减少数据依赖
- * 3. 预取距离增加到 640 字节（80个double），提高缓存命中率
- * 4. 更好的寄存器复用模式
- * 
- * 性能提升：相比原版提升约 10-15%
- * ============================================================================
- */
-void kernel_4x4_fast(unsigned int m, unsigned int n, unsigned int p, 
-                     double *sa, double *sb, double *sc, unsigned int ldc) {
-    double *a = sa, *b = sb, *c = sc;
-    int i, j;
-    unsigned int ldc_offset = ldc * sizeof(double);
-
-    for (i = 0; i < m; i += 4) {
-        for (j = 0; j < n; j += 4) {
-            asm volatile(
-                "asr x8,%4,2                        \n"  // 循环计数器 = p/4
-                
-                // 加载初始 C 值（4x4 块）
-                "ldr  q0,   [%2]                    \n"  // C[0][0:1]
-                "ldr  q1,   [%2,  #16]              \n"  // C[0][2:3]
-                "add  x13,  %2,      %3             \n"  // C[1] 地址
-                "ldr  q2,   [x13]                   \n"  // C[1][0:1]
-                "ldr  q3,   [x13, #16]              \n"  // C[1][2:3]
-                "add  x14,  x13,     %3             \n"  // C[2] 地址
-                "ldr  q4,   [x14]                   \n"  // C[2][0:1]
-                "ldr  q5,   [x14, #16]              \n"  // C[2][2:3]
-                "add  x15,  x14,     %3             \n"  // C[3] 地址
-                "ldr  q6,   [x15]                   \n"  // C[3][0:1]
-                "ldr  q7,   [x15, #16]              \n"  // C[3][2:3]
-
-                "loop_4x4:                          \n"
-                // 激进的预取策略（640字节 = 80个double）
-                "   prfm pldl1keep, [%0, #640]      \n"  // 预取 A
-                "   prfm pldl1keep, [%1, #640]      \n"  // 预取 B
-
-                // 交错加载 A 和 B 以隐藏延迟
-                "   ld1 {v8.2d,  v9.2d},  [%0], #32 \n"  // A[0][0:3]
-                "   ld1 {v16.2d, v17.2d}, [%1], #32 \n"  // B[0][0:3]
-                "   ld1 {v10.2d, v11.2d}, [%0], #32 \n"  // A[1][0:3]
-                "   ld1 {v18.2d, v19.2d}, [%1], #32 \n"  // B[1][0:3]
-                "   ld1 {v12.2d, v13.2d}, [%0], #32 \n"  // A[2][0:3]
-                "   ld1 {v20.2d, v21.2d}, [%1], #32 \n"  // B[2][0:3]
-                "   ld1 {v14.2d, v15.2d}, [%0], #32 \n"  // A[3][0:3]
-                "   ld1 {v22.2d, v23.2d}, [%1], #32 \n"  // B[3][0:3]
-
-                // 优化的计算模式 - 按输出寄存器分组
-                // 这减少了依赖链，提高了指令级并行度（ILP）
-                
-                // B[0] 列与所有 A 行
-                "   fmla   v0.2d,   v16.2d,  v8.d[0]  \n"
-                "   fmla   v2.2d,   v16.2d,  v8.d[1]  \n"
-                "   fmla   v4.2d,   v16.2d,  v9.d[0]  \n"
-                "   fmla   v6.2d,   v16.2d,  v9.d[1]  \n"
-                "   fmla   v1.2d,   v17.2d,  v8.d[0]  \n"
-                "   fmla   v3.2d,   v17.2d,  v8.d[1]  \n"
-                "   fmla   v5.2d,   v17.2d,  v9.d[0]  \n"
-                "   fmla   v7.2d,   v17.2d,  v9.d[1]  \n"
-
-                // B[1] 列与所有 A 行
-                "   fmla   v0.2d,   v18.2d,  v10.d[0] \n"
-                "   fmla   v2.2d,   v18.2d,  v10.d[1] \n"
-                "   fmla   v4.2d,   v18.2d,  v11.d[0] \n"
-                "   fmla   v6.2d,   v18.2d,  v11.d[1] \n"
-                "   fmla   v1.2d,   v19.2d,  v10.d[0] \n"
-                "   fmla   v3.2d,   v19.2d,  v10.d[1] \n"
-                "   fmla   v5.2d,   v19.2d,  v11.d[0] \n"
-                "   fmla   v7.2d,   v19.2d,  v11.d[1] \n"
-
-                // B[2] 列与所有 A 行
-                "   fmla   v0.2d,   v20.2d,  v12.d[0] \n"
-                "   fmla   v2.2d,   v20.2d,  v12.d[1] \n"
-                "   fmla   v4.2d,   v20.2d,  v13.d[0] \n"
-                "   fmla   v6.2d,   v20.2d,  v13.d[1] \n"
-                "   fmla   v1.2d,   v21.2d,  v12.d[0] \n"
-                "   fmla   v3.2d,   v21.2d,  v12.d[1] \n"
-                "   fmla   v5.2d,   v21.2d,  v13.d[0] \n"
-                "   fmla   v7.2d,   v21.2d,  v13.d[1] \n"
-
-                // B[3] 列与所有 A 行
-                "   fmla   v0.2d,   v22.2d,  v14.d[0] \n"
-                "   fmla   v2.2d,   v22.2d,  v14.d[1] \n"
-                "   fmla   v4.2d,   v22.2d,  v15.d[0] \n"
-                "   fmla   v6.2d,   v22.2d,  v15.d[1] \n"
-                "   fmla   v1.2d,   v23.2d,  v14.d[0] \n"
-                "   fmla   v3.2d,   v23.2d,  v14.d[1] \n"
-                "   fmla   v5.2d,   v23.2d,  v15.d[0] \n"
-                "   fmla   v7.2d,   v23.2d,  v15.d[1] \n"
-
-                "   subs x8, x8, #1                 \n"
-                "   bne loop_4x4                    \n"
-
-                // 将结果存回 C
-                "   str q0, [%2]                    \n"
-                "   str q1, [%2,  #16]              \n"
-                "   str q2, [x13]                   \n"
-                "   str q3, [x13, #16]              \n"
-                "   str q4, [x14]                   \n"
-                "   str q5, [x14, #16]              \n"
-                "   str q6, [x15]                   \n"
-                "   str q7, [x15, #16]              \n"
-                
-                : "=r"(a), "=r"(b), "=r"(c), "=r"(ldc_offset), "=r"(p)
-                : "0"(a), "1"(b), "2"(c), "3"(ldc_offset), "4"(p)
-                : "memory", "cc", "x8", "x13", "x14", "x15",
-                  "v0", "v1", "v2", "v3", "v4", "v5", "v6", "v7",
-                  "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15",
-                  "v16", "v17", "v18", "v19", "v20", "v21", "v22", "v23"
-            );
-            c += 4;
-            a -= 4 * p;
-        }
-        sc += ldc * 4;
-        c = sc;
-        a += 4 * p;
-        b = sb;
-    }
-}
-
-/**
- * ============================================================================
- * 高性能 4x8 计算内核 - 提高计算密度
- * ============================================================================
- * 
- * 优势：
- * 1. 每次迭代处理 4行 x 8列 = 32个元素，提高计算密度
- * 2. 充分利用全部32个NEON寄存器
- * 3. 更好地摊销循环开销
- * 4. 减少内存访问次数
- * 
- * 适用场景：当 n 是 8 的倍数时
- * 性能提升：相比 4x4 内核提升约 20-25%
- * ============================================================================
- */
-void kernel_4x8_fast(unsigned int m, unsigned int n, unsigned int p,
-                     double *sa, double *sb, double *sc, unsigned int ldc) {
-    double *a = sa, *b = sb, *c = sc;
-    int i, j;
-    unsigned int ldc_offset = ldc * sizeof(double);
-
-    for (i = 0; i < m; i += 4) {
-        for (j = 0; j < n; j += 8) {
-            asm volatile(
-                "asr x8,%4,2                        \n"
-                
-                // 加载 C（4x8 块 = 16个向量寄存器）
-                "ldr  q0,   [%2]                    \n"  // C[0][0:1]
-                "ldr  q1,   [%2,  #16]              \n"  // C[0][2:3]
-                "ldr  q2,   [%2,  #32]              \n"  // C[0][4:5]
-                "ldr  q3,   [%2,  #48]              \n"  // C[0][6:7]
-                
-                "add  x13,  %2,      %3             \n"  // C[1]
-                "ldr  q4,   [x13]                   \n"
-                "ldr  q5,   [x13, #16]              \n"
-                "ldr  q6,   [x13, #32]              \n"
-                "ldr  q7,   [x13, #48]              \n"
-                
-                "add  x14,  x13,     %3             \n"  // C[2]
-                "ldr  q8,   [x14]                   \n"
-                "ldr  q9,   [x14, #16]              \n"
-                "ldr  q10,  [x14, #32]              \n"
-                "ldr  q11,  [x14, #48]              \n"
-                
-                "add  x15,  x14,     %3             \n"  // C[3]
-                "ldr  q12,  [x15]                   \n"
-                "ldr  q13,  [x15, #16]              \n"
-                "ldr  q14,  [x15, #32]              \n"
-                "ldr  q15,  [x15, #48]              \n"
-
-                "loop_4x8:                          \n"
-                // 更大的预取距离（因为处理更多数据）
-                "   prfm pldl1keep, [%0, #768]      \n"
-                "   prfm pldl1keep, [%1, #1024]     \n"
-
-                // 加载 A（4x4 = 8个向量）
-                "   ld1 {v16.2d, v17.2d}, [%0], #32 \n"  // A[0][0:3]
-                "   ld1 {v18.2d, v19.2d}, [%0], #32 \n"  // A[1][0:3]
-                "   ld1 {v20.2d, v21.2d}, [%0], #32 \n"  // A[2][0:3]
-                "   ld1 {v22.2d, v23.2d}, [%0], #32 \n"  // A[3][0:3]
-
-                // 加载 B 的同时立即进行计算，隐藏延迟
-                // K=0, B[0][0:7]
-                "   ld1 {v24.2d, v25.2d}, [%1], #32 \n"
-                "   fmla v0.2d,  v24.2d, v16.d[0]   \n"
-                "   fmla v4.2d,  v24.2d, v16.d[1]   \n"
-                "   fmla v8.2d,  v24.2d, v17.d[0]   \n"
-                "   fmla v12.2d, v24.2d, v17.d[1]   \n"
-                
-                "   fmla v1.2d,  v25.2d, v16.d[0]   \n"
-                "   fmla v5.2d,  v25.2d, v16.d[1]   \n"
-                "   fmla v9.2d,  v25.2d, v17.d[0]   \n"
-                "   fmla v13.2d, v25.2d, v17.d[1]   \n"
-                
-                "   ld1 {v26.2d, v27.2d}, [%1], #32 \n"
-                "   fmla v2.2d,  v26.2d, v16.d[0]   \n"
-                "   fmla v6.2d,  v26.2d, v16.d[1]   \n"
-                "   fmla v10.2d, v26.2d, v17.d[0]   \n"
-                "   fmla v14.2d, v26.2d, v17.d[1]   \n"
-                
-                "   fmla v3.2d,  v27.2d, v16.d[0]   \n"
-                "   fmla v7.2d,  v27.2d, v16.d[1]   \n"
-                "   fmla v11.2d, v27.2d, v17.d[0]   \n"
-                "   fmla v15.2d, v27.2d, v17.d[1]   \n"
-
-                // K=1, B[1][0:7]
-                "   ld1 {v24.2d, v25.2d}, [%1], #32 \n"
-                "   fmla v0.2d,  v24.2d, v18.d[0]   \n"
-                "   fmla v4.2d,  v24.2d, v18.d[1]   \n"
-                "   fmla v8.2d,  v24.2d, v19.d[0]   \n"
-                "   fmla v12.2d, v24.2d, v19.d[1]   \n"
-                
-                "   fmla v1.2d,  v25.2d, v18.d[0]   \n"
-                "   fmla v5.2d,  v25.2d, v18.d[1]   \n"
-                "   fmla v9.2d,  v25.2d, v19.d[0]   \n"
-                "   fmla v13.2d, v25.2d, v19.d[1]   \n"
-                
-                "   ld1 {v26.2d, v27.2d}, [%1], #32 \n"
-                "   fmla v2.2d,  v26.2d, v18.d[0]   \n"
-                "   fmla v6.2d,  v26.2d, v18.d[1]   \n"
-                "   fmla v10.2d, v26.2d, v19.d[0]   \n"
-                "   fmla v14.2d, v26.2d, v19.d[1]   \n"
-                
-                "   fmla v3.2d,  v27.2d, v18.d[0]   \n"
-                "   fmla v7.2d,  v27.2d, v18.d[1]   \n"
-                "   fmla v11.2d, v27.2d, v19.d[0]   \n"
-                "   fmla v15.2d, v27.2d, v19.d[1]   \n"
-
-                // K=2, B[2][0:7]
-                "   ld1 {v24.2d, v25.2d}, [%1], #32 \n"
-                "   fmla v0.2d,  v24.2d, v20.d[0]   \n"
-                "   fmla v4.2d,  v24.2d, v20.d[1]   \n"
-                "   fmla v8.2d,  v24.2d, v21.d[0]   \n"
-                "   fmla v12.2d, v24.2d, v21.d[1]   \n"
-                
-                "   fmla v1.2d,  v25.2d, v20.d[0]   \n"
-                "   fmla v5.2d,  v25.2d, v20.d[1]   \n"
-                "   fmla v9.2d,  v25.2d, v21.d[0]   \n"
-                "   fmla v13.2d, v25.2d, v21.d[1]   \n"
-                
-                "   ld1 {v26.2d, v27.2d}, [%1], #32 \n"
-                "   fmla v2.2d,  v26.2d, v20.d[0]   \n"
-                "   fmla v6.2d,  v26.2d, v20.d[1]   \n"
-                "   fmla v10.2d, v26.2d, v21.d[0]   \n"
-                "   fmla v14.2d, v26.2d, v21.d[1]   \n"
-                
-                "   fmla v3.2d,  v27.2d, v20.d[0]   \n"
-                "   fmla v7.2d,  v27.2d, v20.d[1]   \n"
-                "   fmla v11.2d, v27.2d, v21.d[0]   \n"
-                "   fmla v15.2d, v27.2d, v21.d[1]   \n"
-
-                // K=3, B[3][0:7]
-                "   ld1 {v24.2d, v25.2d}, [%1], #32 \n"
-                "   fmla v0.2d,  v24.2d, v22.d[0]   \n"
-                "   fmla v4.2d,  v24.2d, v22.d[1]   \n"
-                "   fmla v8.2d,  v24.2d, v23.d[0]   \n"
-                "   fmla v12.2d, v24.2d, v23.d[1]   \n"
-                
-                "   fmla v1.2d,  v25.2d, v22.d[0]   \n"
-                "   fmla v5.2d,  v25.2d, v22.d[1]   \n"
-                "   fmla v9.2d,  v25.2d, v23.d[0]   \n"
-                "   fmla v13.2d, v25.2d, v23.d[1]   \n"
-                
-                "   ld1 {v26.2d, v27.2d}, [%1], #32 \n"
-                "   fmla v2.2d,  v26.2d, v22.d[0]   \n"
-                "   fmla v6.2d,  v26.2d, v22.d[1]   \n"
-                "   fmla v10.2d, v26.2d, v23.d[0]   \n"
-                "   fmla v14.2d, v26.2d, v23.d[1]   \n"
-                
-                "   fmla v3.2d,  v27.2d, v22.d[0]   \n"
-                "   fmla v7.2d,  v27.2d, v22.d[1]   \n"
-                "   fmla v11.2d, v27.2d, v23.d[0]   \n"
-                "   fmla v15.2d, v27.2d, v23.d[1]   \n"
-
-                "   subs x8, x8, #1                 \n"
-                "   bne loop_4x8                    \n"
-
-                // 存储全部 4x8 结果
-                "   str q0,  [%2]                   \n"
-                "   str q1,  [%2,  #16]             \n"
-                "   str q2,  [%2,  #32]             \n"
-                "   str q3,  [%2,  #48]             \n"
-                "   str q4,  [x13]                  \n"
-                "   str q5,  [x13, #16]             \n"
-                "   str q6,  [x13, #32]             \n"
-                "   str q7,  [x13, #48]             \n"
-                "   str q8,  [x14]                  \n"
-                "   str q9,  [x14, #16]             \n"
-                "   str q10, [x14, #32]             \n"
-                "   str q11, [x14, #48]             \n"
-                "   str q12, [x15]                  \n"
-                "   str q13, [x15, #16]             \n"
-                "   str q14, [x15, #32]             \n"
-                "   str q15, [x15, #48]             \n"
-                
-                : "=r"(a), "=r"(b), "=r"(c), "=r"(ldc_offset), "=r"(p)
-                : "0"(a), "1"(b), "2"(c), "3"(ldc_offset), "4"(p)
-                : "memory", "cc", "x8", "x13", "x14", "x15",
-                  "v0", "v1", "v2", "v3", "v4", "v5", "v6", "v7",
-                  "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15",
-                  "v16", "v17", "v18", "v19", "v20", "v21", "v22", "v23",
-                  "v24", "v25", "v26", "v27", "v28", "v29", "v30", "v31"
-            );
-            c += 8;
-            a -= 4 * p;
-        }
-        sc += ldc * 4;
-        c = sc;
-        a += 4 * p;
-        b = sb;
-    }
-}
-
-/**
- * ============================================================================
- * 向量化的 A 矩阵打包函数
- * ============================================================================
- * 
- * 使用 NEON intrinsics 替代标量操作
- * 
- * 性能提升：相比标量版本快 2-3 倍
- * 
- * 打包模式：将 4x4 块转置并按列存储
- * 输入: 行优先的 4x4 块
- * 输出: 转置后的列优先格式
- * ============================================================================
- */
-void packA_4_fast(unsigned int m, unsigned int p, double *from, unsigned int lda, double *to) {
-    unsigned int j, i;
-    double *a_offset = from;
-    double *b_offset = to;
-    
-    j = (m >> 2);  // 每次处理4行
-    while (j > 0) {
-        double *a0 = a_offset;
-        double *a1 = a0 + lda;
-        double *a2 = a1 + lda;
-        double *a3 = a2 + lda;
-        a_offset += 4 * lda;
-        
-        i = (p >> 2);  // 每次处理4列
-        while (i > 0) {
-            // 使用 NEON 加载 4x4 块
-            float64x2_t v0_01 = vld1q_f64(a0);      // a0[0:1]
-            float64x2_t v0_23 = vld1q_f64(a0 + 2);  // a0[2:3]
-            float64x2_t v1_01 = vld1q_f64(a1);      // a1[0:1]
-            float64x2_t v1_23 = vld1q_f64(a1 + 2);  // a1[2:3]
-            float64x2_t v2_01 = vld1q_f64(a2);      // a2[0:1]
-            float64x2_t v2_23 = vld1q_f64(a2 + 2);  // a2[2:3]
-            float64x2_t v3_01 = vld1q_f64(a3);      // a3[0:1]
-            float64x2_t v3_23 = vld1q_f64(a3 + 2);  // a3[2:3]
-
-            // 转置并存储：zigzag 模式
-            // 列 0（所有行的第0个元素）
-            vst1_f64(b_offset,     vget_low_f64(v0_01));   // a0[0]
-            vst1_f64(b_offset + 1, vget_low_f64(v1_01));   // a1[0]
-            vst1_f64(b_offset + 2, vget_low_f64(v2_01));   // a2[0]
-            vst1_f64(b_offset + 3, vget_low_f64(v3_01));   // a3[0]
-            
-            // 列 1
-            vst1_f64(b_offset + 4, vget_high_f64(v0_01));  // a0[1]
-            vst1_f64(b_offset + 5, vget_high_f64(v1_01));  // a1[1]
-            vst1_f64(b_offset + 6, vget_high_f64(v2_01));  // a2[1]
-            vst1_f64(b_offset + 7, vget_high_f64(v3_01));  // a3[1]
-            
-            // 列 2
-            vst1_f64(b_offset + 8,  vget_low_f64(v0_23));  // a0[2]
-            vst1_f64(b_offset + 9,  vget_low_f64(v1_23));  // a1[2]
-            vst1_f64(b_offset + 10, vget_low_f64(v2_23));  // a2[2]
-            vst1_f64(b_offset + 11, vget_low_f64(v3_23));  // a3[2]
-            
-            // 列 3
-            vst1_f64(b_offset + 12, vget_high_f64(v0_23)); // a0[3]
-            vst1_f64(b_offset + 13, vget_high_f64(v1_23)); // a1[3]
-            vst1_f64(b_offset + 14, vget_high_f64(v2_23)); // a2[3]
-            vst1_f64(b_offset + 15, vget_high_f64(v3_23)); // a3[3]
-
-            a0 += 4;
-            a1 += 4;
-            a2 += 4;
-            a3 += 4;
-            b_offset += 16;
-            i--;
-        }
-        j--;
-    }
-}
-
-/**
- * ============================================================================
- * 向量化的 B 矩阵打包函数（用于 4x4 内核）
- * ============================================================================
- * 
- * 使用 NEON intrinsics 替代标量操作
- * 性能提升：相比标量版本快 2-3 倍
- * 
- * 打包模式：按行优先存储 4x4 块
- * ============================================================================
- */
-void packB_4_fast(unsigned int p, unsigned int n, double *from, unsigned int ldb, double *to) {
-    unsigned int j, i;
-    double *a_offset = from;
-    double *b_offset = to;
-    
-    j = (p >> 2);
-    while (j > 0) {
-        double *a0 = a_offset;
-        double *a1 = a0 + ldb;
-        double *a2 = a1 + ldb;
-        double *a3 = a2 + ldb;
-        a_offset += 4 * ldb;
-        
-        double *b_out = b_offset;
-        b_offset += 16;
-        
-        i = (n >> 2);
-        while (i > 0) {
-            // 使用 NEON 加载 4x4 块
-            float64x2_t v0_01 = vld1q_f64(a0);
-            float64x2_t v0_23 = vld1q_f64(a0 + 2);
-            float64x2_t v1_01 = vld1q_f64(a1);
-            float64x2_t v1_23 = vld1q_f64(a1 + 2);
-            float64x2_t v2_01 = vld1q_f64(a2);
-            float64x2_t v2_23 = vld1q_f64(a2 + 2);
-            float64x2_t v3_01 = vld1q_f64(a3);
-            float64x2_t v3_23 = vld1q_f64(a3 + 2);
-
-            // 按行优先顺序存储
-            vst1q_f64(b_out,      v0_01);
-            vst1q_f64(b_out + 2,  v0_23);
-            vst1q_f64(b_out + 4,  v1_01);
-            vst1q_f64(b_out + 6,  v1_23);
-            vst1q_f64(b_out + 8,  v2_01);
-            vst1q_f64(b_out + 10, v2_23);
-            vst1q_f64(b_out + 12, v3_01);
-            vst1q_f64(b_out + 14, v3_23);
-
-            a0 += 4;
-            a1 += 4;
-            a2 += 4;
-            a3 += 4;
-            b_out += p * 4;
-            i--;
-        }
-        j--;
-    }
-}
-
-/**
- * ============================================================================
- * 增强的 B 矩阵打包函数（用于 4x8 内核）
- * ============================================================================
- * 
- * 每次打包 4x8 块以配合 4x8 计算内核
- * 充分利用向量化，提高打包速度
- * ============================================================================
- */
-void packB_8_fast(unsigned int p, unsigned int n, double *from, unsigned int ldb, double *to) {
-    unsigned int j, i;
-    double *a_offset = from;
-    double *b_offset = to;
-    
-    j = (p >> 2);
-    while (j > 0) {
-        double *a0 = a_offset;
-        double *a1 = a0 + ldb;
-        double *a2 = a1 + ldb;
-        double *a3 = a2 + ldb;
-        a_offset += 4 * ldb;
-        
-        double *b_out = b_offset;
-        b_offset += 32;  // 4行 * 8列
-        
-        i = (n >> 3);  // 每次处理8列
-        while (i > 0) {
-            // 加载 4x8 块
-            float64x2_t v0_01 = vld1q_f64(a0);
-            float64x2_t v0_23 = vld1q_f64(a0 + 2);
-            float64x2_t v0_45 = vld1q_f64(a0 + 4);
-            float64x2_t v0_67 = vld1q_f64(a0 + 6);
-            
-            float64x2_t v1_01 = vld1q_f64(a1);
-            float64x2_t v1_23 = vld1q_f64(a1 + 2);
-            float64x2_t v1_45 = vld1q_f64(a1 + 4);
-            float64x2_t v1_67 = vld1q_f64(a1 + 6);
-            
-            float64x2_t v2_01 = vld1q_f64(a2);
-            float64x2_t v2_23 = vld1q_f64(a2 + 2);
-            float64x2_t v2_45 = vld1q_f64(a2 + 4);
-            float64x2_t v2_67 = vld1q_f64(a2 + 6);
-            
-            float64x2_t v3_01 = vld1q_f64(a3);
-            float64x2_t v3_23 = vld1q_f64(a3 + 2);
-            float64x2_t v3_45 = vld1q_f64(a3 + 4);
-            float64x2_t v3_67 = vld1q_f64(a3 + 6);
-
-            // 按行存储
-            vst1q_f64(b_out,      v0_01);
-            vst1q_f64(b_out + 2,  v0_23);
-            vst1q_f64(b_out + 4,  v0_45);
-            vst1q_f64(b_out + 6,  v0_67);
-            vst1q_f64(b_out + 8,  v1_01);
-            vst1q_f64(b_out + 10, v1_23);
-            vst1q_f64(b_out + 12, v1_45);
-            vst1q_f64(b_out + 14, v1_67);
-            vst1q_f64(b_out + 16, v2_01);
-            vst1q_f64(b_out + 18, v2_23);
-            vst1q_f64(b_out + 20, v2_45);
-            vst1q_f64(b_out + 22, v2_67);
-            vst1q_f64(b_out + 24, v3_01);
-            vst1q_f64(b_out + 26, v3_23);
-            vst1q_f64(b_out + 28, v3_45);
-            vst1q_f64(b_out + 30, v3_67);
-
-            a0 += 8;
-            a1 += 8;
-            a2 += 8;
-            a3 += 8;
-            b_out += p * 8;
-            i--;
-        }
-        j--;
-    }
-}
-
-/**
- * ============================================================================
- * 主优化 DGEMM 函数
- * ============================================================================
- * 
- * C(mxn) = A(mxp) * B(pxn)
- * 
- * 智能特性：
- * 1. 根据矩阵维度自动选择最优计算内核
- * 2. 当 n 是 8 的倍数时使用 4x8 内核（更快）
- * 3. 其他情况使用 4x4 内核（通用）
- * 4. 向量化的打包函数提速 2-3 倍
- * 5. 优化的缓存分块策略
- * 
- * 参数：
- *   m, n, p - 矩阵维度
- *   a, b, c - 输入输出矩阵指针
- *   lda, ldb, ldc - 各矩阵的 leading dimension
- *   sa, sb - 预分配的打包缓冲区
- * 
- * 预期性能提升：相比原版 15-30%
- * ============================================================================
- */
-void dgemm_neon_fast(unsigned int m, unsigned int n, unsigned int p, 
-                     double *a, unsigned int lda, 
-                     double *b, unsigned int ldb,
-                     double *c, unsigned int ldc, 
-                     double *sa, double *sb) {
-    
-    unsigned int ms, mms, ns, ps;
-    unsigned int min_m, min_mm, min_n, min_p;
-    int l1stride = 1;
-    
-    // M 维度分块
-    for (ms = 0; ms < m; ms += GEMM_M) {
-        min_m = m - ms;
-        if (min_m > GEMM_M) {
-            min_m = GEMM_M;
-        }
-        
-        // P(K) 维度分块
-        for (ps = 0; ps < p; ps += min_p) {
-            min_p = p - ps;
-            if (min_p >= (GEMM_P << 1)) {
-                min_p = GEMM_P;
-            } else if (min_p > GEMM_P) {
-                min_p = (min_p / 2 + GEMM_UNROLL - 1) & ~(GEMM_UNROLL - 1);
-            }
-            
-            // N 维度分块并打包 B
-            min_n = n;
-            if (n >= GEMM_N * 2) {
-                min_n = GEMM_N;
-            } else if (n > GEMM_N) {
-                min_n = (min_n / 2 + GEMM_UNROLL - 1) & ~(GEMM_UNROLL - 1);
-            } else {
-                l1stride = 0;
-            }
-            
-            // 智能选择打包方式：如果 n 是 8 的倍数，使用 4x8 打包
-            if ((min_n & 7) == 0) {
-                packB_8_fast(min_p, min_n, b + ps * ldb, ldb, sb);
-            } else {
-                packB_4_fast(min_p, min_n, b + ps * ldb, ldb, sb);
-            }
-            
-            // 打包 A 并计算
-            for (mms = ms; mms < ms + min_m; mms += min_mm) {
-                min_mm = (ms + min_m) - mms;
-                if (min_mm >= 3 * GEMM_UNROLL) {
-                    min_mm = 3 * GEMM_UNROLL;
-                } else if (min_mm >= 2 * GEMM_UNROLL) {
-                    min_mm = 2 * GEMM_UNROLL;
-                } else if (min_mm > GEMM_UNROLL) {
-                    min_mm = GEMM_UNROLL;
-                }
-                
-                // 使用优化的 packA
-                packA_4_fast(min_mm, min_p, a + mms * lda + ps, lda,
-                            sa + min_p * (mms - ms) * l1stride);
-                
-                // 根据 n 维度智能选择计算内核
-                if ((min_n & 7) == 0) {
-                    // n 是 8 的倍数，使用更快的 4x8 内核
-                    kernel_4x8_fast(min_mm, min_n, min_p, 
-                                   sa + l1stride * min_p * (mms - ms), sb,
-                                   c + mms * ldc, ldc);
-                } else {
-                    // 使用通用 4x4 内核
-                    kernel_4x4_fast(min_mm, min_n, min_p, 
-                                   sa + l1stride * min_p * (mms - ms), sb,
-                                   c + mms * ldc, ldc);
-                }
-            }
-            
-            // 处理剩余的 B 块
-            for (ns = min_n; ns < n; ns += min_n) {
-                min_n = n - ns;
-                if (min_n >= GEMM_N * 2) {
-                    min_n = GEMM_N;
-                } else if (min_n > GEMM_N) {
-                    min_n = (min_n / 2 + GEMM_UNROLL - 1) & ~(GEMM_UNROLL - 1);
-                }
-                
-                // 智能选择打包和计算内核
-                if ((min_n & 7) == 0) {
-                    packB_8_fast(min_p, min_n, b + ns + ldb * ps, ldb, sb);
-                    kernel_4x8_fast(min_m, min_n, min_p, sa, sb, 
-                                   c + ms * ldc + ns, ldc);
-                } else {
-                    packB_4_fast(min_p, min_n, b + ns + ldb * ps, ldb, sb);
-                    kernel_4x4_fast(min_m, min_n, min_p, sa, sb, 
-                                   c + ms * ldc + ns, ldc);
-                }
-            }
-        }
-    }
-}
-
-#endif